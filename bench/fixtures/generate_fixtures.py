@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Regenerates the benchmark fixtures in this directory.
+
+The fixtures model a 1920x1080 broadcast view: 22 players and a referee drifting across the
+pitch, and a ball moving between them with occasional missed detections. They are deterministic
+(fixed seed) so benchmark results stay comparable between releases.
+
+  detections.txt          frame x y w h confidence class_id   (pixels, COCO classes 0 / 32)
+  tracks.txt              frame track_id x_m y_m team         (calibrated pitch coordinates)
+  yolo_output_sparse.txt  anchor cx cy w h class_id score     (640x640 network input space)
+  calibration.yaml        homography used for tracks.txt
+"""
+import math
+import os
+import random
+
+FRAMES = 300
+WIDTH, HEIGHT = 1920, 1080
+NUM_PLAYERS = 23  # 22 players + referee
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Pixel -> pitch metres (105 x 68) with a mild perspective term
+H = [[105.0 / WIDTH, 0.0, 0.0],
+     [0.0, 68.0 / HEIGHT, 0.0],
+     [0.0, 0.00002, 1.0]]
+
+
+def to_pitch(x, y):
+    w = H[2][0] * x + H[2][1] * y + H[2][2]
+    return ((H[0][0] * x + H[0][1] * y + H[0][2]) / w,
+            (H[1][0] * x + H[1][1] * y + H[1][2]) / w)
+
+
+def main():
+    rng = random.Random(20240501)
+    players = []
+    for i in range(NUM_PLAYERS):
+        team = "Referee" if i == NUM_PLAYERS - 1 else ("Team A" if i % 2 == 0 else "Team B")
+        players.append({
+            "x": rng.uniform(100, WIDTH - 100), "y": rng.uniform(150, HEIGHT - 100),
+            "vx": rng.uniform(-4, 4), "vy": rng.uniform(-2, 2), "team": team,
+        })
+    ball = {"x": WIDTH / 2, "y": HEIGHT / 2, "vx": 9.0, "vy": -3.0}
+
+    with open(os.path.join(HERE, "detections.txt"), "w") as det, \
+            open(os.path.join(HERE, "tracks.txt"), "w") as trk:
+        det.write("# frame x y w h confidence class_id\n")
+        trk.write("# frame track_id x_m y_m team\n")
+        for frame in range(1, FRAMES + 1):
+            for track_id, p in enumerate(players):
+                p["vx"] = max(-8, min(8, p["vx"] + rng.gauss(0, 0.4)))
+                p["vy"] = max(-5, min(5, p["vy"] + rng.gauss(0, 0.3)))
+                p["x"] = min(max(p["x"] + p["vx"], 40), WIDTH - 40)
+                p["y"] = min(max(p["y"] + p["vy"], 120), HEIGHT - 10)
+                w, h = 34 + rng.randint(-3, 3), 80 + rng.randint(-5, 5)
+                det.write("%d %d %d %d %d %.3f 0\n" % (frame, p["x"] - w / 2, p["y"] - h, w, h,
+                                                      rng.uniform(0.55, 0.95)))
+                xm, ym = to_pitch(p["x"], p["y"])
+                trk.write("%d %d %.3f %.3f %s\n" % (frame, track_id, xm, ym, p["team"].replace(" ", "_")))
+            ball["x"] += ball["vx"]
+            ball["y"] += ball["vy"]
+            if not 20 < ball["x"] < WIDTH - 20:
+                ball["vx"] = -ball["vx"]
+            if not 120 < ball["y"] < HEIGHT - 20:
+                ball["vy"] = -ball["vy"]
+            if rng.random() > 0.2:  # ball missed ~20% of frames
+                det.write("%d %d %d 12 12 %.3f 32\n" % (frame, ball["x"] - 6, ball["y"] - 6,
+                                                        rng.uniform(0.3, 0.8)))
+
+    # Raw network output for the last frame: each object is hit by three neighbouring anchors
+    with open(os.path.join(HERE, "yolo_output_sparse.txt"), "w") as out:
+        out.write("# anchor cx cy w h class_id score\n")
+        sx, sy = 640.0 / WIDTH, 640.0 / HEIGHT
+        objects = [(p["x"], p["y"] - 40, 34, 80, 0) for p in players] + [(ball["x"], ball["y"], 12, 12, 32)]
+        used = set()
+        for cx, cy, w, h, cls in objects:
+            for k in range(3):
+                anchor = rng.randrange(8400)
+                while anchor in used:
+                    anchor = rng.randrange(8400)
+                used.add(anchor)
+                out.write("%d %.2f %.2f %.2f %.2f %d %.3f\n" % (
+                    anchor, cx * sx + rng.gauss(0, 1), cy * sy + rng.gauss(0, 1),
+                    w * sx * rng.uniform(0.9, 1.1), h * sy * rng.uniform(0.9, 1.1), cls,
+                    rng.uniform(0.5, 0.9) - 0.1 * k))
+
+    with open(os.path.join(HERE, "calibration.yaml"), "w") as cal:
+        cal.write("homography_matrix:\n")
+        for row in H:
+            for value in row:
+                cal.write("  - %r\n" % value)
+
+
+if __name__ == "__main__":
+    main()
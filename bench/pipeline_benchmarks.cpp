@@ -0,0 +1,290 @@
+// Micro-benchmarks for the CPU stages of the pipeline, fed by the fixtures in bench/fixtures.
+// No GPU or model files are needed. Typical use:
+//   ./bench --benchmark_format=json --benchmark_out=bench_results.json
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "analytics/metrics.h"
+#include "detection/ball_tracker.h"
+#include "detection/player_tracker.h"
+#include "detection/yolo_processing.h"
+#include "utils/calibration.h"
+
+namespace {
+
+const int kFrameWidth = 1920;
+const int kFrameHeight = 1080;
+const int kInputSize = 640;
+
+struct TrackFrame {
+    std::vector<std::pair<int, cv::Point2f>> tracks;
+    std::map<int, std::string> team_assignments;
+};
+
+std::string fixture_path(const std::string& name) {
+    const char* dir = std::getenv("BENCH_FIXTURE_DIR");
+    return std::string(dir ? dir : BENCH_FIXTURE_DIR) + "/" + name;
+}
+
+std::ifstream open_fixture(const std::string& name) {
+    std::ifstream file(fixture_path(name));
+    if (!file.is_open()) {
+        throw std::runtime_error("Missing benchmark fixture: " + fixture_path(name));
+    }
+    return file;
+}
+
+// Per-frame detections, split into players (class 0) and balls (class 32)
+struct DetectionFixture {
+    std::vector<std::vector<Detection>> players;
+    std::vector<std::vector<Detection>> balls;
+};
+
+const DetectionFixture& detection_fixture() {
+    static const DetectionFixture fixture = [] {
+        DetectionFixture loaded;
+        std::ifstream file = open_fixture("detections.txt");
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            int frame;
+            Detection det;
+            fields >> frame >> det.box.x >> det.box.y >> det.box.width >> det.box.height >> det.confidence >> det.class_id;
+            if (frame > static_cast<int>(loaded.players.size())) {
+                loaded.players.resize(frame);
+                loaded.balls.resize(frame);
+            }
+            (det.class_id == 32 ? loaded.balls : loaded.players)[frame - 1].push_back(det);
+        }
+        return loaded;
+    }();
+    return fixture;
+}
+
+const std::vector<TrackFrame>& track_fixture() {
+    static const std::vector<TrackFrame> fixture = [] {
+        std::vector<TrackFrame> frames;
+        std::ifstream file = open_fixture("tracks.txt");
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            int frame, track_id;
+            float x, y;
+            std::string team;
+            fields >> frame >> track_id >> x >> y >> team;
+            if (frame > static_cast<int>(frames.size())) {
+                frames.resize(frame);
+            }
+            for (char& c : team) {
+                if (c == '_') c = ' ';
+            }
+            frames[frame - 1].tracks.emplace_back(track_id, cv::Point2f(x, y));
+            frames[frame - 1].team_assignments[track_id] = team;
+        }
+        return frames;
+    }();
+    return fixture;
+}
+
+// Dense network output: recorded anchors from the sparse fixture on top of the low background
+// scores a real model emits everywhere else
+const std::vector<float>& yolo_output_fixture() {
+    static const std::vector<float> fixture = [] {
+        std::vector<float> output(kYoloOutputSize);
+        uint32_t state = 12345;
+        for (float& value : output) {
+            state = state * 1664525u + 1013904223u;
+            value = (state >> 8) * (0.02f / 16777216.0f);
+        }
+
+        std::ifstream file = open_fixture("yolo_output_sparse.txt");
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            int anchor, class_id;
+            float cx, cy, w, h, score;
+            fields >> anchor >> cx >> cy >> w >> h >> class_id >> score;
+            output[0 * kYoloNumAnchors + anchor] = cx;
+            output[1 * kYoloNumAnchors + anchor] = cy;
+            output[2 * kYoloNumAnchors + anchor] = w;
+            output[3 * kYoloNumAnchors + anchor] = h;
+            output[(4 + class_id) * kYoloNumAnchors + anchor] = score;
+        }
+        return output;
+    }();
+    return fixture;
+}
+
+cv::Mat synthetic_frame(int width, int height) {
+    cv::Mat frame(height, width, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    return frame;
+}
+
+void BM_Preprocess(benchmark::State& state) {
+    cv::Mat frame = synthetic_frame(state.range(0), state.range(1));
+    for (auto _ : state) {
+        std::vector<float> input = yolo_preprocess(frame, kInputSize, kInputSize);
+        benchmark::DoNotOptimize(input.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Preprocess)->Args({1280, 720})->Args({1920, 1080})->Args({3840, 2160})->Unit(benchmark::kMicrosecond);
+
+void BM_Postprocess(benchmark::State& state) {
+    const std::vector<float>& output = yolo_output_fixture();
+    for (auto _ : state) {
+        std::vector<Detection> detections = yolo_postprocess(output.data(), cv::Size(kFrameWidth, kFrameHeight), kInputSize, kInputSize);
+        benchmark::DoNotOptimize(detections.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Postprocess)->Unit(benchmark::kMicrosecond);
+
+// CPU side of one tiled 4K frame: the full frame plus the tiles of the given size are
+// preprocessed into a batch, and the fixture output is decoded for each crop and merged
+void BM_TiledPrePostprocess(benchmark::State& state) {
+    cv::Mat frame = synthetic_frame(3840, 2160);
+    const std::vector<float>& output = yolo_output_fixture();
+    std::vector<cv::Rect> rois = yolo_tiles(frame.size(), cv::Rect(), static_cast<int>(state.range(0)), 0.2f);
+    rois.insert(rois.begin(), cv::Rect(cv::Point(), frame.size()));
+    const size_t input_size = static_cast<size_t>(kInputSize) * kInputSize * 3;
+    std::vector<float> batch(rois.size() * input_size);
+    for (auto _ : state) {
+        YoloCandidates candidates;
+        for (size_t i = 0; i < rois.size(); ++i) {
+            yolo_preprocess_into(frame(rois[i]), kInputSize, kInputSize, batch.data() + i * input_size);
+            yolo_decode(output.data(), rois[i], frame.size(), kInputSize, kInputSize, i > 0, candidates);
+        }
+        std::vector<Detection> detections = yolo_nms(candidates);
+        benchmark::DoNotOptimize(detections.data());
+    }
+    state.counters["crops"] = static_cast<double>(rois.size());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TiledPrePostprocess)->Arg(1280)->Arg(960)->Unit(benchmark::kMicrosecond);
+
+void BM_PlayerTrackerUpdate(benchmark::State& state) {
+    const DetectionFixture& fixture = detection_fixture();
+    cv::Mat frame = synthetic_frame(kFrameWidth, kFrameHeight);
+    auto tracker = std::make_unique<PlayerTracker>();
+    size_t i = 0;
+    for (auto _ : state) {
+        if (i == fixture.players.size()) {
+            // Restart the sequence with a fresh tracker so track counts stay realistic
+            state.PauseTiming();
+            tracker = std::make_unique<PlayerTracker>();
+            i = 0;
+            state.ResumeTiming();
+        }
+        tracker->update(fixture.players[i++], frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PlayerTrackerUpdate)->Unit(benchmark::kMicrosecond);
+
+void BM_PlayerTrackerAssignTeams(benchmark::State& state) {
+    const DetectionFixture& fixture = detection_fixture();
+    cv::Mat frame = synthetic_frame(kFrameWidth, kFrameHeight);
+    PlayerTracker tracker;
+    for (size_t i = 0; i < 30 && i < fixture.players.size(); ++i) {
+        tracker.update(fixture.players[i], frame);
+    }
+    for (auto _ : state) {
+        tracker.assign_teams();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PlayerTrackerAssignTeams)->Unit(benchmark::kMicrosecond);
+
+void BM_BallTrackerUpdate(benchmark::State& state) {
+    const DetectionFixture& fixture = detection_fixture();
+    BallTracker tracker;
+    size_t i = 0;
+    for (auto _ : state) {
+        tracker.update(fixture.balls[i]);
+        benchmark::DoNotOptimize(tracker.get_track());
+        i = (i + 1) % fixture.balls.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BallTrackerUpdate);
+
+void BM_CalibrationTransform(benchmark::State& state) {
+    const std::vector<TrackFrame>& frames = track_fixture();
+    Calibration calibration(fixture_path("calibration.yaml"));
+    size_t i = 0;
+    for (auto _ : state) {
+        auto transformed = calibration.transform(frames[i].tracks);
+        benchmark::DoNotOptimize(transformed.data());
+        i = (i + 1) % frames.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CalibrationTransform);
+
+void BM_MetricsProcessFrame(benchmark::State& state) {
+    const std::vector<TrackFrame>& frames = track_fixture();
+    const std::pair<int, cv::Point2f> ball_track(0, cv::Point2f(52.5f, 34.0f));
+    auto metrics = std::make_unique<MetricsCalculator>("");
+    size_t i = 0;
+    for (auto _ : state) {
+        if (i == frames.size()) {
+            // Bound memory: accumulated rows would otherwise grow with the iteration count
+            state.PauseTiming();
+            metrics = std::make_unique<MetricsCalculator>("");
+            i = 0;
+            state.ResumeTiming();
+        }
+        metrics->process_frame(static_cast<int>(i) + 1, 30.0, frames[i].tracks, ball_track, frames[i].team_assignments);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricsProcessFrame)->Unit(benchmark::kMicrosecond);
+
+// Full CSV export of about one million player rows, replaying the track fixture end to end
+void BM_MetricsSaveToCsv(benchmark::State& state) {
+    const std::vector<TrackFrame>& frames = track_fixture();
+    const std::pair<int, cv::Point2f> ball_track(0, cv::Point2f(52.5f, 34.0f));
+    std::string output_dir = (std::filesystem::temp_directory_path() / "bench_metrics_csv").string();
+    std::filesystem::create_directories(output_dir);
+
+    MetricsCalculator metrics(output_dir);
+    size_t rows = 0;
+    for (int frame = 1; rows < 1000000; ++frame) {
+        const TrackFrame& track_frame = frames[(frame - 1) % frames.size()];
+        metrics.process_frame(frame, 30.0, track_frame.tracks, ball_track, track_frame.team_assignments);
+        rows += std::max<size_t>(track_frame.tracks.size(), 1);
+    }
+    for (auto _ : state) {
+        metrics.save_to_csv();
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+    std::filesystem::remove_all(output_dir);
+}
+BENCHMARK(BM_MetricsSaveToCsv)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""End-to-end throughput and output regression harness for the CPU half of the pipeline.
+
+Generates a fixed synthetic match with synth_match (detection dump, static camera), replays it
+through test_runner, and checks:
+
+  * the metric CSVs (OUTPUT_FILES) against golden/ within numeric tolerances
+  * frames/sec against baseline.json, failing on a regression larger than --max-regression (5%)
+
+Peak RSS and per-stage mean latencies are recorded and reported next to the baseline, but only
+throughput and outputs decide pass/fail. Baselines are machine specific: record one on the
+machine that runs the harness (--update-baseline). baseline.json is not committed, while golden/
+is: refresh it deliberately (--update-golden) when a change is meant to alter results. A missing
+golden output or baseline fails the check unless --allow-missing is given.
+
+  bench/regression/run_regression.py --build-dir build --update-baseline
+  bench/regression/run_regression.py --build-dir build
+  bench/regression/run_regression.py --build-dir build --update-golden
+"""
+import argparse
+import csv
+import json
+import os
+import platform
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+GOLDEN_DIR = os.path.join(HERE, "golden")
+BASELINE_PATH = os.path.join(HERE, "baseline.json")
+OUTPUT_FILES = ["player_metrics.csv", "ball_metrics.csv", "player_summary.csv", "player_events.csv",
+                "possession_spells.csv", "team_possession.csv", "passes.csv",
+                "team_shape.csv", "offsides.csv", "pitch_control.csv"]
+# Written only when they have rows; the fixture produces both, but a change that empties one
+# records (or expects) no golden for it rather than breaking --update-golden
+OPTIONAL_FILES = {"team_shape.csv", "pitch_control.csv"}
+# Per-frame outputs are kept in golden/ and compared for every Nth frame only, so golden/ stays small;
+# the cumulative columns still carry the frames in between
+SAMPLED_FILES = {"player_metrics.csv": 25, "ball_metrics.csv": 25, "team_shape.csv": 25}
+# Binary outputs that are only checked for existence: the team heatmaps need team assignments
+REQUIRED_FILES = ["heatmaps/team_Team_A.png", "heatmaps/team_Team_B.png"]
+
+# The synthetic clip: 10 minutes at 25 fps, a full match worth of players, static camera so the
+# generated calibration holds for every frame, and a staged offside every minute so offsides.csv
+# has rows. Changing any of these invalidates golden/.
+SYNTH_ARGS = ["--mode", "detections", "--duration", "600", "--fps", "25", "--players", "22",
+              "--referees", "1", "--no-pan", "--offside-every", "60", "--seed", "7"]
+# Pitch control once a second, so its (comparatively expensive) stage is part of the throughput
+REPLAY_ARGS = ["--pitch-control-interval", "25"]
+
+REPORT_RE = re.compile(r"Processed (\d+) frames at ([0-9.]+) frames/s")
+STAGE_RE = re.compile(r"^(\w+)\s+(\d+)\s+([0-9.]+)\s+([0-9.]+)\s+([0-9.]+)\s+([0-9.]+)\s+([0-9.]+)\s+([0-9.]+)%$")
+
+
+def run_measured(cmd):
+    """Runs cmd and returns (stdout, wall seconds, peak RSS of that process in MB)."""
+    with tempfile.TemporaryFile(mode="w+") as out, tempfile.TemporaryFile(mode="w+") as err:
+        start = time.monotonic()
+        proc = subprocess.Popen(cmd, stdout=out, stderr=err, text=True)
+        # wait4 reports the rusage of exactly this child, unlike RUSAGE_CHILDREN
+        _, status, usage = os.wait4(proc.pid, 0)
+        elapsed = time.monotonic() - start
+        proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+        out.seek(0)
+        err.seek(0)
+        if proc.returncode != 0:
+            sys.stderr.write(err.read())
+            raise RuntimeError("%s exited with %d" % (cmd[0], proc.returncode))
+        return out.read(), elapsed, usage.ru_maxrss / 1024.0
+
+
+def parse_report(stdout):
+    match = REPORT_RE.search(stdout)
+    if not match:
+        raise RuntimeError("test_runner printed no stage report (built without ENABLE_STAGE_PROFILING?)")
+    stages = {}
+    for line in stdout.splitlines():
+        stage = STAGE_RE.match(line.strip())
+        if stage:
+            stages[stage.group(1)] = {"count": int(stage.group(2)), "mean_ms": float(stage.group(3)),
+                                      "p99_ms": float(stage.group(6))}
+    return int(match.group(1)), float(match.group(2)), stages
+
+
+def generate_clip(build_dir, work_dir):
+    dump = os.path.join(work_dir, "synth.bin")
+    calib = os.path.join(work_dir, "synth_calib.yaml")
+    stamp = os.path.join(work_dir, "synth.args")
+    # Regenerate only when the parameters (or the generator binary) changed
+    generator = os.path.join(build_dir, "synth_match")
+    key = " ".join(SYNTH_ARGS) + " %d" % int(os.path.getmtime(generator))
+    if os.path.exists(dump) and os.path.exists(stamp) and open(stamp).read() == key:
+        return dump, calib
+    subprocess.check_call([generator, "--output", dump, "--calib-out", calib] + SYNTH_ARGS,
+                          stdout=subprocess.DEVNULL)
+    with open(stamp, "w") as f:
+        f.write(key)
+    return dump, calib
+
+
+def is_number(text):
+    try:
+        float(text)
+        return True
+    except ValueError:
+        return False
+
+
+def read_csv(path, sample_every=1):
+    """Rows of a CSV; with sample_every > 1 only the header and the rows of every Nth frame."""
+    with open(path, newline="") as f:
+        rows = list(csv.reader(f))
+    if sample_every > 1 and rows:
+        frame = rows[0].index("frame")
+        rows = rows[:1] + [row for row in rows[1:] if int(row[frame]) % sample_every == 0]
+    return rows
+
+
+def write_golden(output_path, golden_path, sample_every=1):
+    if sample_every <= 1:
+        shutil.copyfile(output_path, golden_path)
+        return
+    with open(golden_path, "w", newline="") as f:
+        csv.writer(f, lineterminator="\n").writerows(read_csv(output_path, sample_every))
+
+
+def compare_csv(actual_path, golden_path, rel_tol, abs_tol, sample_every=1, max_reports=10):
+    """Returns a list of human-readable differences (empty when the files match)."""
+    actual = read_csv(actual_path, sample_every)
+    golden = read_csv(golden_path, sample_every)
+
+    name = os.path.basename(golden_path)
+    if not golden or not actual or actual[0] != golden[0]:
+        return ["%s: header differs" % name]
+    diffs = []
+    if len(actual) != len(golden):
+        diffs.append("%s: %d rows, golden has %d" % (name, len(actual) - 1, len(golden) - 1))
+    header = golden[0]
+    for row_idx, (a_row, g_row) in enumerate(zip(actual[1:], golden[1:]), start=2):
+        for col, (a, g) in enumerate(zip(a_row, g_row)):
+            if a == g:
+                continue
+            if is_number(a) and is_number(g):
+                a_val, g_val = float(a), float(g)
+                if abs(a_val - g_val) <= max(abs_tol, rel_tol * abs(g_val)):
+                    continue
+            diffs.append("%s line %d, %s: %s (golden %s)" % (name, row_idx, header[col] if col < len(header) else col, a, g))
+            if len(diffs) >= max_reports:
+                diffs.append("%s: further differences omitted" % name)
+                return diffs
+    return diffs
+
+
+def machine_id():
+    return "%s %s %d cpus" % (platform.node(), platform.processor() or platform.machine(), os.cpu_count() or 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--build-dir", default="build", help="directory containing test_runner and synth_match")
+    parser.add_argument("--work-dir", default=None, help="scratch directory (default: <build-dir>/regression)")
+    parser.add_argument("--runs", type=int, default=3, help="replay runs; the fastest is compared")
+    parser.add_argument("--max-regression", type=float, default=0.05, help="allowed throughput drop vs baseline")
+    parser.add_argument("--rel-tol", type=float, default=1e-4, help="relative tolerance for numeric CSV cells")
+    parser.add_argument("--abs-tol", type=float, default=1e-6, help="absolute tolerance for numeric CSV cells")
+    parser.add_argument("--update-golden", action="store_true", help="replace golden outputs with this run's")
+    parser.add_argument("--update-baseline", action="store_true", help="replace baseline.json with this run's")
+    parser.add_argument("--allow-missing", action="store_true",
+                        help="only note missing golden outputs or baseline instead of failing")
+    parser.add_argument("--report", default=None, help="write the measurements to this JSON file")
+    args = parser.parse_args()
+
+    build_dir = os.path.abspath(args.build_dir)
+    work_dir = os.path.abspath(args.work_dir or os.path.join(build_dir, "regression"))
+    output_dir = os.path.join(work_dir, "output")
+    # Outputs of an earlier run must not stand in for ones this build failed to write
+    shutil.rmtree(output_dir, ignore_errors=True)
+    os.makedirs(output_dir)
+
+    dump, calib = generate_clip(build_dir, work_dir)
+
+    best = None
+    for run in range(max(1, args.runs)):
+        stdout, elapsed, peak_rss_mb = run_measured([os.path.join(build_dir, "test_runner"),
+                                                     "--replay-detections", dump, "--calib", calib,
+                                                     "--output-dir", output_dir] + REPLAY_ARGS)
+        frames, fps, stages = parse_report(stdout)
+        print("run %d: %d frames, %.1f frames/s, %.1fs wall, peak RSS %.1f MB" % (run + 1, frames, fps, elapsed, peak_rss_mb))
+        if best is None or fps > best["frames_per_second"]:
+            best = {"frames": frames, "frames_per_second": fps, "wall_seconds": elapsed,
+                    "peak_rss_mb": peak_rss_mb, "stages": stages}
+    best["machine"] = machine_id()
+
+    failures = []
+
+    # Outputs
+    for name in REQUIRED_FILES:
+        if not os.path.exists(os.path.join(output_dir, name)):
+            failures.append("test_runner wrote no %s" % name)
+    missing = []
+    if args.update_golden:
+        os.makedirs(GOLDEN_DIR, exist_ok=True)
+        for name in OUTPUT_FILES:
+            output_path = os.path.join(output_dir, name)
+            golden_path = os.path.join(GOLDEN_DIR, name)
+            if os.path.exists(output_path):
+                write_golden(output_path, golden_path, SAMPLED_FILES.get(name, 1))
+            elif name in OPTIONAL_FILES:
+                # No rows this time: drop the stale golden so later runs expect none either
+                if os.path.exists(golden_path):
+                    os.remove(golden_path)
+                print("note: test_runner wrote no %s, no golden recorded for it" % name)
+            else:
+                failures.append("test_runner wrote no %s, golden left unchanged" % name)
+        print("Updated golden outputs in %s" % GOLDEN_DIR)
+    else:
+        for name in OUTPUT_FILES:
+            output_path = os.path.join(output_dir, name)
+            golden_path = os.path.join(GOLDEN_DIR, name)
+            if not os.path.exists(output_path):
+                if name not in OPTIONAL_FILES or os.path.exists(golden_path):
+                    failures.append("test_runner wrote no %s" % name)
+            elif not os.path.exists(golden_path):
+                missing.append("golden output %s (record it with --update-golden and commit it)" % golden_path)
+            else:
+                failures.extend(compare_csv(output_path, golden_path, args.rel_tol, args.abs_tol,
+                                            SAMPLED_FILES.get(name, 1)))
+
+    # Throughput
+    if args.update_baseline:
+        with open(BASELINE_PATH, "w") as f:
+            json.dump(best, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Updated baseline %s" % BASELINE_PATH)
+    elif not os.path.exists(BASELINE_PATH):
+        # Baselines are per machine, so a fresh checkout has none
+        missing.append("baseline %s (record one on this machine with --update-baseline)" % BASELINE_PATH)
+    else:
+        with open(BASELINE_PATH) as f:
+            baseline = json.load(f)
+        if baseline.get("machine") != best["machine"]:
+            print("warning: baseline was recorded on '%s', this is '%s'" % (baseline.get("machine"), best["machine"]))
+        ratio = best["frames_per_second"] / baseline["frames_per_second"]
+        print("throughput: %.1f frames/s vs baseline %.1f (%+.1f%%)" %
+              (best["frames_per_second"], baseline["frames_per_second"], (ratio - 1.0) * 100.0))
+        print("peak RSS:   %.1f MB vs baseline %.1f MB" % (best["peak_rss_mb"], baseline["peak_rss_mb"]))
+        for stage, stats in sorted(best["stages"].items()):
+            base = baseline.get("stages", {}).get(stage)
+            if base and base["mean_ms"] > 0:
+                print("  %-16s %9.4f ms vs %9.4f ms (%+.1f%%)" % (stage, stats["mean_ms"], base["mean_ms"],
+                                                                 (stats["mean_ms"] / base["mean_ms"] - 1.0) * 100.0))
+        if ratio < 1.0 - args.max_regression:
+            failures.append("throughput regressed by %.1f%% (limit %.1f%%)" % ((1.0 - ratio) * 100.0, args.max_regression * 100.0))
+
+    for entry in missing:
+        if args.allow_missing:
+            print("note: no %s, check skipped" % entry)
+        else:
+            failures.append("missing %s" % entry)
+
+    if args.report:
+        with open(args.report, "w") as f:
+            json.dump(dict(best, failures=failures), f, indent=2, sort_keys=True)
+            f.write("\n")
+
+    if failures:
+        print("REGRESSION FAILED:")
+        for failure in failures:
+            print("  " + failure)
+        return 1
+    print("Regression check passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,178 @@
+#include "analytics/ball_trajectory.h"
+#include "utils/serialization.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// A constant-acceleration fit is used across a gap only if it passes this close to all its anchors
+const double kMaxFitResidualMeters = 0.5;
+
+// Least-squares quadratic through (t[i], p[i]); returns false if the system is singular
+bool fit_quadratic(const double* t, const cv::Point2f* p, int n, double cx[3], double cy[3]) {
+    double s[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    double bx[3] = {0.0, 0.0, 0.0};
+    double by[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < n; ++i) {
+        double power = 1.0;
+        for (int k = 0; k < 5; ++k) {
+            s[k] += power;
+            if (k < 3) {
+                bx[k] += power * p[i].x;
+                by[k] += power * p[i].y;
+            }
+            power *= t[i];
+        }
+    }
+    const double a[3][3] = {{s[0], s[1], s[2]}, {s[1], s[2], s[3]}, {s[2], s[3], s[4]}};
+    auto det3 = [](const double m[3][3]) {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+               m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    };
+    double det = det3(a);
+    if (std::abs(det) < 1e-12) {
+        return false;
+    }
+    for (int col = 0; col < 3; ++col) {
+        double mx[3][3], my[3][3];
+        for (int r = 0; r < 3; ++r) {
+            for (int k = 0; k < 3; ++k) {
+                mx[r][k] = k == col ? bx[r] : a[r][k];
+                my[r][k] = k == col ? by[r] : a[r][k];
+            }
+        }
+        cx[col] = det3(mx) / det;
+        cy[col] = det3(my) / det;
+    }
+    return true;
+}
+
+} // namespace
+
+void BallTrajectoryFilter::push(int frame, double fps, bool detected, const cv::Point2f& position,
+                                std::vector<BallEstimate>& ready) {
+    fps_ = fps > 0.0 ? fps : fps_;
+    pending_.push_back({frame, detected, position});
+    while (!pending_.empty() && frame - pending_.front().frame >= latency_frames_) {
+        ready.push_back(finalize_front());
+    }
+}
+
+void BallTrajectoryFilter::flush(std::vector<BallEstimate>& ready) {
+    while (!pending_.empty()) {
+        ready.push_back(finalize_front());
+    }
+}
+
+bool BallTrajectoryFilter::plausible(const Sample& a, const Sample& b) const {
+    double seconds = std::abs(b.frame - a.frame) / fps_;
+    return cv::norm(b.position - a.position) <= kMaxBallSpeedMps * std::max(seconds, 1.0 / fps_);
+}
+
+const BallTrajectoryFilter::Sample* BallTrajectoryFilter::next_detection(size_t index, size_t* found) const {
+    for (size_t i = index + 1; i < pending_.size(); ++i) {
+        if (pending_[i].detected) {
+            if (found) {
+                *found = i;
+            }
+            return &pending_[i];
+        }
+    }
+    return nullptr;
+}
+
+BallEstimate BallTrajectoryFilter::finalize_front() {
+    Sample sample = pending_.front();
+    BallEstimate estimate{sample.frame, false, false, cv::Point2f()};
+    const int max_gap_frames = static_cast<int>(kMaxGapSeconds * fps_);
+    const Sample* previous = !accepted_.empty() && sample.frame - accepted_.back().frame <= max_gap_frames
+                                 ? &accepted_.back() : nullptr;
+    size_t next_index = 0;
+    const Sample* next = next_detection(0, &next_index);
+
+    if (sample.detected) {
+        // Outlier: implausible jump from the trajectory, while the next detection continues it
+        bool spike = previous && next && !plausible(*previous, sample) && !plausible(sample, *next) &&
+                     plausible(*previous, *next);
+        if (!spike) {
+            accepted_.push_back(sample);
+            if (accepted_.size() > 2) {
+                accepted_.pop_front();
+            }
+            pending_.pop_front();
+            estimate.valid = true;
+            estimate.position = sample.position;
+            return estimate;
+        }
+    }
+    pending_.pop_front();
+    if (next_index > 0) {
+        --next_index;
+    }
+
+    if (!previous || !next || next->frame - previous->frame > max_gap_frames || !plausible(*previous, *next)) {
+        return estimate;
+    }
+    estimate.valid = true;
+    estimate.interpolated = true;
+
+    // Constant-acceleration fit through two detections on each side, if it explains all four
+    const Sample* before = accepted_.size() == 2 ? &accepted_.front() : nullptr;
+    const Sample* after = next_detection(next_index);
+    if (before && after && previous->frame - before->frame <= max_gap_frames &&
+        after->frame - next->frame <= max_gap_frames) {
+        const Sample* anchors[4] = {before, previous, next, after};
+        double t[4];
+        cv::Point2f p[4];
+        for (int i = 0; i < 4; ++i) {
+            t[i] = (anchors[i]->frame - previous->frame) / fps_;
+            p[i] = anchors[i]->position;
+        }
+        double cx[3], cy[3];
+        if (fit_quadratic(t, p, 4, cx, cy)) {
+            double worst = 0.0;
+            for (int i = 0; i < 4; ++i) {
+                cv::Point2f fitted(static_cast<float>(cx[0] + cx[1] * t[i] + cx[2] * t[i] * t[i]),
+                                   static_cast<float>(cy[0] + cy[1] * t[i] + cy[2] * t[i] * t[i]));
+                worst = std::max(worst, cv::norm(fitted - p[i]));
+            }
+            if (worst <= kMaxFitResidualMeters) {
+                double tau = (sample.frame - previous->frame) / fps_;
+                estimate.position = cv::Point2f(static_cast<float>(cx[0] + cx[1] * tau + cx[2] * tau * tau),
+                                                static_cast<float>(cy[0] + cy[1] * tau + cy[2] * tau * tau));
+                return estimate;
+            }
+        }
+    }
+    float alpha = static_cast<float>(sample.frame - previous->frame) / (next->frame - previous->frame);
+    estimate.position = previous->position + (next->position - previous->position) * alpha;
+    return estimate;
+}
+
+void BallTrajectoryFilter::save_state(std::ostream& out) const {
+    serialization::write_pod(out, fps_);
+    for (const std::deque<Sample>* samples : {&pending_, &accepted_}) {
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(samples->size()));
+        for (const Sample& sample : *samples) {
+            serialization::write_pod<int32_t>(out, sample.frame);
+            serialization::write_pod<uint8_t>(out, sample.detected ? 1 : 0);
+            serialization::write_point(out, sample.position);
+        }
+    }
+}
+
+void BallTrajectoryFilter::load_state(std::istream& in) {
+    fps_ = serialization::read_pod<double>(in);
+    for (std::deque<Sample>* samples : {&pending_, &accepted_}) {
+        samples->clear();
+        uint32_t count = serialization::read_pod<uint32_t>(in);
+        for (uint32_t i = 0; i < count; ++i) {
+            Sample sample;
+            sample.frame = serialization::read_pod<int32_t>(in);
+            sample.detected = serialization::read_pod<uint8_t>(in) != 0;
+            sample.position = serialization::read_point(in);
+            samples->push_back(sample);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef BALL_TRAJECTORY_H
+#define BALL_TRAJECTORY_H
+
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Refined ball position for one frame
+struct BallEstimate {
+    int frame;
+    bool valid;        // false: no detection and the gap could not be bridged
+    bool interpolated; // filled in between detections rather than detected
+    cv::Point2f position;
+};
+
+// Cleans up the ball trajectory from raw per-frame detections (in calibrated meters) with a fixed
+// look-ahead of `latency_frames`:
+//  - A detection that jumps away from the trajectory faster than a ball can travel and jumps back
+//    on the next detection (a head or a sock mistaken for the ball) is rejected.
+//  - Frames without an accepted detection between two detections at most kMaxGapSeconds apart are
+//    filled in: with a constant-acceleration fit through two detections on each side when they
+//    agree with one (a pass or a rolling ball), otherwise linearly (a touch during the gap).
+// Each frame is final once `latency_frames` later frames have been pushed. With a latency of at
+// least kMaxGapSeconds every bridgeable gap is filled, which makes it the offline refinement; a
+// shorter latency bounds the delay for online use and only fills gaps that fit in it.
+class BallTrajectoryFilter {
+public:
+    static constexpr double kMaxGapSeconds = 1.5;
+    static constexpr double kMaxBallSpeedMps = 40.0;
+
+    explicit BallTrajectoryFilter(int latency_frames = 0) : latency_frames_(latency_frames) {}
+
+    int latency_frames() const { return latency_frames_; }
+
+    // Adds the detection for `frame` (`detected` false if there was none) and appends the frames
+    // that became final, in frame order, to `ready`
+    void push(int frame, double fps, bool detected, const cv::Point2f& position, std::vector<BallEstimate>& ready);
+
+    // Finalizes every pending frame (end of input)
+    void flush(std::vector<BallEstimate>& ready);
+
+    // Checkpoint support
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
+private:
+    struct Sample {
+        int frame;
+        bool detected;
+        cv::Point2f position;
+    };
+
+    // Finalizes the oldest pending frame
+    BallEstimate finalize_front();
+    // The first detection after pending_[index], or nullptr
+    const Sample* next_detection(size_t index, size_t* found = nullptr) const;
+    bool plausible(const Sample& a, const Sample& b) const;
+
+    int latency_frames_;
+    double fps_ = 30.0;
+    std::deque<Sample> pending_; // frames not yet final, oldest first
+    std::deque<Sample> accepted_; // last accepted detections (at most two), oldest first
+};
+
+#endif // BALL_TRAJECTORY_H
@@ -0,0 +1,78 @@
+#include "analytics/heatmap.h"
+#include "utils/serialization.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+Heatmap::Heatmap(float cell_size, float length, float width)
+    : cell_size_(cell_size), length_(length), width_(width) {
+    if (cell_size <= 0.0f) {
+        throw std::invalid_argument("Heatmap cell size must be positive.");
+    }
+    cols_ = std::max(1, static_cast<int>(std::ceil(length / cell_size)));
+    rows_ = std::max(1, static_cast<int>(std::ceil(width / cell_size)));
+    counts_.assign(static_cast<size_t>(rows_) * cols_, 0);
+}
+
+cv::Mat Heatmap::to_image(int pixels_per_cell) const {
+    cv::Mat intensity(rows_, cols_, CV_8UC1, cv::Scalar(0));
+    uint32_t max_count = counts_.empty() ? 0 : *std::max_element(counts_.begin(), counts_.end());
+    if (max_count > 0) {
+        double scale = 255.0 / std::sqrt(static_cast<double>(max_count));
+        for (int row = 0; row < rows_; ++row) {
+            uint8_t* pixels = intensity.ptr<uint8_t>(row);
+            for (int col = 0; col < cols_; ++col) {
+                pixels[col] = static_cast<uint8_t>(std::lround(std::sqrt(static_cast<double>(count(col, row))) * scale));
+            }
+        }
+    }
+
+    cv::Mat colored;
+    cv::applyColorMap(intensity, colored, cv::COLORMAP_INFERNO);
+    cv::Mat image;
+    cv::resize(colored, image, cv::Size(cols_ * pixels_per_cell, rows_ * pixels_per_cell), 0, 0, cv::INTER_NEAREST);
+    return image;
+}
+
+bool Heatmap::write_png(const std::string& path, int pixels_per_cell) const {
+    if (total_ == 0) {
+        return false;
+    }
+    if (!cv::imwrite(path, to_image(pixels_per_cell))) {
+        std::cerr << "Error: Could not write heatmap " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Heatmap::save_state(std::ostream& out) const {
+    serialization::write_pod(out, cell_size_);
+    serialization::write_pod(out, length_);
+    serialization::write_pod(out, width_);
+    uint32_t non_zero = static_cast<uint32_t>(counts_.size() - std::count(counts_.begin(), counts_.end(), 0u));
+    serialization::write_pod(out, non_zero);
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i] != 0) {
+            serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(i));
+            serialization::write_pod(out, counts_[i]);
+        }
+    }
+}
+
+void Heatmap::load_state(std::istream& in) {
+    float cell_size = serialization::read_pod<float>(in);
+    float length = serialization::read_pod<float>(in);
+    float width = serialization::read_pod<float>(in);
+    *this = Heatmap(cell_size, length, width);
+    uint32_t non_zero = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < non_zero; ++i) {
+        uint32_t index = serialization::read_pod<uint32_t>(in);
+        uint32_t value = serialization::read_pod<uint32_t>(in);
+        if (index >= counts_.size()) {
+            throw std::runtime_error("Corrupt heatmap state.");
+        }
+        counts_[index] = value;
+        total_ += value;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Pitch dimensions in calibrated (meter) coordinates
+const float kPitchLengthMeters = 105.0f;
+const float kPitchWidthMeters = 68.0f;
+
+// Occupancy grid over the pitch: number of samples per cell. Samples slightly outside the pitch
+// (run-off areas, calibration error at the touchlines) land in the nearest edge cell; samples
+// further out are dropped.
+class Heatmap {
+public:
+    static constexpr float kMarginMeters = 5.0f;
+
+    Heatmap() = default;
+    explicit Heatmap(float cell_size, float length = kPitchLengthMeters, float width = kPitchWidthMeters);
+
+    // Constant time: one bounds check and one increment
+    void add(const cv::Point2f& position) {
+        if (position.x < -kMarginMeters || position.y < -kMarginMeters ||
+            position.x > length_ + kMarginMeters || position.y > width_ + kMarginMeters) {
+            return;
+        }
+        int col = std::min(std::max(static_cast<int>(position.x / cell_size_), 0), cols_ - 1);
+        int row = std::min(std::max(static_cast<int>(position.y / cell_size_), 0), rows_ - 1);
+        ++counts_[static_cast<size_t>(row) * cols_ + col];
+        ++total_;
+    }
+
+    bool empty() const { return counts_.empty(); }
+    float cell_size() const { return cell_size_; }
+    int cols() const { return cols_; }
+    int rows() const { return rows_; }
+    uint64_t total() const { return total_; }
+    uint32_t count(int col, int row) const { return counts_[static_cast<size_t>(row) * cols_ + col]; }
+
+    // Color-mapped BGR image, one `pixels_per_cell` square per cell, x to the right and y down.
+    // Counts are square-root scaled so that rarely visited areas stay visible.
+    cv::Mat to_image(int pixels_per_cell) const;
+    bool write_png(const std::string& path, int pixels_per_cell) const;
+
+    // Checkpoint support (non-zero cells only)
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
+private:
+    float cell_size_ = 1.0f;
+    float length_ = kPitchLengthMeters;
+    float width_ = kPitchWidthMeters;
+    int cols_ = 0;
+    int rows_ = 0;
+    std::vector<uint32_t> counts_; // row-major
+    uint64_t total_ = 0;
+};
+
+#endif // HEATMAP_H
@@ -1,210 +1,642 @@
 #include "analytics/metrics.h"
 #include "csv.h"
+#include "utils/columnar.h"
+#include "utils/csv_writer.h"
+#include "utils/serialization.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <cmath>
 
+namespace {
+
+// Columns of player_metrics.csv / player_metrics.fcol in their stable DB-friendly order
+const std::vector<std::string> kPlayerColumns = {
+    "frame",
+    "player_id",
+    "x",
+    "y",
+    "team",
+    "minutes_played",
+    "shots",
+    "shots_on_target",
+    "passes",
+    "accurate_passes",
+    "tackles",
+    "interceptions",
+    "clearances",
+    "saves",
+    "fouls_committed",
+    "fouls_suffered",
+    "offsides",
+    "distance_meters",
+    "total_distance_meters",
+    "distance_covered_km",
+    "player_xg",
+    "key_passes",
+    "progressive_carries",
+    "press_resistance_success_rate",
+    "defensive_coverage_km",
+    "notes",
+    "rating",
+    "speed_mps",
+    "acceleration_mps2"
+};
+
+// DB-oriented placeholder fields (events detection not implemented here). These defaults match
+// the schema and are persisted as zeros/nulls.
+const std::vector<std::string> kZeroCountColumns = {
+    "shots", "shots_on_target", "tackles", "clearances", "saves", "fouls_committed", "fouls_suffered",
+    "key_passes", "progressive_carries"
+};
+const std::vector<std::string> kZeroRatioColumns = {
+    "player_xg", "press_resistance_success_rate", "defensive_coverage_km", "rating"
+};
+
+const std::vector<std::string> kSummaryColumns = {
+    "player_id", "team", "frames", "minutes_played", "distance_meters", "top_speed_mps", "sprint_count",
+    "high_intensity_run_count", "acceleration_count", "deceleration_count", "walking_distance_meters",
+    "jogging_distance_meters", "running_distance_meters", "high_speed_distance_meters", "sprint_distance_meters"
+};
+
+const std::vector<std::string> kEventColumns = {
+    "player_id", "event", "start_frame", "end_frame", "duration_seconds", "peak", "distance_meters"
+};
+
+// Load events are runs of samples past a threshold lasting a minimum duration. A run only ends
+// once the value drops below the (lower) exit threshold, so jitter around the entry threshold does
+// not split one effort into several. Deceleration thresholds apply to the negated acceleration.
+struct LoadEventRule {
+    const char* name;
+    bool on_acceleration; // false: speed (m/s), true: acceleration (m/s^2)
+    double sign;
+    double enter;
+    double exit;
+    double min_seconds;
+};
+
+const LoadEventRule kLoadEventRules[] = {
+    {"sprint", false, 1.0, 7.0, 6.0, 1.0},             // 25.2 km/h
+    {"high_intensity_run", false, 1.0, 5.5, 5.0, 1.0}, // 19.8 km/h
+    {"acceleration", true, 1.0, 2.0, 1.0, 0.5},
+    {"deceleration", true, -1.0, 2.0, 1.0, 0.5},
+};
+const int kSprintRule = 0;
+const int kHighIntensityRunRule = 1;
+const int kAccelerationRule = 2;
+const int kDecelerationRule = 3;
+
+// Heatmap PNGs are rendered at this many pixels per meter; players need this much time on the
+// pitch to get their own image (the binary export has every track)
+const int kHeatmapPixelsPerMeter = 8;
+const double kMinHeatmapImageSeconds = 60.0;
+
+// Team names become file names
+std::string file_name_safe(const std::string& name) {
+    std::string safe = name;
+    for (char& c : safe) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-') {
+            c = '_';
+        }
+    }
+    return safe;
+}
+
+// Upper speed limits (m/s) of the walking, jogging, running and high-speed bands; the rest is sprinting
+const double kSpeedBandLimits[] = {2.0, 4.0, 5.5, 7.0};
+
+// A track unseen for longer than this restarts its smoothing window instead of fitting across the gap
+const double kMaxTrackGapSeconds = 1.0;
+
+// Samples beyond these come from tracking glitches (ID switches, calibration edges), not players
+const double kMaxPlausibleSpeedMps = 12.5;
+const double kMaxPlausibleAccelerationMps2 = 10.0;
+
+// team_shape.csv / team_shape.fcol: frame, team and players, then these float columns
+const std::pair<const char*, float TeamShape::*> kTeamShapeFloatColumns[] = {
+    {"centroid_x", &TeamShape::centroid_x},
+    {"centroid_y", &TeamShape::centroid_y},
+    {"width_meters", &TeamShape::width_meters},
+    {"length_meters", &TeamShape::length_meters},
+    {"hull_area_m2", &TeamShape::hull_area_m2},
+    {"stretch_index_meters", &TeamShape::stretch_index_meters},
+    {"defensive_line_meters", &TeamShape::defensive_line_meters},
+    {"attacking_line_meters", &TeamShape::attacking_line_meters},
+};
+
+// Table of shapes[from..]
+ColumnTable team_shape_table(const std::vector<TeamShape>& shapes, size_t from = 0) {
+    size_t n = shapes.size() - from;
+    std::vector<int32_t> frame(n), players(n);
+    std::vector<std::string> team(n);
+    for (size_t i = 0; i < n; ++i) {
+        frame[i] = shapes[from + i].frame;
+        team[i] = shapes[from + i].team;
+        players[i] = shapes[from + i].players;
+    }
+    ColumnTable table(n);
+    table.add_column("frame", std::move(frame));
+    table.add_column("team", std::move(team));
+    table.add_column("players", std::move(players));
+    for (const auto& [column, member] : kTeamShapeFloatColumns) {
+        std::vector<float> values(n);
+        for (size_t i = 0; i < n; ++i) {
+            values[i] = shapes[from + i].*member;
+        }
+        table.add_column(column, std::move(values));
+    }
+    return table;
+}
+
+std::vector<TeamShape> team_shapes_from_table(const ColumnTable& table) {
+    std::vector<TeamShape> shapes(table.num_rows());
+    const auto& frame = table.int32_column("frame");
+    const auto& team = table.string_column("team");
+    const auto& players = table.int32_column("players");
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        shapes[i].frame = frame[i];
+        shapes[i].team = team[i];
+        shapes[i].players = players[i];
+    }
+    for (const auto& [column, member] : kTeamShapeFloatColumns) {
+        const auto& values = table.float32_column(column);
+        for (size_t i = 0; i < shapes.size(); ++i) {
+            shapes[i].*member = values[i];
+        }
+    }
+    return shapes;
+}
+
+// The two teams with the most players in the frame, in name order (referees and stray labels have
+// fewer players); ties go to the name that sorts first. Returns false if fewer than two teams are present.
+template <typename T>
+bool two_largest_teams(const std::map<std::string, std::vector<T>>& players_by_team, std::array<std::string, 2>& teams) {
+    const std::string* first = nullptr;
+    const std::string* second = nullptr;
+    size_t first_size = 0, second_size = 0;
+    for (const auto& [team, players] : players_by_team) {
+        if (players.size() > first_size) {
+            second = first;
+            second_size = first_size;
+            first = &team;
+            first_size = players.size();
+        } else if (players.size() > second_size) {
+            second = &team;
+            second_size = players.size();
+        }
+    }
+    if (second == nullptr) {
+        return false;
+    }
+    teams = {*first, *second};
+    std::sort(teams.begin(), teams.end());
+    return true;
+}
+
+} // namespace
+
 MetricsCalculator::MetricsCalculator(const std::string& output_dir) : output_dir_(output_dir) {}
 
 void MetricsCalculator::process_frame(int frame_count, double fps, const std::vector<std::pair<int, cv::Point2f>>& player_tracks, const std::pair<int, cv::Point2f>& ball_track, const std::map<int, std::string>& team_assignments) {
     // Update fps (in case frames are processed with different sources)
     video_fps_ = fps > 0.0 ? fps : video_fps_;
 
+    // Compare against the last evaluation rather than using a modulo, which frame skipping could step over
+    const bool pitch_control_due = pitch_control_interval_ > 0 &&
+        (last_pitch_control_frame_ < 0 || frame_count - last_pitch_control_frame_ >= pitch_control_interval_);
+    std::map<std::string, std::vector<PitchControlPlayer>> pitch_control_players;
+    // Scratch per-team position lists keep their capacity from frame to frame
+    for (auto& [team, positions] : team_positions_) {
+        positions.clear();
+        team_player_ids_[team].clear();
+    }
+
     // Process player metrics
     for (const auto& track : player_tracks) {
-        std::map<std::string, std::string> player_metric;
-        player_metric["frame"] = std::to_string(frame_count);
-        player_metric["player_id"] = std::to_string(track.first);
-        player_metric["x"] = std::to_string(track.second.x);
-        player_metric["y"] = std::to_string(track.second.y);
+        PlayerFrameMetrics player_metric;
+        player_metric.frame = frame_count;
+        player_metric.player_id = track.first;
+        player_metric.x = track.second.x;
+        player_metric.y = track.second.y;
+
+        PlayerAggregate& aggregate = player_aggregates_[track.first];
 
         // Add team assignment
         auto it_team = team_assignments.find(track.first);
         if (it_team != team_assignments.end()) {
-            player_metric["team"] = it_team->second;
+            player_metric.team = it_team->second;
+            aggregate.team = it_team->second;
         } else {
-            player_metric["team"] = "Unknown";
+            player_metric.team = "Unknown";
+        }
+
+        // Occupancy heatmaps in calibrated coordinates
+        if (aggregate.heatmap.empty()) {
+            aggregate.heatmap = Heatmap(heatmap_cell_size_);
+        }
+        aggregate.heatmap.add(track.second);
+        if (it_team != team_assignments.end()) {
+            Heatmap& team_heatmap = team_heatmaps_[it_team->second];
+            if (team_heatmap.empty()) {
+                team_heatmap = Heatmap(heatmap_cell_size_);
+            }
+            team_heatmap.add(track.second);
+            team_positions_[it_team->second].push_back(track.second);
+            team_player_ids_[it_team->second].push_back(track.first);
         }
 
-        // Calculate speed and distance
-        double speed_mps = 0.0;
+        // Calculate speed and distance from the smoothed track: raw position deltas carry the
+        // tracker/homography jitter, which shows up as speed spikes and inflated distance
         double distance_meters = 0.0;
         double total_distance_meters = 0.0;
 
         auto it_last_pos = last_player_positions_.find(track.first);
         auto it_last_frame = last_player_frame_counts_.find(track.first);
 
+        SavitzkyGolayFilter& filter = player_filters_[track.first];
+        bool after_gap = it_last_frame != last_player_frame_counts_.end() &&
+                         (frame_count - it_last_frame->second) / video_fps_ > kMaxTrackGapSeconds;
+        if (after_gap) {
+            filter.reset();
+        }
+        SavitzkyGolayFilter::Estimate estimate = filter.update(frame_count / video_fps_, track.second);
+
         if (it_last_pos != last_player_positions_.end() && it_last_frame != last_player_frame_counts_.end()) {
             // Calculate distance covered in this frame interval
-            distance_meters = cv::norm(track.second - it_last_pos->second);
-            
-            // Calculate time elapsed between last processed frame and current frame
-            double delta_frames = frame_count - it_last_frame->second;
-            double delta_time = delta_frames / fps;
-
-            // Calculate speed (meters per second)
-            if (delta_time > 0) {
-                speed_mps = distance_meters / delta_time;
-            }
+            distance_meters = cv::norm(estimate.position - it_last_pos->second);
 
             // Update total distance
-            player_total_distances_[track.first] += distance_meters;
-            total_distance_meters = player_total_distances_[track.first];
-        } else {
-            // Initialize total distance for new player
-            player_total_distances_[track.first] = 0.0;
-        }
-
-        player_metric["speed_mps"] = std::to_string(speed_mps);
-        player_metric["distance_meters"] = std::to_string(distance_meters);
-        player_metric["total_distance_meters"] = std::to_string(total_distance_meters);
-
-        // Increment frame count seen for this player
-        player_frame_counts_[track.first] += 1;
-
-        // Fill DB-oriented placeholder fields (events detection not implemented here)
-        // These defaults match the schema and will be persisted as zeros/nulls
-        player_metric["minutes_played"] = ""; // computed at export time
-        player_metric["shots"] = "0";
-        player_metric["shots_on_target"] = "0";
-        player_metric["passes"] = "0";
-        player_metric["accurate_passes"] = "0";
-        player_metric["tackles"] = "0";
-        player_metric["interceptions"] = "0";
-        player_metric["clearances"] = "0";
-        player_metric["saves"] = "0";
-        player_metric["fouls_committed"] = "0";
-        player_metric["fouls_suffered"] = "0";
-        player_metric["offsides"] = "0";
-        player_metric["player_xg"] = "0.0";
-        player_metric["key_passes"] = "0";
-        player_metric["progressive_carries"] = "0";
-        player_metric["press_resistance_success_rate"] = "0.0";
-        player_metric["defensive_coverage_km"] = "0.0";
-        player_metric["notes"] = "";
-        player_metric["rating"] = "0.0";
+            aggregate.total_distance_meters += distance_meters;
+            total_distance_meters = aggregate.total_distance_meters;
+        }
+
+        double speed_mps = cv::norm(estimate.velocity);
+        double acceleration_mps2 = 0.0;
+        if (speed_mps > 1e-3) {
+            // Component of the acceleration along the direction of travel
+            acceleration_mps2 = estimate.velocity.dot(estimate.acceleration) / speed_mps;
+        }
+
+        player_metric.speed_mps = speed_mps;
+        player_metric.acceleration_mps2 = acceleration_mps2;
+        player_metric.distance_meters = distance_meters;
+        player_metric.total_distance_meters = total_distance_meters;
+
+        update_aggregate(track.first, aggregate, frame_count, speed_mps, acceleration_mps2, distance_meters, after_gap);
 
         // Update last position and frame count for next frame's calculation
-        last_player_positions_[track.first] = track.second;
+        last_player_positions_[track.first] = estimate.position;
         last_player_frame_counts_[track.first] = frame_count;
 
+        if (pitch_control_due && it_team != team_assignments.end()) {
+            pitch_control_players[it_team->second].push_back({estimate.position, estimate.velocity, -1});
+        }
+
         player_metrics_.push_back(player_metric);
     }
 
-    // Process ball metrics
-    if (ball_track.first != -1) {
-        std::map<std::string, std::string> ball_metric;
-        ball_metric["frame"] = std::to_string(frame_count);
-        ball_metric["x"] = std::to_string(ball_track.second.x);
-        ball_metric["y"] = std::to_string(ball_track.second.y);
-        ball_metrics_.push_back(ball_metric);
+    update_team_shapes(frame_count, ball_track);
+    if (pitch_control_due) {
+        update_pitch_control(frame_count, pitch_control_players);
+    }
+
+    // Ball-dependent analytics run on the refined trajectory, `latency_frames` behind
+    if (!refine_ball_) {
+        process_ball(frame_count, player_tracks, ball_track, team_assignments, false);
+        return;
+    }
+    delayed_frames_.push_back({frame_count, player_tracks, team_assignments});
+    std::vector<BallEstimate> ready;
+    ball_filter_.push(frame_count, video_fps_, ball_track.first != -1, ball_track.second, ready);
+    process_ball_estimates(ready);
+}
+
+void MetricsCalculator::set_ball_latency(int latency_frames) {
+    refine_ball_ = latency_frames > 0;
+    ball_filter_ = BallTrajectoryFilter(latency_frames);
+}
+
+void MetricsCalculator::finish() {
+    if (!refine_ball_) {
+        return;
+    }
+    std::vector<BallEstimate> ready;
+    ball_filter_.flush(ready);
+    process_ball_estimates(ready);
+}
+
+void MetricsCalculator::process_ball_estimates(const std::vector<BallEstimate>& estimates) {
+    for (const BallEstimate& estimate : estimates) {
+        // Estimates come out in push order, one per delayed frame
+        DelayedFrame& delayed = delayed_frames_.front();
+        process_ball(delayed.frame, delayed.player_tracks,
+                     {estimate.valid ? 0 : -1, estimate.position}, delayed.team_assignments, estimate.interpolated);
+        delayed_frames_.pop_front();
+    }
+}
+
+void MetricsCalculator::process_ball(int frame_count, const std::vector<std::pair<int, cv::Point2f>>& player_tracks,
+                                     const std::pair<int, cv::Point2f>& ball_track,
+                                     const std::map<int, std::string>& team_assignments, bool interpolated) {
+    if (ball_track.first == -1) {
+        return;
+    }
+    int possessor = possession_.update(frame_count, video_fps_, player_tracks, ball_track, team_assignments);
+    size_t known_passes = pass_detector_.passes().size();
+    pass_detector_.update(possession_, video_fps_);
+    if (pass_detector_.passes().size() > known_passes) {
+        offside_.on_pass(pass_detector_.passes().back());
+    }
+    ball_metrics_.push_back({frame_count, ball_track.second.x, ball_track.second.y, possessor, interpolated});
+}
+
+void MetricsCalculator::update_aggregate(int player_id, PlayerAggregate& aggregate, int frame_count, double speed_mps,
+                                         double acceleration_mps2, double distance_meters, bool after_gap) {
+    aggregate.frames += 1;
+    bool glitch = speed_mps > kMaxPlausibleSpeedMps || std::abs(acceleration_mps2) > kMaxPlausibleAccelerationMps2;
+    if (!glitch) {
+        aggregate.top_speed_mps = std::max(aggregate.top_speed_mps, speed_mps);
+    }
+
+    int band = std::upper_bound(std::begin(kSpeedBandLimits), std::end(kSpeedBandLimits), speed_mps) -
+               std::begin(kSpeedBandLimits);
+    aggregate.band_distance_meters[band] += distance_meters;
+
+    for (int rule = 0; rule < kNumLoadEventTypes; ++rule) {
+        const LoadEventRule& spec = kLoadEventRules[rule];
+        EventRun& run = aggregate.runs[rule];
+        double value = spec.sign * (spec.on_acceleration ? acceleration_mps2 : speed_mps);
+
+        bool in_run = run.start_frame >= 0;
+        if (in_run && (glitch || after_gap || value < spec.exit)) {
+            if (run.confirmed) {
+                load_events_.push_back(make_event(player_id, rule, run));
+            }
+            run = EventRun();
+            in_run = false;
+        }
+        if (glitch || value < (in_run ? spec.exit : spec.enter)) {
+            continue;
+        }
+        if (!in_run) {
+            run.start_frame = frame_count;
+        }
+        run.last_frame = frame_count;
+        run.peak = std::max(run.peak, value);
+        run.distance_meters += distance_meters;
+        if (!run.confirmed && (frame_count - run.start_frame) / video_fps_ >= spec.min_seconds) {
+            run.confirmed = true;
+            aggregate.event_counts[rule] += 1;
+        }
+    }
+}
+
+LoadEvent MetricsCalculator::make_event(int player_id, int rule, const EventRun& run) const {
+    return {player_id, kLoadEventRules[rule].name, run.start_frame, run.last_frame,
+            (run.last_frame - run.start_frame) / video_fps_, run.peak, run.distance_meters};
+}
+
+std::vector<LoadEvent> MetricsCalculator::load_events() const {
+    std::vector<LoadEvent> events = load_events_;
+    for (const auto& [player_id, aggregate] : player_aggregates_) {
+        for (int rule = 0; rule < kNumLoadEventTypes; ++rule) {
+            if (aggregate.runs[rule].confirmed) {
+                events.push_back(make_event(player_id, rule, aggregate.runs[rule]));
+            }
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const LoadEvent& a, const LoadEvent& b) {
+        return a.start_frame != b.start_frame ? a.start_frame < b.start_frame : a.player_id < b.player_id;
+    });
+    return events;
+}
+
+int MetricsCalculator::minutes_played(int player_id) const {
+    auto it = player_aggregates_.find(player_id);
+    if (video_fps_ > 0 && it != player_aggregates_.end() && it->second.frames > 0) {
+        double seconds = static_cast<double>(it->second.frames) / video_fps_;
+        return static_cast<int>(seconds / 60.0);
+    }
+    return 0;
+}
+
+double MetricsCalculator::total_distance_km(int player_id) const {
+    auto it = player_aggregates_.find(player_id);
+    return it != player_aggregates_.end() ? it->second.total_distance_meters / 1000.0 : 0.0;
+}
+
+std::map<int, MetricsCalculator::PlayerRowTotals> MetricsCalculator::player_row_totals() const {
+    std::map<int, PlayerRowTotals> totals;
+    for (const auto& [player_id, aggregate] : player_aggregates_) {
+        PlayerRowTotals& entry = totals[player_id];
+        entry.minutes_played = minutes_played(player_id);
+        entry.distance_km = total_distance_km(player_id);
+        entry.pass_counts = pass_detector_.counts(player_id);
+        entry.offsides = offside_.count(player_id);
+    }
+    return totals;
+}
+
+std::vector<PlayerSummary> MetricsCalculator::player_summaries() const {
+    std::vector<PlayerSummary> summaries;
+    summaries.reserve(player_aggregates_.size());
+    for (const auto& [player_id, aggregate] : player_aggregates_) {
+        double minutes = video_fps_ > 0 ? aggregate.frames / video_fps_ / 60.0 : 0.0;
+        const auto& counts = aggregate.event_counts;
+        const auto& bands = aggregate.band_distance_meters;
+        summaries.push_back({player_id, aggregate.team, aggregate.frames, minutes, aggregate.total_distance_meters,
+                             aggregate.top_speed_mps, counts[kSprintRule], counts[kHighIntensityRunRule],
+                             counts[kAccelerationRule], counts[kDecelerationRule], bands[0], bands[1], bands[2],
+                             bands[3], bands[4]});
+    }
+    return summaries;
+}
+
+std::vector<PlayerSummary> MetricsCalculator::load_player_summaries(const std::string& path) {
+    std::vector<PlayerSummary> summaries;
+    try {
+        io::CSVReader<15> in(path);
+        in.read_header(io::ignore_extra_column, "player_id", "team", "frames", "minutes_played",
+                       "distance_meters", "top_speed_mps", "sprint_count", "high_intensity_run_count",
+                       "acceleration_count", "deceleration_count", "walking_distance_meters",
+                       "jogging_distance_meters", "running_distance_meters", "high_speed_distance_meters",
+                       "sprint_distance_meters");
+        PlayerSummary summary;
+        while (in.read_row(summary.player_id, summary.team, summary.frames, summary.minutes_played,
+                           summary.distance_meters, summary.top_speed_mps, summary.sprint_count,
+                           summary.high_intensity_run_count, summary.acceleration_count,
+                           summary.deceleration_count, summary.walking_distance_meters,
+                           summary.jogging_distance_meters, summary.running_distance_meters,
+                           summary.high_speed_distance_meters, summary.sprint_distance_meters)) {
+            summaries.push_back(summary);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Could not read player summary " << path << ": " << e.what() << std::endl;
+        summaries.clear();
+    }
+    return summaries;
+}
+
+void MetricsCalculator::set_csv_precision(const std::string& column, int digits) {
+    csv_precision_[column] = digits;
+}
+
+void MetricsCalculator::set_pitch_control(int interval_frames, PitchControlModel model, float cell_size,
+                                          bool write_grids) {
+    pitch_control_interval_ = interval_frames;
+    pitch_control_grids_ = write_grids;
+    pitch_control_ = PitchControl(cell_size, model);
+}
+
+void MetricsCalculator::update_team_shapes(int frame_count, const std::pair<int, cv::Point2f>& ball_track) {
+    std::vector<std::pair<int, float>> offside_players;
+    std::array<std::string, 2> teams;
+    if (!two_largest_teams(team_positions_, teams)) {
+        offside_.record(frame_count, video_fps_, offside_players);
+        return;
+    }
+    const std::vector<cv::Point2f>& first = team_positions_[teams[0]];
+    const std::vector<cv::Point2f>& second = team_positions_[teams[1]];
+    // Each team is assumed to defend the goal on its own side of the other team
+    float first_x = 0.0f, second_x = 0.0f;
+    for (const cv::Point2f& p : first) {
+        first_x += p.x;
+    }
+    for (const cv::Point2f& p : second) {
+        second_x += p.x;
+    }
+    const bool first_defends_left = first_x / first.size() <= second_x / second.size();
+
+    std::array<TeamShape, 2> shapes;
+    std::array<bool, 2> computed;
+    for (int i = 0; i < 2; ++i) {
+        shapes[i].frame = frame_count;
+        shapes[i].team = teams[i];
+        bool defends_left = i == 0 ? first_defends_left : !first_defends_left;
+        computed[i] = team_shape_calculator_.compute(i == 0 ? first : second, defends_left, kPitchLengthMeters,
+                                                     shapes[i]);
+        if (computed[i]) {
+            team_shapes_.push_back(shapes[i]);
+        }
+    }
+
+    // Offside positions reuse the second-last defender found for the shape: an attacker in the
+    // opponents' half is offside when nearer to their goal line than both the ball and that defender
+    if (computed[0] && computed[1]) {
+        for (int attackers = 0; attackers < 2; ++attackers) {
+            const bool defenders_left = attackers == 0 ? !first_defends_left : first_defends_left;
+            // Depth from the defenders' goal line
+            auto depth = [&](float x) { return defenders_left ? x : kPitchLengthMeters - x; };
+            float line = std::min(shapes[1 - attackers].defensive_line_meters, kPitchLengthMeters / 2.0f);
+            if (ball_track.first != -1) {
+                line = std::min(line, depth(ball_track.second.x));
+            }
+            const std::vector<cv::Point2f>& positions = team_positions_[teams[attackers]];
+            const std::vector<int>& ids = team_player_ids_[teams[attackers]];
+            for (size_t j = 0; j < positions.size(); ++j) {
+                float player_depth = depth(positions[j].x);
+                if (player_depth < line) {
+                    offside_players.push_back({ids[j], line - player_depth});
+                }
+            }
+        }
+    }
+    offside_.record(frame_count, video_fps_, offside_players);
+}
+
+void MetricsCalculator::update_pitch_control(
+    int frame_count, const std::map<std::string, std::vector<PitchControlPlayer>>& players) {
+    last_pitch_control_frame_ = frame_count;
+
+    std::array<std::string, 2> teams;
+    if (!two_largest_teams(players, teams)) {
+        return;
+    }
+    std::vector<PitchControlPlayer> input;
+    for (int team = 0; team < 2; ++team) {
+        for (const PitchControlPlayer& player : players.at(teams[team])) {
+            input.push_back({player.position, player.velocity, team});
+        }
+    }
+    if (!pitch_control_.compute(input)) {
+        return;
+    }
+    pitch_control_frames_.push_back({frame_count, teams, {pitch_control_.area(0), pitch_control_.area(1)}});
+
+    if (pitch_control_grids_) {
+        std::string grid_dir = output_dir_ + "/pitch_control";
+        std::error_code ec;
+        std::filesystem::create_directories(grid_dir, ec);
+        std::string path = grid_dir + "/frame_" + std::to_string(frame_count) + ".png";
+        if (ec || !cv::imwrite(path, pitch_control_.to_image())) {
+            std::cerr << "Error: Could not write pitch control grid " << path << std::endl;
+        }
     }
 }
 
+int MetricsCalculator::csv_precision(const std::string& column) const {
+    auto it = csv_precision_.find(column);
+    return it != csv_precision_.end() ? it->second : default_csv_precision_;
+}
+
 void MetricsCalculator::save_to_csv() {
     // Save player metrics
     if (!player_metrics_.empty()) {
-        std::ofstream file(output_dir_ + "/player_metrics.csv");
+        CsvWriter file(output_dir_ + "/player_metrics.csv");
         if (file.is_open()) {
-            // Write header in a stable DB-friendly order
-            std::vector<std::string> header = {
-                "frame",
-                "player_id",
-                "x",
-                "y",
-                "team",
-                "minutes_played",
-                "shots",
-                "shots_on_target",
-                "passes",
-                "accurate_passes",
-                "tackles",
-                "interceptions",
-                "clearances",
-                "saves",
-                "fouls_committed",
-                "fouls_suffered",
-                "offsides",
-                "distance_meters",
-                "total_distance_meters",
-                "distance_covered_km",
-                "player_xg",
-                "key_passes",
-                "progressive_carries",
-                "press_resistance_success_rate",
-                "defensive_coverage_km",
-                "notes",
-                "rating"
-            };
-
             // write header
-            for (size_t i = 0; i < header.size(); ++i) {
-                if (i) file << ",";
-                file << header[i];
+            for (const std::string& column : kPlayerColumns) {
+                file.field(column);
             }
-            file << std::endl;
+            file.end_row();
 
-            // Aggregate per-player totals to compute minutes and km and then write rows
-            // We'll compute minutes_played per player based on frames seen and video_fps_
-            std::map<int, int> frames_seen;
-            for (const auto& m : player_metrics_) {
-                int pid = std::stoi(m.at("player_id"));
-                frames_seen[pid] = player_frame_counts_[pid];
-            }
+            const int x_precision = csv_precision("x");
+            const int y_precision = csv_precision("y");
+            const int distance_precision = csv_precision("distance_meters");
+            const int total_distance_precision = csv_precision("total_distance_meters");
+            const int km_precision = csv_precision("distance_covered_km");
+            const int speed_precision = csv_precision("speed_mps");
+            const int acceleration_precision = csv_precision("acceleration_mps2");
 
-            for (const auto& m : player_metrics_) {
-                int pid = std::stoi(m.at("player_id"));
-                // To avoid duplicate player-level rows, we will still emit per-frame rows
-                // but fill minutes and distance_covered_km using cumulative data for that player.
-                // distance_covered_km = total_distance_meters / 1000.0
-                double total_m = player_total_distances_[pid];
-                double dist_km = total_m / 1000.0;
-                int minutes = 0;
-                if (video_fps_ > 0 && frames_seen[pid] > 0) {
-                    double seconds = static_cast<double>(frames_seen[pid]) / video_fps_;
-                    minutes = static_cast<int>(seconds / 60.0);
-                }
+            // Per-player export values are looked up once per player, not once per row
+            std::map<int, PlayerRowTotals> player_totals = player_row_totals();
 
+            for (const auto& m : player_metrics_) {
+                // To avoid duplicate player-level rows, we still emit per-frame rows but fill
+                // minutes and distance_covered_km using cumulative data for that player.
                 // Write values in header order
-                std::vector<std::string> row_vals;
-                row_vals.push_back(m.at("frame"));
-                row_vals.push_back(m.at("player_id"));
-                row_vals.push_back(m.at("x"));
-                row_vals.push_back(m.at("y"));
-                row_vals.push_back(m.at("team"));
-                row_vals.push_back(std::to_string(minutes));
-                row_vals.push_back(m.at("shots"));
-                row_vals.push_back(m.at("shots_on_target"));
-                row_vals.push_back(m.at("passes"));
-                row_vals.push_back(m.at("accurate_passes"));
-                row_vals.push_back(m.at("tackles"));
-                row_vals.push_back(m.at("interceptions"));
-                row_vals.push_back(m.at("clearances"));
-                row_vals.push_back(m.at("saves"));
-                row_vals.push_back(m.at("fouls_committed"));
-                row_vals.push_back(m.at("fouls_suffered"));
-                row_vals.push_back(m.at("offsides"));
-                // distance_meters
-                row_vals.push_back(m.at("distance_meters"));
-                // total_distance_meters
-                row_vals.push_back(m.at("total_distance_meters"));
-                // distance_covered_km
-                row_vals.push_back(std::to_string(dist_km));
-                row_vals.push_back(m.at("player_xg"));
-                row_vals.push_back(m.at("key_passes"));
-                row_vals.push_back(m.at("progressive_carries"));
-                row_vals.push_back(m.at("press_resistance_success_rate"));
-                row_vals.push_back(m.at("defensive_coverage_km"));
-                row_vals.push_back(m.at("notes"));
-                row_vals.push_back(m.at("rating"));
-
-                for (size_t i = 0; i < row_vals.size(); ++i) {
-                    if (i) file << ",";
-                    file << row_vals[i];
-                }
-                file << std::endl;
+                const auto& totals = player_totals[m.player_id];
+                file.field(m.frame);
+                file.field(m.player_id);
+                file.field(m.x, x_precision);
+                file.field(m.y, y_precision);
+                file.field(m.team);
+                file.field(totals.minutes_played);
+                // shots, shots_on_target
+                file.field(std::string_view("0,0"));
+                file.field(totals.pass_counts.passes);
+                file.field(totals.pass_counts.accurate_passes);
+                // tackles
+                file.field(std::string_view("0"));
+                file.field(totals.pass_counts.interceptions);
+                // clearances .. fouls_suffered
+                file.field(std::string_view("0,0,0,0"));
+                file.field(totals.offsides);
+                file.field(m.distance_meters, distance_precision);
+                file.field(m.total_distance_meters, total_distance_precision);
+                file.field(totals.distance_km, km_precision);
+                // player_xg, key_passes, progressive_carries, press_resistance_success_rate,
+                // defensive_coverage_km, notes, rating
+                file.field(std::string_view("0.0,0,0,0.0,0.0,,0.0"));
+                file.field(m.speed_mps, speed_precision);
+                file.field(m.acceleration_mps2, acceleration_precision);
+                file.end_row();
+            }
+            if (!file.close()) {
+                std::cerr << "Error: Failed to write player_metrics.csv." << std::endl;
             }
-            file.close();
         } else {
             std::cerr << "Error: Could not open player_metrics.csv for writing." << std::endl;
         }
@@ -212,30 +644,576 @@ void MetricsCalculator::save_to_csv() {
 
     // Save ball metrics
     if (!ball_metrics_.empty()) {
-        std::ofstream file(output_dir_ + "/ball_metrics.csv");
+        CsvWriter file(output_dir_ + "/ball_metrics.csv");
         if (file.is_open()) {
-            // Write header
-            bool first_col = true;
-            for (auto const& [key, val] : ball_metrics_[0]) {
-                if (!first_col) file << ",";
-                file << key;
-                first_col = false;
+            const int x_precision = csv_precision("x");
+            const int y_precision = csv_precision("y");
+            file.field(std::string_view("frame,x,y,possessor_id,interpolated"));
+            file.end_row();
+            for (const auto& metric : ball_metrics_) {
+                file.field(metric.frame);
+                file.field(metric.x, x_precision);
+                file.field(metric.y, y_precision);
+                file.field(metric.possessor_id);
+                file.field(metric.interpolated ? 1 : 0);
+                file.end_row();
+            }
+            if (!file.close()) {
+                std::cerr << "Error: Failed to write ball_metrics.csv." << std::endl;
             }
-            file << std::endl;
+        } else {
+            std::cerr << "Error: Could not open ball_metrics.csv for writing." << std::endl;
+        }
+    }
 
-            // Write data
-            for (const auto& metric : ball_metrics_) {
-                bool first_col = true;
-                for (auto const& [key, val] : metric) {
-                    if (!first_col) file << ",";
-                    file << val;
-                    first_col = false;
+    // Save possession spells and team shares
+    if (!ball_metrics_.empty()) {
+        possession_.save_to_csv(output_dir_, csv_precision("duration_seconds"));
+        pass_detector_.save_to_csv(output_dir_, csv_precision("distance_meters"));
+        offside_.save_to_csv(output_dir_, csv_precision("margin_meters"));
+    }
+
+    // Save team shapes (two rows per frame)
+    if (!team_shapes_.empty()) {
+        CsvWriter file(output_dir_ + "/team_shape.csv");
+        if (file.is_open()) {
+            file.field(std::string_view("frame,team,players"));
+            std::vector<int> precisions;
+            for (const auto& [column, member] : kTeamShapeFloatColumns) {
+                file.field(std::string_view(column));
+                precisions.push_back(csv_precision(column));
+            }
+            file.end_row();
+            for (const TeamShape& shape : team_shapes_) {
+                file.field(shape.frame);
+                file.field(shape.team);
+                file.field(shape.players);
+                for (size_t i = 0; i < precisions.size(); ++i) {
+                    file.field(shape.*kTeamShapeFloatColumns[i].second, precisions[i]);
                 }
-                file << std::endl;
+                file.end_row();
+            }
+            if (!file.close()) {
+                std::cerr << "Error: Failed to write team_shape.csv." << std::endl;
             }
-            file.close();
         } else {
-            std::cerr << "Error: Could not open ball_metrics.csv for writing." << std::endl;
+            std::cerr << "Error: Could not open team_shape.csv for writing." << std::endl;
+        }
+    }
+
+    // Save pitch control areas (two rows per evaluated frame)
+    if (!pitch_control_frames_.empty()) {
+        CsvWriter file(output_dir_ + "/pitch_control.csv");
+        if (file.is_open()) {
+            file.field(std::string_view("frame,team,area_m2,area_percent"));
+            file.end_row();
+            const int area_precision = csv_precision("area_m2");
+            const int percent_precision = csv_precision("area_percent");
+            for (const PitchControlFrame& entry : pitch_control_frames_) {
+                const double total = entry.area_m2[0] + entry.area_m2[1];
+                for (int team = 0; team < 2; ++team) {
+                    file.field(entry.frame);
+                    file.field(entry.teams[team]);
+                    file.field(entry.area_m2[team], area_precision);
+                    file.field(total > 0.0 ? 100.0 * entry.area_m2[team] / total : 0.0, percent_precision);
+                    file.end_row();
+                }
+            }
+            if (!file.close()) {
+                std::cerr << "Error: Failed to write pitch_control.csv." << std::endl;
+            }
+        } else {
+            std::cerr << "Error: Could not open pitch_control.csv for writing." << std::endl;
+        }
+    }
+
+    // Save per-player summary (one row per player)
+    if (!player_aggregates_.empty()) {
+        CsvWriter file(output_dir_ + "/player_summary.csv");
+        if (file.is_open()) {
+            for (const std::string& column : kSummaryColumns) {
+                file.field(column);
+            }
+            file.end_row();
+            const int minutes_precision = csv_precision("minutes_played");
+            const int distance_precision = csv_precision("distance_meters");
+            const int speed_precision = csv_precision("top_speed_mps");
+            for (const PlayerSummary& summary : player_summaries()) {
+                file.field(summary.player_id);
+                file.field(summary.team);
+                file.field(summary.frames);
+                file.field(summary.minutes_played, minutes_precision);
+                file.field(summary.distance_meters, distance_precision);
+                file.field(summary.top_speed_mps, speed_precision);
+                file.field(summary.sprint_count);
+                file.field(summary.high_intensity_run_count);
+                file.field(summary.acceleration_count);
+                file.field(summary.deceleration_count);
+                file.field(summary.walking_distance_meters, distance_precision);
+                file.field(summary.jogging_distance_meters, distance_precision);
+                file.field(summary.running_distance_meters, distance_precision);
+                file.field(summary.high_speed_distance_meters, distance_precision);
+                file.field(summary.sprint_distance_meters, distance_precision);
+                file.end_row();
+            }
+            if (!file.close()) {
+                std::cerr << "Error: Failed to write player_summary.csv." << std::endl;
+            }
+        } else {
+            std::cerr << "Error: Could not open player_summary.csv for writing." << std::endl;
+        }
+
+        // Save load events (one row per event)
+        CsvWriter events_file(output_dir_ + "/player_events.csv");
+        if (events_file.is_open()) {
+            for (const std::string& column : kEventColumns) {
+                events_file.field(column);
+            }
+            events_file.end_row();
+            const int duration_precision = csv_precision("duration_seconds");
+            const int peak_precision = csv_precision("peak");
+            const int distance_precision = csv_precision("distance_meters");
+            for (const LoadEvent& event : load_events()) {
+                events_file.field(event.player_id);
+                events_file.field(event.type);
+                events_file.field(event.start_frame);
+                events_file.field(event.end_frame);
+                events_file.field(event.duration_seconds, duration_precision);
+                events_file.field(event.peak, peak_precision);
+                events_file.field(event.distance_meters, distance_precision);
+                events_file.end_row();
+            }
+            if (!events_file.close()) {
+                std::cerr << "Error: Failed to write player_events.csv." << std::endl;
+            }
+        } else {
+            std::cerr << "Error: Could not open player_events.csv for writing." << std::endl;
+        }
+    }
+}
+
+void MetricsCalculator::save_heatmaps() {
+    std::vector<std::string> scope, id;
+    std::vector<int32_t> col, row, count;
+    auto append_cells = [&](const char* heatmap_scope, const std::string& heatmap_id, const Heatmap& heatmap) {
+        for (int r = 0; r < heatmap.rows(); ++r) {
+            for (int c = 0; c < heatmap.cols(); ++c) {
+                if (heatmap.count(c, r) == 0) {
+                    continue;
+                }
+                scope.push_back(heatmap_scope);
+                id.push_back(heatmap_id);
+                col.push_back(c);
+                row.push_back(r);
+                count.push_back(static_cast<int32_t>(heatmap.count(c, r)));
+            }
+        }
+    };
+    for (const auto& [team, heatmap] : team_heatmaps_) {
+        append_cells("team", team, heatmap);
+    }
+    for (const auto& [player_id, aggregate] : player_aggregates_) {
+        append_cells("player", std::to_string(player_id), aggregate.heatmap);
+    }
+    if (scope.empty()) {
+        return;
+    }
+
+    size_t n = scope.size();
+    ColumnTable table(n);
+    table.add_column("scope", std::move(scope));
+    table.add_column("id", std::move(id));
+    table.add_column("col", std::move(col));
+    table.add_column("row", std::move(row));
+    table.add_column("count", std::move(count));
+    table.add_column("cell_size_meters", std::vector<float>(n, heatmap_cell_size_));
+    table.write_file(output_dir_ + "/heatmaps.fcol");
+
+    std::string image_dir = output_dir_ + "/heatmaps";
+    std::error_code ec;
+    std::filesystem::create_directories(image_dir, ec);
+    if (ec) {
+        std::cerr << "Error: Could not create " << image_dir << ": " << ec.message() << std::endl;
+        return;
+    }
+    int pixels_per_cell = std::max(1, static_cast<int>(std::lround(kHeatmapPixelsPerMeter * heatmap_cell_size_)));
+    for (const auto& [team, heatmap] : team_heatmaps_) {
+        heatmap.write_png(image_dir + "/team_" + file_name_safe(team) + ".png", pixels_per_cell);
+    }
+    for (const auto& [player_id, aggregate] : player_aggregates_) {
+        if (aggregate.frames >= kMinHeatmapImageSeconds * video_fps_) {
+            aggregate.heatmap.write_png(image_dir + "/player_" + std::to_string(player_id) + ".png", pixels_per_cell);
+        }
+    }
+}
+
+void MetricsCalculator::save_to_columnar() {
+    if (!player_metrics_.empty()) {
+        size_t n = player_metrics_.size();
+        std::vector<int32_t> frame(n), player_id(n), minutes(n), passes(n), accurate_passes(n), interceptions(n),
+            offsides(n);
+        std::vector<float> x(n), y(n);
+        std::vector<std::string> team(n);
+        std::vector<double> distance(n), total_distance(n), distance_km(n), speed(n), acceleration(n);
+        std::map<int, PlayerRowTotals> player_totals = player_row_totals();
+        for (size_t i = 0; i < n; ++i) {
+            const PlayerFrameMetrics& m = player_metrics_[i];
+            const PlayerRowTotals& totals = player_totals[m.player_id];
+            frame[i] = m.frame;
+            player_id[i] = m.player_id;
+            x[i] = m.x;
+            y[i] = m.y;
+            team[i] = m.team;
+            minutes[i] = totals.minutes_played;
+            passes[i] = totals.pass_counts.passes;
+            accurate_passes[i] = totals.pass_counts.accurate_passes;
+            interceptions[i] = totals.pass_counts.interceptions;
+            offsides[i] = totals.offsides;
+            speed[i] = m.speed_mps;
+            acceleration[i] = m.acceleration_mps2;
+            distance[i] = m.distance_meters;
+            total_distance[i] = m.total_distance_meters;
+            distance_km[i] = totals.distance_km;
+        }
+
+        ColumnTable table(n);
+        for (const std::string& column : kPlayerColumns) {
+            if (column == "frame") table.add_column(column, std::move(frame));
+            else if (column == "player_id") table.add_column(column, std::move(player_id));
+            else if (column == "x") table.add_column(column, std::move(x));
+            else if (column == "y") table.add_column(column, std::move(y));
+            else if (column == "team") table.add_column(column, std::move(team));
+            else if (column == "minutes_played") table.add_column(column, std::move(minutes));
+            else if (column == "passes") table.add_column(column, std::move(passes));
+            else if (column == "accurate_passes") table.add_column(column, std::move(accurate_passes));
+            else if (column == "interceptions") table.add_column(column, std::move(interceptions));
+            else if (column == "offsides") table.add_column(column, std::move(offsides));
+            else if (column == "distance_meters") table.add_column(column, std::move(distance));
+            else if (column == "total_distance_meters") table.add_column(column, std::move(total_distance));
+            else if (column == "distance_covered_km") table.add_column(column, std::move(distance_km));
+            else if (column == "speed_mps") table.add_column(column, std::move(speed));
+            else if (column == "acceleration_mps2") table.add_column(column, std::move(acceleration));
+            else if (column == "notes") table.add_column(column, std::vector<std::string>(n));
+            else if (std::find(kZeroRatioColumns.begin(), kZeroRatioColumns.end(), column) != kZeroRatioColumns.end())
+                table.add_column(column, std::vector<float>(n, 0.0f));
+            else if (std::find(kZeroCountColumns.begin(), kZeroCountColumns.end(), column) != kZeroCountColumns.end())
+                table.add_column(column, std::vector<int32_t>(n, 0));
+        }
+        table.write_file(output_dir_ + "/player_metrics.fcol");
+    }
+
+    if (!ball_metrics_.empty()) {
+        size_t n = ball_metrics_.size();
+        std::vector<int32_t> frame(n), possessor(n), interpolated(n);
+        std::vector<float> x(n), y(n);
+        for (size_t i = 0; i < n; ++i) {
+            frame[i] = ball_metrics_[i].frame;
+            x[i] = ball_metrics_[i].x;
+            y[i] = ball_metrics_[i].y;
+            possessor[i] = ball_metrics_[i].possessor_id;
+            interpolated[i] = ball_metrics_[i].interpolated ? 1 : 0;
+        }
+        ColumnTable table(n);
+        table.add_column("frame", std::move(frame));
+        table.add_column("x", std::move(x));
+        table.add_column("y", std::move(y));
+        table.add_column("possessor_id", std::move(possessor));
+        table.add_column("interpolated", std::move(interpolated));
+        table.write_file(output_dir_ + "/ball_metrics.fcol");
+    }
+
+    if (!team_shapes_.empty()) {
+        team_shape_table(team_shapes_).write_file(output_dir_ + "/team_shape.fcol");
+    }
+}
+
+void MetricsCalculator::save_state(std::ostream& out) const {
+    serialization::write_pod(out, video_fps_);
+
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(last_player_positions_.size()));
+    for (const auto& [player_id, position] : last_player_positions_) {
+        serialization::write_pod<int32_t>(out, player_id);
+        serialization::write_point(out, position);
+    }
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(player_filters_.size()));
+    for (const auto& [player_id, filter] : player_filters_) {
+        serialization::write_pod<int32_t>(out, player_id);
+        filter.save_state(out);
+    }
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(last_player_frame_counts_.size()));
+    for (const auto& [player_id, frame] : last_player_frame_counts_) {
+        serialization::write_pod<int32_t>(out, player_id);
+        serialization::write_pod<int32_t>(out, frame);
+    }
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(player_aggregates_.size()));
+    for (const auto& [player_id, aggregate] : player_aggregates_) {
+        serialization::write_pod<int32_t>(out, player_id);
+        serialization::write_string(out, aggregate.team);
+        serialization::write_pod<int32_t>(out, aggregate.frames);
+        serialization::write_pod(out, aggregate.total_distance_meters);
+        serialization::write_pod(out, aggregate.top_speed_mps);
+        for (int rule = 0; rule < kNumLoadEventTypes; ++rule) {
+            const EventRun& run = aggregate.runs[rule];
+            serialization::write_pod<int32_t>(out, run.start_frame);
+            serialization::write_pod<int32_t>(out, run.last_frame);
+            serialization::write_pod<uint8_t>(out, run.confirmed ? 1 : 0);
+            serialization::write_pod(out, run.peak);
+            serialization::write_pod(out, run.distance_meters);
+            serialization::write_pod<int32_t>(out, aggregate.event_counts[rule]);
+        }
+        for (double distance : aggregate.band_distance_meters) {
+            serialization::write_pod(out, distance);
+        }
+        aggregate.heatmap.save_state(out);
+    }
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(team_heatmaps_.size()));
+    for (const auto& [team, heatmap] : team_heatmaps_) {
+        serialization::write_string(out, team);
+        heatmap.save_state(out);
+    }
+    possession_.save_state(out);
+    pass_detector_.save_state(out);
+    serialization::write_pod<int32_t>(out, last_pitch_control_frame_);
+    offside_.save_state(out);
+    ball_filter_.save_state(out);
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(delayed_frames_.size()));
+    for (const DelayedFrame& delayed : delayed_frames_) {
+        serialization::write_pod<int32_t>(out, delayed.frame);
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(delayed.player_tracks.size()));
+        for (const auto& [player_id, position] : delayed.player_tracks) {
+            serialization::write_pod<int32_t>(out, player_id);
+            serialization::write_point(out, position);
+        }
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(delayed.team_assignments.size()));
+        for (const auto& [player_id, team] : delayed.team_assignments) {
+            serialization::write_pod<int32_t>(out, player_id);
+            serialization::write_string(out, team);
+        }
+    }
+}
+
+void MetricsCalculator::load_state(std::istream& in) {
+    video_fps_ = serialization::read_pod<double>(in);
+
+    last_player_positions_.clear();
+    uint32_t count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        int player_id = serialization::read_pod<int32_t>(in);
+        last_player_positions_[player_id] = serialization::read_point(in);
+    }
+    player_filters_.clear();
+    count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        int player_id = serialization::read_pod<int32_t>(in);
+        player_filters_[player_id].load_state(in);
+    }
+    last_player_frame_counts_.clear();
+    count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        int player_id = serialization::read_pod<int32_t>(in);
+        last_player_frame_counts_[player_id] = serialization::read_pod<int32_t>(in);
+    }
+    player_aggregates_.clear();
+    count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        int player_id = serialization::read_pod<int32_t>(in);
+        PlayerAggregate& aggregate = player_aggregates_[player_id];
+        aggregate.team = serialization::read_string(in);
+        aggregate.frames = serialization::read_pod<int32_t>(in);
+        aggregate.total_distance_meters = serialization::read_pod<double>(in);
+        aggregate.top_speed_mps = serialization::read_pod<double>(in);
+        for (int rule = 0; rule < kNumLoadEventTypes; ++rule) {
+            EventRun& run = aggregate.runs[rule];
+            run.start_frame = serialization::read_pod<int32_t>(in);
+            run.last_frame = serialization::read_pod<int32_t>(in);
+            run.confirmed = serialization::read_pod<uint8_t>(in) != 0;
+            run.peak = serialization::read_pod<double>(in);
+            run.distance_meters = serialization::read_pod<double>(in);
+            aggregate.event_counts[rule] = serialization::read_pod<int32_t>(in);
+        }
+        for (double& distance : aggregate.band_distance_meters) {
+            distance = serialization::read_pod<double>(in);
+        }
+        aggregate.heatmap.load_state(in);
+    }
+    team_heatmaps_.clear();
+    count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string team = serialization::read_string(in);
+        team_heatmaps_[team].load_state(in);
+    }
+    possession_.load_state(in);
+    pass_detector_.load_state(in);
+    last_pitch_control_frame_ = serialization::read_pod<int32_t>(in);
+    offside_.load_state(in);
+    ball_filter_.load_state(in);
+    delayed_frames_.clear();
+    count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        DelayedFrame delayed;
+        delayed.frame = serialization::read_pod<int32_t>(in);
+        uint32_t tracks = serialization::read_pod<uint32_t>(in);
+        for (uint32_t j = 0; j < tracks; ++j) {
+            int player_id = serialization::read_pod<int32_t>(in);
+            delayed.player_tracks.push_back({player_id, serialization::read_point(in)});
+        }
+        uint32_t assignments = serialization::read_pod<uint32_t>(in);
+        for (uint32_t j = 0; j < assignments; ++j) {
+            int player_id = serialization::read_pod<int32_t>(in);
+            delayed.team_assignments[player_id] = serialization::read_string(in);
+        }
+        delayed_frames_.push_back(std::move(delayed));
+    }
+}
+
+void MetricsCalculator::save_new_rows(std::ostream& out) const {
+    // Rows not yet persisted, as column tables (RLE/dictionary encoded)
+    size_t n = player_metrics_.size() - saved_player_rows_;
+    std::vector<int32_t> frame(n), player_id(n);
+    std::vector<float> x(n), y(n);
+    std::vector<std::string> team(n);
+    std::vector<double> speed(n), acceleration(n), distance(n), total_distance(n);
+    for (size_t i = 0; i < n; ++i) {
+        const PlayerFrameMetrics& m = player_metrics_[saved_player_rows_ + i];
+        frame[i] = m.frame;
+        player_id[i] = m.player_id;
+        x[i] = m.x;
+        y[i] = m.y;
+        team[i] = m.team;
+        speed[i] = m.speed_mps;
+        acceleration[i] = m.acceleration_mps2;
+        distance[i] = m.distance_meters;
+        total_distance[i] = m.total_distance_meters;
+    }
+    ColumnTable players(n);
+    players.add_column("frame", std::move(frame));
+    players.add_column("player_id", std::move(player_id));
+    players.add_column("x", std::move(x));
+    players.add_column("y", std::move(y));
+    players.add_column("team", std::move(team));
+    players.add_column("speed_mps", std::move(speed));
+    players.add_column("acceleration_mps2", std::move(acceleration));
+    players.add_column("distance_meters", std::move(distance));
+    players.add_column("total_distance_meters", std::move(total_distance));
+    players.write(out);
+
+    std::vector<int32_t> ball_frame, ball_possessor, ball_interpolated;
+    std::vector<float> ball_x, ball_y;
+    for (size_t i = saved_ball_rows_; i < ball_metrics_.size(); ++i) {
+        const BallFrameMetrics& m = ball_metrics_[i];
+        ball_frame.push_back(m.frame);
+        ball_x.push_back(m.x);
+        ball_y.push_back(m.y);
+        ball_possessor.push_back(m.possessor_id);
+        ball_interpolated.push_back(m.interpolated ? 1 : 0);
+    }
+    ColumnTable balls(ball_frame.size());
+    balls.add_column("frame", std::move(ball_frame));
+    balls.add_column("x", std::move(ball_x));
+    balls.add_column("y", std::move(ball_y));
+    balls.add_column("possessor_id", std::move(ball_possessor));
+    balls.add_column("interpolated", std::move(ball_interpolated));
+    balls.write(out);
+
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(load_events_.size() - saved_load_events_));
+    for (size_t i = saved_load_events_; i < load_events_.size(); ++i) {
+        const LoadEvent& event = load_events_[i];
+        serialization::write_pod<int32_t>(out, event.player_id);
+        serialization::write_string(out, event.type);
+        serialization::write_pod<int32_t>(out, event.start_frame);
+        serialization::write_pod<int32_t>(out, event.end_frame);
+        serialization::write_pod(out, event.duration_seconds);
+        serialization::write_pod(out, event.peak);
+        serialization::write_pod(out, event.distance_meters);
+    }
+    serialization::write_pod<uint32_t>(
+        out, static_cast<uint32_t>(pitch_control_frames_.size() - saved_pitch_control_frames_));
+    for (size_t i = saved_pitch_control_frames_; i < pitch_control_frames_.size(); ++i) {
+        const PitchControlFrame& entry = pitch_control_frames_[i];
+        serialization::write_pod<int32_t>(out, entry.frame);
+        for (int team = 0; team < 2; ++team) {
+            serialization::write_string(out, entry.teams[team]);
+            serialization::write_pod(out, entry.area_m2[team]);
+        }
+    }
+    team_shape_table(team_shapes_, saved_team_shapes_).write(out);
+    possession_.save_new_rows(out);
+    pass_detector_.save_new_rows(out);
+    offside_.save_new_rows(out);
+}
+
+void MetricsCalculator::mark_rows_saved() {
+    saved_player_rows_ = player_metrics_.size();
+    saved_ball_rows_ = ball_metrics_.size();
+    saved_load_events_ = load_events_.size();
+    saved_pitch_control_frames_ = pitch_control_frames_.size();
+    saved_team_shapes_ = team_shapes_.size();
+    possession_.mark_rows_saved();
+    pass_detector_.mark_rows_saved();
+    offside_.mark_rows_saved();
+    rows_saved_ = true;
+}
+
+void MetricsCalculator::load_rows(std::istream& in) {
+    player_metrics_.clear();
+    ball_metrics_.clear();
+    load_events_.clear();
+    pitch_control_frames_.clear();
+    team_shapes_.clear();
+    while (in.peek() != std::char_traits<char>::eof()) {
+        ColumnTable players = ColumnTable::read(in);
+        const auto& frame = players.int32_column("frame");
+        const auto& player_id = players.int32_column("player_id");
+        const auto& x = players.float32_column("x");
+        const auto& y = players.float32_column("y");
+        const auto& team = players.string_column("team");
+        const auto& speed = players.float64_column("speed_mps");
+        const auto& acceleration = players.float64_column("acceleration_mps2");
+        const auto& distance = players.float64_column("distance_meters");
+        const auto& total_distance = players.float64_column("total_distance_meters");
+        for (size_t i = 0; i < players.num_rows(); ++i) {
+            player_metrics_.push_back({frame[i], player_id[i], x[i], y[i], team[i], speed[i], acceleration[i],
+                                       distance[i], total_distance[i]});
+        }
+
+        ColumnTable balls = ColumnTable::read(in);
+        const auto& ball_frame = balls.int32_column("frame");
+        const auto& ball_x = balls.float32_column("x");
+        const auto& ball_y = balls.float32_column("y");
+        const auto& ball_possessor = balls.int32_column("possessor_id");
+        const auto& ball_interpolated = balls.int32_column("interpolated");
+        for (size_t i = 0; i < balls.num_rows(); ++i) {
+            ball_metrics_.push_back({ball_frame[i], ball_x[i], ball_y[i], ball_possessor[i],
+                                     ball_interpolated[i] != 0});
+        }
+
+        uint32_t count = serialization::read_pod<uint32_t>(in);
+        for (uint32_t i = 0; i < count; ++i) {
+            LoadEvent event;
+            event.player_id = serialization::read_pod<int32_t>(in);
+            event.type = serialization::read_string(in);
+            event.start_frame = serialization::read_pod<int32_t>(in);
+            event.end_frame = serialization::read_pod<int32_t>(in);
+            event.duration_seconds = serialization::read_pod<double>(in);
+            event.peak = serialization::read_pod<double>(in);
+            event.distance_meters = serialization::read_pod<double>(in);
+            load_events_.push_back(event);
+        }
+        count = serialization::read_pod<uint32_t>(in);
+        for (uint32_t i = 0; i < count; ++i) {
+            PitchControlFrame entry;
+            entry.frame = serialization::read_pod<int32_t>(in);
+            for (int team = 0; team < 2; ++team) {
+                entry.teams[team] = serialization::read_string(in);
+                entry.area_m2[team] = serialization::read_pod<double>(in);
+            }
+            pitch_control_frames_.push_back(entry);
         }
+        std::vector<TeamShape> shapes = team_shapes_from_table(ColumnTable::read(in));
+        team_shapes_.insert(team_shapes_.end(), shapes.begin(), shapes.end());
+        possession_.load_rows(in);
+        pass_detector_.load_rows(in);
+        offside_.load_rows(in);
     }
+    mark_rows_saved();
 }
@@ -1,10 +1,82 @@
 #ifndef METRICS_H
 #define METRICS_H
 
+#include <array>
+#include <deque>
+#include <istream>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <map>
 #include <opencv2/opencv.hpp>
+#include "analytics/ball_trajectory.h"
+#include "analytics/heatmap.h"
+#include "analytics/offside.h"
+#include "analytics/pass_detector.h"
+#include "analytics/pitch_control.h"
+#include "analytics/team_shape.h"
+#include "analytics/possession.h"
+#include "utils/savgol_filter.h"
+
+// Per-frame player measurements; export-time fields (minutes played, km covered) and the
+// event placeholder columns are filled in when saving
+struct PlayerFrameMetrics {
+    int frame;
+    int player_id;
+    float x;
+    float y;
+    std::string team;
+    double speed_mps;
+    double acceleration_mps2; // rate of change of speed, negative when decelerating
+    double distance_meters;
+    double total_distance_meters;
+};
+
+struct BallFrameMetrics {
+    int frame;
+    float x;
+    float y;
+    int possessor_id; // player in possession after this frame, -1 if the ball is loose
+    bool interpolated; // gap filled between detections (see set_ball_latency)
+};
+
+// Whole-match totals for one player, maintained incrementally by process_frame
+struct PlayerSummary {
+    int player_id;
+    std::string team;
+    int frames;
+    double minutes_played;
+    double distance_meters;
+    double top_speed_mps;
+    int sprint_count;
+    int high_intensity_run_count;
+    int acceleration_count;
+    int deceleration_count;
+    // Distance split by speed band: <2, 2-4, 4-5.5, 5.5-7 and >=7 m/s
+    double walking_distance_meters;
+    double jogging_distance_meters;
+    double running_distance_meters;
+    double high_speed_distance_meters;
+    double sprint_distance_meters;
+};
+
+// One physical-load event (sprint, high_intensity_run, acceleration or deceleration) of a player
+struct LoadEvent {
+    int player_id;
+    std::string type;
+    int start_frame;
+    int end_frame;
+    double duration_seconds;
+    double peak;            // peak speed (m/s) for runs, peak |acceleration| (m/s^2) otherwise
+    double distance_meters; // covered during the event
+};
+
+// Pitch control of one evaluated frame: the two teams (in name order) and the area each controls
+struct PitchControlFrame {
+    int frame;
+    std::array<std::string, 2> teams;
+    std::array<double, 2> area_m2;
+};
 
 class MetricsCalculator {
 public:
@@ -12,17 +84,174 @@ public:
 
     void process_frame(int frame_count, double fps, const std::vector<std::pair<int, cv::Point2f>>& player_tracks, const std::pair<int, cv::Point2f>& ball_track, const std::map<int, std::string>& team_assignments);
 
+    // Refines the ball trajectory before the ball-dependent analytics (possession, passes,
+    // offsides, ball rows) with a BallTrajectoryFilter of this look-ahead. process_frame then
+    // expects raw ball detections (BallTracker::get_detection) rather than tracker predictions, and
+    // those analytics trail the players by `latency_frames`; call finish() after the last frame.
+    // 0 (the default) uses the given ball positions as they are.
+    void set_ball_latency(int latency_frames);
+
+    // Processes the frames still held back by the ball refinement; call once before saving
+    void finish();
+
     void save_to_csv();
 
+    // Decimals written for float CSV columns (x, y, distance_meters, ...), either for all of
+    // them or for one column; default 6
+    void set_csv_precision(int digits) { default_csv_precision_ = digits; }
+    void set_csv_precision(const std::string& column, int digits);
+
+    // Per-player totals in player id order; cheap, only touches the running aggregates
+    std::vector<PlayerSummary> player_summaries() const;
+
+    // Load events so far, ordered by start frame; events still in progress are included once they
+    // have lasted their minimum duration
+    std::vector<LoadEvent> load_events() const;
+
+    // Reads a player_summary.csv written by save_to_csv; returns an empty list (with a warning)
+    // if the file cannot be read
+    static std::vector<PlayerSummary> load_player_summaries(const std::string& path);
+
+    // Ball possession: spells, team shares and turnovers (written by save_to_csv as
+    // possession_spells.csv and team_possession.csv)
+    const PossessionTracker& possession() const { return possession_; }
+
+    // Passes and interceptions detected from possession transfers (written by save_to_csv as
+    // passes.csv; per-player totals fill the passes, accurate_passes and interceptions columns)
+    const PassDetector& passes() const { return pass_detector_; }
+
+    // Pitch control every `interval_frames` frames (0, the default, disables it) on a grid of
+    // `cell_size` meters. The two teams with the most players in the frame are compared. With
+    // `write_grids` every surface is also written to pitch_control/frame_<n>.png (one pixel per
+    // cell, 255 where the first team in name order has full control).
+    void set_pitch_control(int interval_frames, PitchControlModel model, float cell_size, bool write_grids);
+    const std::vector<PitchControlFrame>& pitch_control_frames() const { return pitch_control_frames_; }
+
+    // Per-frame shape of the two best represented teams (written by save_to_csv as team_shape.csv)
+    const std::vector<TeamShape>& team_shapes() const { return team_shapes_; }
+
+    // Completed passes received in an offside position (written by save_to_csv as offsides.csv;
+    // per-player totals fill the offsides column)
+    const OffsideDetector& offsides() const { return offside_; }
+
+    // Heatmap grid resolution in meters (default 1.0); takes effect for players and teams first seen
+    // after the call, so set it before the first frame
+    void set_heatmap_cell_size(float meters) { heatmap_cell_size_ = meters; }
+
+    // Occupancy heatmaps per player and per team: heatmaps.fcol with the non-zero cells of every
+    // grid, plus PNGs in heatmaps/ for each team and each player seen for at least a minute
+    void save_heatmaps();
+
+    // Typed columnar export (player_metrics.fcol / ball_metrics.fcol, see utils/columnar.h) with
+    // the same columns as the CSVs
+    void save_to_columnar();
+
+    // Checkpoint support: per-player accumulators and other bounded state
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
+    // The accumulated rows (per-frame metrics, load events, pitch control, team shapes, spells,
+    // passes and offsides) are persisted incrementally, as a sequence of chunks: save_new_rows
+    // writes one chunk with the rows added since the last mark_rows_saved(), load_rows (after
+    // load_state) replaces the rows with those of all chunks in `in` and marks them saved
+    void save_new_rows(std::ostream& out) const;
+    void mark_rows_saved();
+    void load_rows(std::istream& in);
+    bool has_saved_rows() const { return rows_saved_; }
+
 private:
+    static const int kNumLoadEventTypes = 4; // sprint, high-intensity run, acceleration, deceleration
+    static const int kNumSpeedBands = 5;
+
+    // State of one event rule for one player: the current run of samples past the rule threshold
+    struct EventRun {
+        int start_frame = -1; // -1 if no run in progress
+        int last_frame = -1;
+        bool confirmed = false; // run has lasted the rule's minimum duration and was counted
+        double peak = 0.0;
+        double distance_meters = 0.0;
+    };
+
+    // Running per-player totals behind the summary and the cumulative CSV columns
+    struct PlayerAggregate {
+        std::string team = "Unknown";
+        int frames = 0;
+        double total_distance_meters = 0.0;
+        double top_speed_mps = 0.0;
+        std::array<EventRun, kNumLoadEventTypes> runs{};
+        std::array<int, kNumLoadEventTypes> event_counts{};
+        std::array<double, kNumSpeedBands> band_distance_meters{};
+        Heatmap heatmap;
+    };
+
+    // O(1) per sample: top speed, speed-band distance and the event state machines
+    void update_aggregate(int player_id, PlayerAggregate& aggregate, int frame_count, double speed_mps,
+                          double acceleration_mps2, double distance_meters, bool after_gap);
+    LoadEvent make_event(int player_id, int rule, const EventRun& run) const;
+    void process_ball(int frame_count, const std::vector<std::pair<int, cv::Point2f>>& player_tracks,
+                      const std::pair<int, cv::Point2f>& ball_track, const std::map<int, std::string>& team_assignments,
+                      bool interpolated);
+    void process_ball_estimates(const std::vector<BallEstimate>& estimates);
+    void update_pitch_control(int frame_count, const std::map<std::string, std::vector<PitchControlPlayer>>& players);
+    // Shapes of the two best represented teams from this frame's team_positions_, and the
+    // offside positions derived from them
+    void update_team_shapes(int frame_count, const std::pair<int, cv::Point2f>& ball_track);
+
+    // Export-time per-player values derived from the accumulated totals
+    int minutes_played(int player_id) const;
+    double total_distance_km(int player_id) const;
+
+    // Per-player values repeated on every player_metrics row, computed once per player
+    struct PlayerRowTotals {
+        int minutes_played = 0;
+        double distance_km = 0.0;
+        PassCounts pass_counts;
+        int offsides = 0;
+    };
+    std::map<int, PlayerRowTotals> player_row_totals() const;
+    int csv_precision(const std::string& column) const;
+
     std::string output_dir_;
-    std::vector<std::map<std::string, std::string>> player_metrics_;
-    std::vector<std::map<std::string, std::string>> ball_metrics_;
-    std::map<int, cv::Point2f> last_player_positions_; // For speed/distance calculation
-    std::map<int, double> player_total_distances_; // For cumulative distance
+    std::vector<PlayerFrameMetrics> player_metrics_;
+    std::vector<BallFrameMetrics> ball_metrics_;
+    size_t saved_player_rows_ = 0; // rows already persisted by a checkpoint
+    size_t saved_ball_rows_ = 0;
+    size_t saved_load_events_ = 0;
+    size_t saved_pitch_control_frames_ = 0;
+    size_t saved_team_shapes_ = 0;
+    bool rows_saved_ = false; // a chunk was written or loaded
+    std::map<int, cv::Point2f> last_player_positions_; // Last smoothed position, for distance
+    std::map<int, SavitzkyGolayFilter> player_filters_; // Smoothed position/speed/acceleration per track
     std::map<int, int> last_player_frame_counts_; // For accurate speed calculation with frame skipping
-    std::map<int, int> player_frame_counts_; // number of frames seen per player
+    std::map<int, PlayerAggregate> player_aggregates_;
+    std::vector<LoadEvent> load_events_; // completed events, in completion order
+    std::map<std::string, Heatmap> team_heatmaps_;
+    PossessionTracker possession_;
+    PassDetector pass_detector_;
+    int pitch_control_interval_ = 0;
+    bool pitch_control_grids_ = false;
+    PitchControl pitch_control_;
+    int last_pitch_control_frame_ = -1;
+    std::vector<PitchControlFrame> pitch_control_frames_;
+    std::map<std::string, std::vector<cv::Point2f>> team_positions_; // calibrated positions of this frame, per team
+    std::map<std::string, std::vector<int>> team_player_ids_;        // track ids matching team_positions_
+    TeamShapeCalculator team_shape_calculator_;
+    std::vector<TeamShape> team_shapes_;
+    OffsideDetector offside_;
+
+    // Frames waiting for their refined ball position
+    struct DelayedFrame {
+        int frame;
+        std::vector<std::pair<int, cv::Point2f>> player_tracks;
+        std::map<int, std::string> team_assignments;
+    };
+    bool refine_ball_ = false;
+    BallTrajectoryFilter ball_filter_;
+    std::deque<DelayedFrame> delayed_frames_;
+    float heatmap_cell_size_ = 1.0f;
     double video_fps_ = 30.0; // default fps, updated from process_frame
+    int default_csv_precision_ = 6; // matches the historical std::to_string output
+    std::map<std::string, int> csv_precision_;
 };
 
 #endif // METRICS_H
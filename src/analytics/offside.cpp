@@ -0,0 +1,127 @@
+#include "analytics/offside.h"
+#include "utils/csv_writer.h"
+#include "utils/serialization.h"
+#include <iostream>
+
+namespace {
+
+// A pass is judged when it is received: at most PassDetector::kMaxLooseSeconds after its release,
+// plus the time possession needs to change hands
+const double kHistorySeconds = PassDetector::kMaxLooseSeconds + 1.0;
+
+} // namespace
+
+void OffsideDetector::record(int frame, double fps, const std::vector<std::pair<int, float>>& offside_players) {
+    history_.push_back({frame, offside_players});
+    const int oldest = frame - static_cast<int>(kHistorySeconds * (fps > 0.0 ? fps : 30.0));
+    while (!history_.empty() && history_.front().frame < oldest) {
+        history_.pop_front();
+    }
+}
+
+void OffsideDetector::on_pass(const PassEvent& pass) {
+    if (!pass.completed) {
+        return;
+    }
+    // Latest recorded frame at or before the release (frames may have been skipped)
+    for (auto it = history_.rbegin(); it != history_.rend(); ++it) {
+        if (it->frame > pass.release_frame) {
+            continue;
+        }
+        for (const auto& [player_id, margin] : it->offside_players) {
+            if (player_id == pass.receiver_id) {
+                events_.push_back({player_id, pass.receiver_team, pass.passer_id, pass.release_frame,
+                                   pass.reception_frame, margin});
+                counts_[player_id] += 1;
+                break;
+            }
+        }
+        return;
+    }
+}
+
+int OffsideDetector::count(int player_id) const {
+    auto it = counts_.find(player_id);
+    return it != counts_.end() ? it->second : 0;
+}
+
+void OffsideDetector::save_to_csv(const std::string& output_dir, int precision) const {
+    CsvWriter file(output_dir + "/offsides.csv");
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open offsides.csv for writing." << std::endl;
+        return;
+    }
+    file.field(std::string_view("player_id,team,passer_id,release_frame,reception_frame,margin_meters"));
+    file.end_row();
+    for (const OffsideEvent& event : events_) {
+        file.field(event.player_id);
+        file.field(event.team);
+        file.field(event.passer_id);
+        file.field(event.release_frame);
+        file.field(event.reception_frame);
+        file.field(event.margin_meters, precision);
+        file.end_row();
+    }
+    if (!file.close()) {
+        std::cerr << "Error: Failed to write offsides.csv." << std::endl;
+    }
+}
+
+void OffsideDetector::save_state(std::ostream& out) const {
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(history_.size()));
+    for (const Snapshot& snapshot : history_) {
+        serialization::write_pod<int32_t>(out, snapshot.frame);
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(snapshot.offside_players.size()));
+        for (const auto& [player_id, margin] : snapshot.offside_players) {
+            serialization::write_pod<int32_t>(out, player_id);
+            serialization::write_pod(out, margin);
+        }
+    }
+}
+
+void OffsideDetector::save_new_rows(std::ostream& out) const {
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(events_.size() - saved_events_));
+    for (size_t i = saved_events_; i < events_.size(); ++i) {
+        const OffsideEvent& event = events_[i];
+        serialization::write_pod<int32_t>(out, event.player_id);
+        serialization::write_string(out, event.team);
+        serialization::write_pod<int32_t>(out, event.passer_id);
+        serialization::write_pod<int32_t>(out, event.release_frame);
+        serialization::write_pod<int32_t>(out, event.reception_frame);
+        serialization::write_pod(out, event.margin_meters);
+    }
+}
+
+void OffsideDetector::load_state(std::istream& in) {
+    history_.clear();
+    uint32_t count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        Snapshot snapshot;
+        snapshot.frame = serialization::read_pod<int32_t>(in);
+        uint32_t players = serialization::read_pod<uint32_t>(in);
+        for (uint32_t j = 0; j < players; ++j) {
+            int player_id = serialization::read_pod<int32_t>(in);
+            float margin = serialization::read_pod<float>(in);
+            snapshot.offside_players.push_back({player_id, margin});
+        }
+        history_.push_back(std::move(snapshot));
+    }
+    events_.clear();
+    saved_events_ = 0;
+    counts_.clear();
+}
+
+void OffsideDetector::load_rows(std::istream& in) {
+    uint32_t count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        OffsideEvent event;
+        event.player_id = serialization::read_pod<int32_t>(in);
+        event.team = serialization::read_string(in);
+        event.passer_id = serialization::read_pod<int32_t>(in);
+        event.release_frame = serialization::read_pod<int32_t>(in);
+        event.reception_frame = serialization::read_pod<int32_t>(in);
+        event.margin_meters = serialization::read_pod<float>(in);
+        events_.push_back(event);
+        counts_[event.player_id] += 1;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef OFFSIDE_H
+#define OFFSIDE_H
+
+#include <deque>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "analytics/pass_detector.h"
+
+// A completed pass received by a player who was in an offside position when it was played
+struct OffsideEvent {
+    int player_id;
+    std::string team;
+    int passer_id;
+    int release_frame;
+    int reception_frame;
+    float margin_meters; // how far beyond the offside line the player was at the release frame
+};
+
+// Judges passes against recorded offside positions. Positions are recorded every frame by the
+// caller (which already has each team's second-last defender from the team shape) and kept only
+// for as long as a pass can take, since a pass is detected at its reception but judged at its
+// release.
+class OffsideDetector {
+public:
+    // Players in an offside position in `frame`, with their margin beyond the line in meters
+    void record(int frame, double fps, const std::vector<std::pair<int, float>>& offside_players);
+
+    // A completed pass to a player who was offside at the release frame is an offside
+    void on_pass(const PassEvent& pass);
+
+    const std::vector<OffsideEvent>& events() const { return events_; }
+    int count(int player_id) const;
+
+    // offsides.csv in `output_dir`
+    void save_to_csv(const std::string& output_dir, int precision) const;
+
+    // Checkpoint support; the events are persisted as rows chunks, like PossessionTracker's spells
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+    void save_new_rows(std::ostream& out) const;
+    void mark_rows_saved() { saved_events_ = events_.size(); }
+    void load_rows(std::istream& in);
+
+private:
+    struct Snapshot {
+        int frame;
+        std::vector<std::pair<int, float>> offside_players;
+    };
+
+    std::deque<Snapshot> history_; // recent frames, oldest first
+    std::vector<OffsideEvent> events_;
+    size_t saved_events_ = 0; // events already persisted by a checkpoint
+    std::map<int, int> counts_;
+};
+
+#endif // OFFSIDE_H
@@ -0,0 +1,133 @@
+#include "analytics/pass_detector.h"
+#include "utils/csv_writer.h"
+#include "utils/serialization.h"
+#include <iostream>
+
+namespace {
+
+// Shorter transfers are tackles or contested balls
+const double kMinPassDistanceMeters = 4.0;
+
+const char* kUnknownTeam = "Unknown";
+const char* kRefereeTeam = "Referee";
+
+bool is_team(const std::string& team) {
+    return team != kUnknownTeam && team != kRefereeTeam;
+}
+
+} // namespace
+
+void PassDetector::update(const PossessionTracker& possession, double fps) {
+    if (possession.started_spells() == seen_spells_) {
+        return;
+    }
+    seen_spells_ = possession.started_spells();
+    const PossessionSpell* previous = possession.last_completed_spell();
+    if (!possession.is_possessed() || previous == nullptr) {
+        return;
+    }
+    PossessionSpell next = possession.current_spell();
+    // The same player touching the ball again is a dribble, not a pass
+    if (next.player_id == previous->player_id) {
+        return;
+    }
+    if (fps > 0.0 && (next.start_frame - previous->end_frame) / fps > kMaxLooseSeconds) {
+        return;
+    }
+    double distance = cv::norm(next.start_ball - previous->end_ball);
+    if (distance < kMinPassDistanceMeters) {
+        return;
+    }
+
+    // Without both teams (the team warm-up, a player whose jersey was never seen, a referee in the
+    // way) the pass is attempted, but neither accurate nor intercepted
+    bool teams_known = is_team(previous->team) && is_team(next.team);
+    bool completed = teams_known && next.team == previous->team;
+    passes_.push_back({previous->player_id, previous->team, next.player_id, next.team, previous->end_frame,
+                       next.start_frame, distance, completed});
+    add_to_counts(passes_.back());
+}
+
+void PassDetector::add_to_counts(const PassEvent& pass) {
+    PassCounts& passer = counts_[pass.passer_id];
+    passer.passes += 1;
+    if (pass.completed) {
+        passer.accurate_passes += 1;
+    } else if (is_team(pass.passer_team) && is_team(pass.receiver_team)) {
+        counts_[pass.receiver_id].interceptions += 1;
+    }
+}
+
+PassCounts PassDetector::counts(int player_id) const {
+    auto it = counts_.find(player_id);
+    return it != counts_.end() ? it->second : PassCounts{};
+}
+
+void PassDetector::save_to_csv(const std::string& output_dir, int precision) const {
+    CsvWriter file(output_dir + "/passes.csv");
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open passes.csv for writing." << std::endl;
+        return;
+    }
+    file.field(std::string_view(
+        "passer_id,passer_team,receiver_id,receiver_team,release_frame,reception_frame,distance_meters,completed"));
+    file.end_row();
+    for (const PassEvent& pass : passes_) {
+        file.field(pass.passer_id);
+        file.field(pass.passer_team);
+        file.field(pass.receiver_id);
+        file.field(pass.receiver_team);
+        file.field(pass.release_frame);
+        file.field(pass.reception_frame);
+        file.field(pass.distance_meters, precision);
+        file.field(pass.completed ? 1 : 0);
+        file.end_row();
+    }
+    if (!file.close()) {
+        std::cerr << "Error: Failed to write passes.csv." << std::endl;
+    }
+}
+
+void PassDetector::save_state(std::ostream& out) const {
+    serialization::write_pod<int32_t>(out, seen_spells_);
+}
+
+void PassDetector::save_new_rows(std::ostream& out) const {
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(passes_.size() - saved_passes_));
+    for (size_t i = saved_passes_; i < passes_.size(); ++i) {
+        const PassEvent& pass = passes_[i];
+        serialization::write_pod<int32_t>(out, pass.passer_id);
+        serialization::write_string(out, pass.passer_team);
+        serialization::write_pod<int32_t>(out, pass.receiver_id);
+        serialization::write_string(out, pass.receiver_team);
+        serialization::write_pod<int32_t>(out, pass.release_frame);
+        serialization::write_pod<int32_t>(out, pass.reception_frame);
+        serialization::write_pod(out, pass.distance_meters);
+        serialization::write_pod<uint8_t>(out, pass.completed ? 1 : 0);
+    }
+}
+
+void PassDetector::load_state(std::istream& in) {
+    seen_spells_ = serialization::read_pod<int32_t>(in);
+    passes_.clear();
+    saved_passes_ = 0;
+    counts_.clear();
+}
+
+void PassDetector::load_rows(std::istream& in) {
+    uint32_t count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        PassEvent pass;
+        pass.passer_id = serialization::read_pod<int32_t>(in);
+        pass.passer_team = serialization::read_string(in);
+        pass.receiver_id = serialization::read_pod<int32_t>(in);
+        pass.receiver_team = serialization::read_string(in);
+        pass.release_frame = serialization::read_pod<int32_t>(in);
+        pass.reception_frame = serialization::read_pod<int32_t>(in);
+        pass.distance_meters = serialization::read_pod<double>(in);
+        pass.completed = serialization::read_pod<uint8_t>(in) != 0;
+        passes_.push_back(pass);
+        // Counts are derived from the events rather than stored
+        add_to_counts(pass);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PASS_DETECTOR_H
+#define PASS_DETECTOR_H
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "analytics/possession.h"
+
+// A transfer of the ball from one player's possession spell to the next player's spell
+struct PassEvent {
+    int passer_id;
+    std::string passer_team;
+    int receiver_id;
+    std::string receiver_team;
+    int release_frame;      // last frame of the passer's spell
+    int reception_frame;    // first frame of the receiver's spell
+    double distance_meters; // ball travel between release and reception
+    bool completed;         // received by a teammate; otherwise intercepted by the receiver, or
+                            // unclassified when either team is unknown
+};
+
+struct PassCounts {
+    int passes = 0;          // attempted, completed or not
+    int accurate_passes = 0; // received by a teammate
+    int interceptions = 0;   // passes from the other team won by this player
+};
+
+// Segments the ball's possession history into passes. Each time PossessionTracker starts a new
+// spell, the spell that ended before it is the only candidate origin, so look-back is bounded to
+// one spell and the detector runs frame by frame in streaming mode. A transfer counts as a pass
+// when the ball travelled far enough and was not loose for too long (otherwise it was a tackle or
+// a dead ball); if the receiver is on the other team it is an interception by the receiver and an
+// inaccurate pass by the passer. A transfer involving a player without a team, or a referee, is
+// still a pass, attempted but neither accurate nor an interception.
+class PassDetector {
+public:
+    // Longer loose periods mean the ball went dead (out of play, a stoppage) or was lost by the tracker
+    static constexpr double kMaxLooseSeconds = 5.0;
+
+    // Call once per frame after PossessionTracker::update
+    void update(const PossessionTracker& possession, double fps);
+
+    const std::vector<PassEvent>& passes() const { return passes_; }
+    // Zero counts for players without passes
+    PassCounts counts(int player_id) const;
+
+    // passes.csv in `output_dir`
+    void save_to_csv(const std::string& output_dir, int precision) const;
+
+    // Checkpoint support; the passes are persisted as rows chunks, like PossessionTracker's spells
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+    void save_new_rows(std::ostream& out) const;
+    void mark_rows_saved() { saved_passes_ = passes_.size(); }
+    void load_rows(std::istream& in);
+
+private:
+    int seen_spells_ = 0; // PossessionTracker::started_spells() at the last update
+    std::vector<PassEvent> passes_;
+    size_t saved_passes_ = 0; // passes already persisted by a checkpoint
+    std::map<int, PassCounts> counts_;
+
+    void add_to_counts(const PassEvent& pass);
+};
+
+#endif // PASS_DETECTOR_H
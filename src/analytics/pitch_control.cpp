@@ -0,0 +1,105 @@
+#include "analytics/pitch_control.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Spearman et al. (2017) defaults
+const float kReactionSeconds = 0.7f;
+const float kMaxPlayerSpeedMps = 5.0f;
+const float kControlSigmaSeconds = 0.45f;
+
+// Distance from (x, y) to the nearest of the points
+float nearest_distance(const std::vector<float>& xs, const std::vector<float>& ys, float x, float y) {
+    float best = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < xs.size(); ++i) {
+        float dx = xs[i] - x;
+        float dy = ys[i] - y;
+        best = std::min(best, dx * dx + dy * dy);
+    }
+    return std::sqrt(best);
+}
+
+} // namespace
+
+PitchControlModel parse_pitch_control_model(const std::string& name) {
+    if (name == "voronoi") {
+        return PitchControlModel::Voronoi;
+    }
+    if (name == "time-to-intercept") {
+        return PitchControlModel::TimeToIntercept;
+    }
+    throw std::invalid_argument("Unknown pitch control model '" + name + "' (expected voronoi or time-to-intercept)");
+}
+
+PitchControl::PitchControl(float cell_size, PitchControlModel model, float length, float width)
+    : cell_size_(cell_size), model_(model),
+      cols_(std::max(1, static_cast<int>(std::ceil(length / cell_size)))),
+      rows_(std::max(1, static_cast<int>(std::ceil(width / cell_size)))),
+      control_(static_cast<size_t>(cols_) * rows_, 0.5f), row_area_(rows_, 0.0) {
+    area_ = 0.5 * cols_ * rows_ * cell_size_ * cell_size_;
+}
+
+bool PitchControl::compute(const std::vector<PitchControlPlayer>& players) {
+    for (int team = 0; team < 2; ++team) {
+        xs_[team].clear();
+        ys_[team].clear();
+    }
+    const float lead_seconds = model_ == PitchControlModel::TimeToIntercept ? kReactionSeconds : 0.0f;
+    for (const PitchControlPlayer& player : players) {
+        if (player.team != 0 && player.team != 1) {
+            continue;
+        }
+        xs_[player.team].push_back(player.position.x + player.velocity.x * lead_seconds);
+        ys_[player.team].push_back(player.position.y + player.velocity.y * lead_seconds);
+    }
+    if (xs_[0].empty() || xs_[1].empty()) {
+        std::fill(control_.begin(), control_.end(), 0.5f);
+        area_ = 0.5 * cols_ * rows_ * cell_size_ * cell_size_;
+        return false;
+    }
+
+    // Logistic slope matching a standard deviation of kControlSigmaSeconds in arrival time
+    const float slope = static_cast<float>(CV_PI / std::sqrt(3.0)) / kControlSigmaSeconds / kMaxPlayerSpeedMps;
+    const double cell_area = static_cast<double>(cell_size_) * cell_size_;
+    cv::parallel_for_(cv::Range(0, rows_), [&](const cv::Range& range) {
+        for (int row = range.start; row < range.end; ++row) {
+            const float y = (row + 0.5f) * cell_size_;
+            float* out = &control_[static_cast<size_t>(row) * cols_];
+            double row_control = 0.0;
+            for (int col = 0; col < cols_; ++col) {
+                const float x = (col + 0.5f) * cell_size_;
+                float d0 = nearest_distance(xs_[0], ys_[0], x, y);
+                float d1 = nearest_distance(xs_[1], ys_[1], x, y);
+                float value;
+                if (model_ == PitchControlModel::Voronoi) {
+                    value = d0 < d1 ? 1.0f : (d0 > d1 ? 0.0f : 0.5f);
+                } else {
+                    // Both teams share the reaction time, so the arrival time difference is (d1 - d0) / speed
+                    value = 1.0f / (1.0f + std::exp(-slope * (d1 - d0)));
+                }
+                out[col] = value;
+                row_control += value;
+            }
+            row_area_[row] = row_control * cell_area;
+        }
+    });
+    area_ = 0.0;
+    for (double row_area : row_area_) {
+        area_ += row_area;
+    }
+    return true;
+}
+
+cv::Mat PitchControl::to_image() const {
+    cv::Mat image(rows_, cols_, CV_8UC1);
+    for (int row = 0; row < rows_; ++row) {
+        uint8_t* pixels = image.ptr<uint8_t>(row);
+        for (int col = 0; col < cols_; ++col) {
+            pixels[col] = static_cast<uint8_t>(std::lround(control(col, row) * 255.0f));
+        }
+    }
+    return image;
+}
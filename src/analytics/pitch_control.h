@@ -0,0 +1,63 @@
+#ifndef PITCH_CONTROL_H
+#define PITCH_CONTROL_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "analytics/heatmap.h"
+
+enum class PitchControlModel {
+    Voronoi,        // each cell belongs to the team of the nearest player
+    TimeToIntercept // probabilistic, from the time each team needs to reach the cell
+};
+
+// "voronoi" or "time-to-intercept"; throws std::invalid_argument otherwise
+PitchControlModel parse_pitch_control_model(const std::string& name);
+
+struct PitchControlPlayer {
+    cv::Point2f position;
+    cv::Point2f velocity; // m/s, only used by the time-to-intercept model
+    int team;             // 0 or 1
+};
+
+// Team dominance surface over a grid of the pitch. Every cell only needs the nearest player of
+// each team: for the time-to-intercept model (a simplified Spearman model) a player first keeps
+// moving with their velocity for a reaction time and then runs straight to the cell at a maximum
+// speed, so the fastest arrival is also the nearest reaction position. Control then follows a
+// logistic in the difference of the two teams' arrival times. Grid rows are evaluated in parallel
+// with cv::parallel_for_, and the inner loop runs over flat coordinate arrays.
+class PitchControl {
+public:
+    explicit PitchControl(float cell_size = 1.0f, PitchControlModel model = PitchControlModel::TimeToIntercept,
+                          float length = kPitchLengthMeters, float width = kPitchWidthMeters);
+
+    // Recomputes the surface; returns false (leaving an even split) if either team has no players
+    bool compute(const std::vector<PitchControlPlayer>& players);
+
+    PitchControlModel model() const { return model_; }
+    float cell_size() const { return cell_size_; }
+    int cols() const { return cols_; }
+    int rows() const { return rows_; }
+    // Control of team 0 in [0, 1] per cell, row-major; team 1 has the complement
+    const std::vector<float>& grid() const { return control_; }
+    float control(int col, int row) const { return control_[static_cast<size_t>(row) * cols_ + col]; }
+    // Controlled area in square meters
+    double area(int team) const { return team == 0 ? area_ : cols_ * rows_ * cell_size_ * cell_size_ - area_; }
+
+    // One 8-bit pixel per cell, 255 where team 0 has full control; x to the right and y down
+    cv::Mat to_image() const;
+
+private:
+    float cell_size_;
+    PitchControlModel model_;
+    int cols_;
+    int rows_;
+    std::vector<float> control_;
+    std::vector<double> row_area_; // team 0 area per row, summed after the parallel pass
+    double area_ = 0.0;
+    // Nearest-player candidates per team, as flat coordinate arrays
+    std::vector<float> xs_[2];
+    std::vector<float> ys_[2];
+};
+
+#endif // PITCH_CONTROL_H
@@ -0,0 +1,283 @@
+#include "analytics/possession.h"
+#include "csv.h"
+#include "utils/csv_writer.h"
+#include "utils/serialization.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// A player gains the ball by being the nearest within the control radius for kGainSeconds, and
+// loses it once the ball has been beyond the release radius for kLooseSeconds
+const float kControlRadiusMeters = 2.0f;
+const float kReleaseRadiusMeters = 3.0f;
+const double kGainSeconds = 0.2;
+const double kLooseSeconds = 0.4;
+
+const char* kUnknownTeam = "Unknown";
+const char* kRefereeTeam = "Referee";
+
+// Spells of players without a team yet, and of referees, count for no team
+bool is_team(const std::string& team) {
+    return team != kUnknownTeam && team != kRefereeTeam;
+}
+
+} // namespace
+
+PossessionTracker::PossessionTracker() : grid_(kControlRadiusMeters) {}
+
+int PossessionTracker::update(int frame_index, double fps, const std::vector<std::pair<int, cv::Point2f>>& player_tracks,
+                              const std::pair<int, cv::Point2f>& ball_track,
+                              const std::map<int, std::string>& team_assignments) {
+    fps_ = fps > 0.0 ? fps : fps_;
+    last_frame_ = frame_index;
+    // A spell started before its player had a team (the tracker's team warm-up) takes the team as
+    // soon as one is assigned
+    if (possessor_ != -1 && possessor_team_ == kUnknownTeam) {
+        auto it_team = team_assignments.find(possessor_);
+        if (it_team != team_assignments.end() && it_team->second != kUnknownTeam) {
+            possessor_team_ = it_team->second;
+            spell_turnover_ = is_team(possessor_team_) && !last_team_.empty() && possessor_team_ != last_team_;
+        }
+    }
+    if (ball_track.first == -1) {
+        return possessor_;
+    }
+    const cv::Point2f& ball = ball_track.second;
+
+    float possessor_distance = std::numeric_limits<float>::infinity();
+    if (possessor_ != -1) {
+        for (const auto& track : player_tracks) {
+            if (track.first == possessor_) {
+                possessor_distance = static_cast<float>(cv::norm(track.second - ball));
+                break;
+            }
+        }
+    }
+
+    grid_.build(player_tracks);
+    float nearest_distance = 0.0f;
+    int nearest_index = grid_.nearest(ball, kControlRadiusMeters, &nearest_distance);
+    int nearest = nearest_index >= 0 ? player_tracks[nearest_index].first : -1;
+
+    // Release: the possessor has been away from the ball for too long
+    if (possessor_ != -1) {
+        if (possessor_distance <= kReleaseRadiusMeters) {
+            far_since_frame_ = -1;
+            last_close_ball_ = ball;
+        } else {
+            if (far_since_frame_ < 0) {
+                far_since_frame_ = frame_index;
+            }
+            if ((frame_index - far_since_frame_) / fps_ >= kLooseSeconds) {
+                end_spell(far_since_frame_ - 1);
+            }
+        }
+    }
+
+    // Gain or takeover: another player is (and stays) closer to the ball than the possessor
+    bool challenger = nearest != -1 && nearest != possessor_ &&
+                      (possessor_ == -1 || nearest_distance < possessor_distance);
+    if (!challenger) {
+        candidate_ = -1;
+        return possessor_;
+    }
+    if (candidate_ != nearest) {
+        candidate_ = nearest;
+        candidate_since_frame_ = frame_index;
+        candidate_ball_ = ball;
+    }
+    if ((frame_index - candidate_since_frame_) / fps_ >= kGainSeconds) {
+        if (possessor_ != -1) {
+            end_spell(candidate_since_frame_ - 1);
+        }
+        auto it_team = team_assignments.find(candidate_);
+        start_spell(candidate_, it_team != team_assignments.end() ? it_team->second : kUnknownTeam,
+                    candidate_since_frame_, candidate_ball_);
+        candidate_ = -1;
+    }
+    return possessor_;
+}
+
+void PossessionTracker::start_spell(int player_id, const std::string& team, int frame_index, const cv::Point2f& ball) {
+    ++started_spells_;
+    spell_start_ball_ = ball;
+    last_close_ball_ = ball;
+    possessor_ = player_id;
+    possessor_team_ = team;
+    spell_start_frame_ = spells_.empty() ? frame_index : std::max(frame_index, spells_.back().end_frame + 1);
+    spell_turnover_ = is_team(team) && !last_team_.empty() && team != last_team_;
+    far_since_frame_ = -1;
+}
+
+void PossessionTracker::end_spell(int end_frame) {
+    spells_.push_back({possessor_, possessor_team_, spell_start_frame_, std::max(end_frame, spell_start_frame_),
+                       spell_turnover_, spell_start_ball_, last_close_ball_});
+    if (is_team(possessor_team_)) {
+        last_team_ = possessor_team_;
+    }
+    possessor_ = -1;
+    possessor_team_.clear();
+    spell_start_frame_ = -1;
+    far_since_frame_ = -1;
+}
+
+PossessionSpell PossessionTracker::current_spell() const {
+    return {possessor_, possessor_team_, spell_start_frame_, std::max(last_frame_, spell_start_frame_),
+            spell_turnover_, spell_start_ball_, last_close_ball_};
+}
+
+std::vector<PossessionSpell> PossessionTracker::spells() const {
+    std::vector<PossessionSpell> spells = spells_;
+    if (possessor_ != -1) {
+        spells.push_back(current_spell());
+    }
+    return spells;
+}
+
+std::vector<TeamPossession> PossessionTracker::team_possession() const {
+    std::map<std::string, TeamPossession> teams;
+    double total_seconds = 0.0;
+    for (const PossessionSpell& spell : spells()) {
+        if (!is_team(spell.team)) {
+            continue;
+        }
+        TeamPossession& team = teams.emplace(spell.team, TeamPossession{spell.team, 0.0, 0.0, 0, 0}).first->second;
+        double seconds = (spell.end_frame - spell.start_frame + 1) / fps_;
+        team.possession_seconds += seconds;
+        team.spells += 1;
+        team.turnovers_won += spell.turnover ? 1 : 0;
+        total_seconds += seconds;
+    }
+    std::vector<TeamPossession> result;
+    for (auto& [name, team] : teams) {
+        team.possession_percent = total_seconds > 0.0 ? 100.0 * team.possession_seconds / total_seconds : 0.0;
+        result.push_back(team);
+    }
+    return result;
+}
+
+void PossessionTracker::save_to_csv(const std::string& output_dir, int precision) const {
+    CsvWriter spells_file(output_dir + "/possession_spells.csv");
+    if (spells_file.is_open()) {
+        spells_file.field(std::string_view("player_id,team,start_frame,end_frame,duration_seconds,turnover"));
+        spells_file.end_row();
+        for (const PossessionSpell& spell : spells()) {
+            spells_file.field(spell.player_id);
+            spells_file.field(spell.team);
+            spells_file.field(spell.start_frame);
+            spells_file.field(spell.end_frame);
+            spells_file.field((spell.end_frame - spell.start_frame + 1) / fps_, precision);
+            spells_file.field(spell.turnover ? 1 : 0);
+            spells_file.end_row();
+        }
+        if (!spells_file.close()) {
+            std::cerr << "Error: Failed to write possession_spells.csv." << std::endl;
+        }
+    } else {
+        std::cerr << "Error: Could not open possession_spells.csv for writing." << std::endl;
+    }
+
+    CsvWriter teams_file(output_dir + "/team_possession.csv");
+    if (teams_file.is_open()) {
+        teams_file.field(std::string_view("team,possession_seconds,possession_percent,spells,turnovers_won"));
+        teams_file.end_row();
+        for (const TeamPossession& team : team_possession()) {
+            teams_file.field(team.team);
+            teams_file.field(team.possession_seconds, precision);
+            teams_file.field(team.possession_percent, precision);
+            teams_file.field(team.spells);
+            teams_file.field(team.turnovers_won);
+            teams_file.end_row();
+        }
+        if (!teams_file.close()) {
+            std::cerr << "Error: Failed to write team_possession.csv." << std::endl;
+        }
+    } else {
+        std::cerr << "Error: Could not open team_possession.csv for writing." << std::endl;
+    }
+}
+
+std::vector<TeamPossession> PossessionTracker::load_team_possession(const std::string& path) {
+    std::vector<TeamPossession> teams;
+    try {
+        io::CSVReader<5> in(path);
+        in.read_header(io::ignore_extra_column, "team", "possession_seconds", "possession_percent", "spells",
+                       "turnovers_won");
+        TeamPossession team;
+        while (in.read_row(team.team, team.possession_seconds, team.possession_percent, team.spells,
+                           team.turnovers_won)) {
+            teams.push_back(team);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Could not read team possession " << path << ": " << e.what() << std::endl;
+        teams.clear();
+    }
+    return teams;
+}
+
+void PossessionTracker::save_state(std::ostream& out) const {
+    serialization::write_pod(out, fps_);
+    serialization::write_pod<int32_t>(out, last_frame_);
+    serialization::write_pod<int32_t>(out, possessor_);
+    serialization::write_string(out, possessor_team_);
+    serialization::write_pod<int32_t>(out, spell_start_frame_);
+    serialization::write_pod<uint8_t>(out, spell_turnover_ ? 1 : 0);
+    serialization::write_pod<int32_t>(out, far_since_frame_);
+    serialization::write_point(out, spell_start_ball_);
+    serialization::write_point(out, last_close_ball_);
+    serialization::write_pod<int32_t>(out, started_spells_);
+    serialization::write_pod<int32_t>(out, candidate_);
+    serialization::write_pod<int32_t>(out, candidate_since_frame_);
+    serialization::write_point(out, candidate_ball_);
+    serialization::write_string(out, last_team_);
+}
+
+void PossessionTracker::save_new_rows(std::ostream& out) const {
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(spells_.size() - saved_spells_));
+    for (size_t i = saved_spells_; i < spells_.size(); ++i) {
+        const PossessionSpell& spell = spells_[i];
+        serialization::write_pod<int32_t>(out, spell.player_id);
+        serialization::write_string(out, spell.team);
+        serialization::write_pod<int32_t>(out, spell.start_frame);
+        serialization::write_pod<int32_t>(out, spell.end_frame);
+        serialization::write_pod<uint8_t>(out, spell.turnover ? 1 : 0);
+        serialization::write_point(out, spell.start_ball);
+        serialization::write_point(out, spell.end_ball);
+    }
+}
+
+void PossessionTracker::load_state(std::istream& in) {
+    fps_ = serialization::read_pod<double>(in);
+    last_frame_ = serialization::read_pod<int32_t>(in);
+    possessor_ = serialization::read_pod<int32_t>(in);
+    possessor_team_ = serialization::read_string(in);
+    spell_start_frame_ = serialization::read_pod<int32_t>(in);
+    spell_turnover_ = serialization::read_pod<uint8_t>(in) != 0;
+    far_since_frame_ = serialization::read_pod<int32_t>(in);
+    spell_start_ball_ = serialization::read_point(in);
+    last_close_ball_ = serialization::read_point(in);
+    started_spells_ = serialization::read_pod<int32_t>(in);
+    candidate_ = serialization::read_pod<int32_t>(in);
+    candidate_since_frame_ = serialization::read_pod<int32_t>(in);
+    candidate_ball_ = serialization::read_point(in);
+    last_team_ = serialization::read_string(in);
+    spells_.clear();
+    saved_spells_ = 0;
+}
+
+void PossessionTracker::load_rows(std::istream& in) {
+    uint32_t count = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        PossessionSpell spell;
+        spell.player_id = serialization::read_pod<int32_t>(in);
+        spell.team = serialization::read_string(in);
+        spell.start_frame = serialization::read_pod<int32_t>(in);
+        spell.end_frame = serialization::read_pod<int32_t>(in);
+        spell.turnover = serialization::read_pod<uint8_t>(in) != 0;
+        spell.start_ball = serialization::read_point(in);
+        spell.end_ball = serialization::read_point(in);
+        spells_.push_back(spell);
+    }
+}
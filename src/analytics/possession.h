@@ -0,0 +1,104 @@
+#ifndef POSSESSION_H
+#define POSSESSION_H
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "analytics/spatial_grid.h"
+
+// A period during which one player controlled the ball
+struct PossessionSpell {
+    int player_id;
+    std::string team;
+    int start_frame;
+    int end_frame;
+    bool turnover; // gained from the other team (the previous spell belonged to a different team)
+    cv::Point2f start_ball; // ball position when the spell started
+    cv::Point2f end_ball;   // last ball position within the release radius of the player
+};
+
+struct TeamPossession {
+    std::string team;
+    double possession_seconds;
+    double possession_percent; // share of the time any team had the ball
+    int spells;
+    int turnovers_won;
+};
+
+// Links the ball to the player controlling it. Per frame the nearest player to the ball is found
+// through a SpatialGrid. Hysteresis keeps possession stable: a player must stay the nearest
+// within the control radius for a short time to gain the ball, and the current possessor keeps it
+// until the ball has been beyond the release radius for a while (passes and shots make the ball
+// loose). Frames without a ball detection leave the state unchanged. Cost per frame is one grid
+// build and one neighbourhood query, so it runs live at full frame rate.
+class PossessionTracker {
+public:
+    PossessionTracker();
+
+    // Returns the id of the player in possession after this frame, or -1 if the ball is loose
+    int update(int frame_index, double fps, const std::vector<std::pair<int, cv::Point2f>>& player_tracks,
+               const std::pair<int, cv::Point2f>& ball_track, const std::map<int, std::string>& team_assignments);
+
+    int possessor() const { return possessor_; }
+    bool is_possessed() const { return possessor_ != -1; }
+
+    // Completed spells followed by the one in progress, if any
+    std::vector<PossessionSpell> spells() const;
+
+    // Number of spells started so far; changes exactly when a new spell begins
+    int started_spells() const { return started_spells_; }
+    // The spell in progress (only valid while is_possessed()) and the most recent completed one
+    // (nullptr if none)
+    PossessionSpell current_spell() const;
+    const PossessionSpell* last_completed_spell() const { return spells_.empty() ? nullptr : &spells_.back(); }
+
+    // Per-team totals over spells(), in team order; teams that never had the ball, players without
+    // a team and referees are omitted
+    std::vector<TeamPossession> team_possession() const;
+
+    // possession_spells.csv and team_possession.csv in `output_dir`
+    void save_to_csv(const std::string& output_dir, int precision) const;
+
+    // Reads a team_possession.csv; returns an empty list (with a warning) if it cannot be read
+    static std::vector<TeamPossession> load_team_possession(const std::string& path);
+
+    // Checkpoint support. The completed spells are left out of the state and persisted as rows
+    // chunks instead (see MetricsCalculator::save_new_rows): save_new_rows writes the spells
+    // completed since the last mark_rows_saved(), load_rows appends those of one chunk
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+    void save_new_rows(std::ostream& out) const;
+    void mark_rows_saved() { saved_spells_ = spells_.size(); }
+    void load_rows(std::istream& in);
+
+private:
+    SpatialGrid grid_;
+    double fps_ = 30.0;
+    int last_frame_ = 0;
+
+    int possessor_ = -1;
+    std::string possessor_team_;
+    int spell_start_frame_ = -1;
+    bool spell_turnover_ = false;
+    int far_since_frame_ = -1; // first frame the possessor was beyond the release radius, -1 if close
+    cv::Point2f spell_start_ball_;
+    cv::Point2f last_close_ball_; // last ball position within the release radius of the possessor
+    int started_spells_ = 0;
+
+    int candidate_ = -1; // player closing in on the ball, -1 if none
+    int candidate_since_frame_ = -1;
+    cv::Point2f candidate_ball_; // ball position when the candidate became the nearest
+
+    std::string last_team_; // team of the most recent spell, for turnovers
+    std::vector<PossessionSpell> spells_;
+    size_t saved_spells_ = 0; // spells already persisted by a checkpoint
+
+    void start_spell(int player_id, const std::string& team, int frame_index, const cv::Point2f& ball);
+    void end_spell(int end_frame);
+};
+
+#endif // POSSESSION_H
@@ -0,0 +1,75 @@
+#include "analytics/spatial_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+SpatialGrid::SpatialGrid(float cell_size, float length, float width) : cell_size_(cell_size) {
+    if (cell_size <= 0.0f) {
+        throw std::invalid_argument("Spatial grid cell size must be positive.");
+    }
+    cols_ = std::max(1, static_cast<int>(std::ceil(length / cell_size)));
+    rows_ = std::max(1, static_cast<int>(std::ceil(width / cell_size)));
+    cell_start_.assign(static_cast<size_t>(cols_) * rows_ + 1, 0);
+}
+
+void SpatialGrid::build(const std::vector<std::pair<int, cv::Point2f>>& points) {
+    positions_.resize(points.size());
+    point_cell_.resize(points.size());
+    items_.resize(points.size());
+    std::fill(cell_start_.begin(), cell_start_.end(), 0);
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        positions_[i] = points[i].second;
+        point_cell_[i] = cell_row(points[i].second.y) * cols_ + cell_col(points[i].second.x);
+        ++cell_start_[point_cell_[i] + 1];
+    }
+    for (size_t cell = 1; cell < cell_start_.size(); ++cell) {
+        cell_start_[cell] += cell_start_[cell - 1];
+    }
+    cursor_.assign(cell_start_.begin(), cell_start_.end() - 1);
+    for (size_t i = 0; i < points.size(); ++i) {
+        items_[cursor_[point_cell_[i]]++] = static_cast<int>(i);
+    }
+}
+
+void SpatialGrid::within(const cv::Point2f& query, float max_distance, std::vector<int>& indices) const {
+    indices.clear();
+    float max_distance_sq = max_distance * max_distance;
+    int col_begin = cell_col(query.x - max_distance), col_end = cell_col(query.x + max_distance);
+    int row_begin = cell_row(query.y - max_distance), row_end = cell_row(query.y + max_distance);
+    for (int row = row_begin; row <= row_end; ++row) {
+        for (int col = col_begin; col <= col_end; ++col) {
+            int cell = row * cols_ + col;
+            for (int k = cell_start_[cell]; k < cell_start_[cell + 1]; ++k) {
+                cv::Point2f delta = positions_[items_[k]] - query;
+                if (delta.dot(delta) <= max_distance_sq) {
+                    indices.push_back(items_[k]);
+                }
+            }
+        }
+    }
+}
+
+int SpatialGrid::nearest(const cv::Point2f& query, float max_distance, float* distance) const {
+    int best = -1;
+    float best_sq = max_distance * max_distance;
+    int col_begin = cell_col(query.x - max_distance), col_end = cell_col(query.x + max_distance);
+    int row_begin = cell_row(query.y - max_distance), row_end = cell_row(query.y + max_distance);
+    for (int row = row_begin; row <= row_end; ++row) {
+        for (int col = col_begin; col <= col_end; ++col) {
+            int cell = row * cols_ + col;
+            for (int k = cell_start_[cell]; k < cell_start_[cell + 1]; ++k) {
+                cv::Point2f delta = positions_[items_[k]] - query;
+                float distance_sq = delta.dot(delta);
+                if (distance_sq <= best_sq) {
+                    best_sq = distance_sq;
+                    best = items_[k];
+                }
+            }
+        }
+    }
+    if (best >= 0 && distance) {
+        *distance = std::sqrt(best_sq);
+    }
+    return best;
+}
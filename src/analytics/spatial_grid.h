@@ -0,0 +1,40 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "analytics/heatmap.h"
+
+// Uniform bucket grid over the pitch for nearest-neighbour queries on per-frame point sets
+// (players). build() is a counting sort into cells, so rebuilding every frame costs O(points +
+// cells) with no allocations after the first frame. Points outside the pitch go to the nearest
+// edge cell; distances are always computed from the real positions.
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cell_size, float length = kPitchLengthMeters, float width = kPitchWidthMeters);
+
+    void build(const std::vector<std::pair<int, cv::Point2f>>& points);
+
+    // Index (into the vector passed to build) of the point nearest to `query` within
+    // `max_distance`, or -1 if there is none. `distance` receives its distance if non-null.
+    int nearest(const cv::Point2f& query, float max_distance, float* distance = nullptr) const;
+
+    // Indices of all points within `max_distance` of `query`, in no particular order
+    void within(const cv::Point2f& query, float max_distance, std::vector<int>& indices) const;
+
+private:
+    float cell_size_;
+    int cols_;
+    int rows_;
+    std::vector<cv::Point2f> positions_;
+    std::vector<int> cell_start_; // cols_ * rows_ + 1 prefix sums into items_
+    std::vector<int> items_;      // point indices ordered by cell
+    std::vector<int> point_cell_;
+    std::vector<int> cursor_; // fill positions during build
+
+    int cell_col(float x) const { return std::min(std::max(static_cast<int>(std::floor(x / cell_size_)), 0), cols_ - 1); }
+    int cell_row(float y) const { return std::min(std::max(static_cast<int>(std::floor(y / cell_size_)), 0), rows_ - 1); }
+};
+
+#endif // SPATIAL_GRID_H
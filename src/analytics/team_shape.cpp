@@ -0,0 +1,74 @@
+#include "analytics/team_shape.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float cross(const cv::Point2f& o, const cv::Point2f& a, const cv::Point2f& b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+} // namespace
+
+bool TeamShapeCalculator::compute(const std::vector<cv::Point2f>& players, bool defends_left, float pitch_length,
+                                  TeamShape& shape) {
+    const size_t n = players.size();
+    if (n < 3) {
+        return false;
+    }
+
+    cv::Point2f sum(0.0f, 0.0f);
+    float min_x = players[0].x, max_x = players[0].x;
+    float min_y = players[0].y, max_y = players[0].y;
+    depths_.clear();
+    for (const cv::Point2f& p : players) {
+        sum += p;
+        min_x = std::min(min_x, p.x);
+        max_x = std::max(max_x, p.x);
+        min_y = std::min(min_y, p.y);
+        max_y = std::max(max_y, p.y);
+        depths_.push_back(defends_left ? p.x : pitch_length - p.x);
+    }
+    const cv::Point2f centroid = sum * (1.0f / n);
+    float spread = 0.0f;
+    for (const cv::Point2f& p : players) {
+        spread += static_cast<float>(cv::norm(p - centroid));
+    }
+
+    // Monotone chain: lower hull left to right, then upper hull right to left
+    sorted_.assign(players.begin(), players.end());
+    std::sort(sorted_.begin(), sorted_.end(), [](const cv::Point2f& a, const cv::Point2f& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    hull_.resize(2 * n);
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        while (k >= 2 && cross(hull_[k - 2], hull_[k - 1], sorted_[i]) <= 0.0f) {
+            --k;
+        }
+        hull_[k++] = sorted_[i];
+    }
+    for (size_t i = n - 1, lower = k + 1; i-- > 0;) {
+        while (k >= lower && cross(hull_[k - 2], hull_[k - 1], sorted_[i]) <= 0.0f) {
+            --k;
+        }
+        hull_[k++] = sorted_[i];
+    }
+    // The last point repeats the first; shoelace over the closed polygon
+    float twice_area = 0.0f;
+    for (size_t i = 0; i + 1 < k; ++i) {
+        twice_area += hull_[i].x * hull_[i + 1].y - hull_[i + 1].x * hull_[i].y;
+    }
+
+    std::nth_element(depths_.begin(), depths_.begin() + 1, depths_.end());
+    shape.players = static_cast<int>(n);
+    shape.centroid_x = centroid.x;
+    shape.centroid_y = centroid.y;
+    shape.width_meters = max_y - min_y;
+    shape.length_meters = max_x - min_x;
+    shape.hull_area_m2 = std::abs(twice_area) * 0.5f;
+    shape.stretch_index_meters = spread / n;
+    shape.defensive_line_meters = depths_[1];
+    shape.attacking_line_meters = *std::max_element(depths_.begin(), depths_.end());
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef TEAM_SHAPE_H
+#define TEAM_SHAPE_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Shape of one team in one frame, in calibrated meters. Depth is measured from the goal line the
+// team defends, so the line heights are comparable between halves and teams.
+struct TeamShape {
+    int frame;
+    std::string team;
+    int players;
+    float centroid_x;
+    float centroid_y;
+    float width_meters;          // extent across the pitch (y)
+    float length_meters;         // extent along the pitch (x)
+    float hull_area_m2;          // convex hull of all players
+    float stretch_index_meters;  // mean distance to the centroid, a compactness measure
+    float defensive_line_meters; // depth of the deepest outfield player (the deepest is taken as the goalkeeper)
+    float attacking_line_meters; // depth of the most advanced player
+};
+
+// Computes TeamShape from player positions. O(n log n) for the convex hull (Andrew's monotone
+// chain) and O(n) otherwise; scratch buffers are kept between calls so steady-state frames do not
+// allocate.
+class TeamShapeCalculator {
+public:
+    // `defends_left`: the team defends the goal at x = 0. Needs at least 3 players; returns false
+    // (leaving `shape` untouched) otherwise.
+    bool compute(const std::vector<cv::Point2f>& players, bool defends_left, float pitch_length, TeamShape& shape);
+
+private:
+    std::vector<cv::Point2f> sorted_;
+    std::vector<cv::Point2f> hull_;
+    std::vector<float> depths_;
+};
+
+#endif // TEAM_SHAPE_H
@@ -1,32 +1,185 @@
 #include "detection/ball_tracker.h"
+#include "utils/serialization.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Alpha-beta gains of the per-hypothesis constant-velocity filters
+const float kPositionGain = 0.8f;
+const float kVelocityGain = 0.4f;
+
+// A detection can join a hypothesis within this distance of its prediction. The gate widens with
+// every frame without a detection so the ball is picked up again after an occlusion or between
+// keyframes.
+const float kGatePixels = 50.0f;
+
+// A hypothesis matched on every frame settles at confidence / (1 - kScoreDecay)
+const float kScoreDecay = 0.9f;
+
+// Weight of the newest detection in a hypothesis' running confidence
+const float kConfidenceGain = 0.5f;
+
+// A challenger must out-score the followed hypothesis by this factor to take over
+const float kSwitchMargin = 1.5f;
+
+cv::Point2f bottom_center(const cv::Rect& box) {
+    return cv::Point2f(box.x + box.width / 2.0f, box.y + box.height);
+}
+
+} // namespace
 
 BallTracker::BallTracker() : track_({-1, {}}) {}
 
 BallTracker::~BallTracker() {}
 
-void BallTracker::update(const std::vector<Detection>& detections) {
-    float max_confidence = 0.0f;
-    const Detection* best_ball = nullptr;
-
-    // Find the ball detection with the highest confidence
+const cv::Point2f* BallTracker::update_hypotheses(const std::vector<Detection>& detections, bool& switched) {
+    // The kMaxCandidates highest-confidence detections, kept in descending confidence order
+    std::array<const Detection*, kMaxCandidates> candidates;
+    int num_candidates = 0;
     for (const auto& det : detections) {
-        if (det.confidence > max_confidence) {
-            max_confidence = det.confidence;
-            best_ball = &det;
+        if (det.confidence <= 0.0f ||
+            (num_candidates == kMaxCandidates && det.confidence <= candidates[kMaxCandidates - 1]->confidence)) {
+            continue;
+        }
+        int i = std::min(num_candidates, kMaxCandidates - 1);
+        num_candidates = std::min(num_candidates + 1, kMaxCandidates);
+        while (i > 0 && candidates[i - 1]->confidence < det.confidence) {
+            candidates[i] = candidates[i - 1];
+            --i;
+        }
+        candidates[i] = &det;
+    }
+    std::array<cv::Point2f, kMaxCandidates> points;
+    for (int c = 0; c < num_candidates; ++c) {
+        points[c] = bottom_center(candidates[c]->box);
+    }
+
+    std::array<cv::Point2f, kMaxHypotheses> predicted;
+    std::array<float, kMaxHypotheses> gate;
+    std::array<int, kMaxHypotheses> match;
+    match.fill(-1);
+    for (int h = 0; h < kMaxHypotheses; ++h) {
+        predicted[h] = hypotheses_[h].position + hypotheses_[h].velocity;
+        gate[h] = kGatePixels * (1 + hypotheses_[h].misses + propagated_frames_);
+    }
+
+    // Greedy association on gate-normalized distance; at most kMaxHypotheses rounds over a small table
+    std::array<bool, kMaxCandidates> used{};
+    for (int round = 0; round < kMaxHypotheses; ++round) {
+        float best_cost = std::numeric_limits<float>::infinity();
+        int best_h = -1;
+        int best_c = -1;
+        for (int h = 0; h < kMaxHypotheses; ++h) {
+            if (!hypotheses_[h].active || match[h] >= 0) {
+                continue;
+            }
+            for (int c = 0; c < num_candidates; ++c) {
+                float cost = used[c] ? best_cost : static_cast<float>(cv::norm(points[c] - predicted[h])) / gate[h];
+                if (cost <= 1.0f && cost < best_cost) {
+                    best_cost = cost;
+                    best_h = h;
+                    best_c = c;
+                }
+            }
+        }
+        if (best_h < 0) {
+            break;
+        }
+        match[best_h] = best_c;
+        used[best_c] = true;
+    }
+
+    for (int h = 0; h < kMaxHypotheses; ++h) {
+        Hypothesis& hypothesis = hypotheses_[h];
+        if (!hypothesis.active) {
+            continue;
+        }
+        if (match[h] >= 0) {
+            cv::Point2f residual = points[match[h]] - predicted[h];
+            float fit = 1.0f - static_cast<float>(cv::norm(residual)) / gate[h];
+            hypothesis.position = predicted[h] + kPositionGain * residual;
+            // The residual built up over every frame propagated since the last detector run
+            hypothesis.velocity += kVelocityGain / (1 + propagated_frames_) * residual;
+            hypothesis.score = kScoreDecay * hypothesis.score + candidates[match[h]]->confidence * fit;
+            hypothesis.confidence += kConfidenceGain * (candidates[match[h]]->confidence * fit - hypothesis.confidence);
+            hypothesis.misses = 0;
+        } else {
+            hypothesis.position = predicted[h];
+            hypothesis.score *= kScoreDecay;
+            hypothesis.confidence *= kScoreDecay;
+            if (++hypothesis.misses > max_frames_to_skip_) {
+                hypothesis.active = false;
+                if (selected_ == h) {
+                    selected_ = -1;
+                }
+            }
+        }
+    }
+
+    // Unmatched candidates start new hypotheses, replacing the weakest unselected one if they outrank it
+    for (int c = 0; c < num_candidates; ++c) {
+        if (used[c]) {
+            continue;
+        }
+        int slot = -1;
+        for (int h = 0; h < kMaxHypotheses && slot < 0; ++h) {
+            slot = hypotheses_[h].active ? -1 : h;
         }
+        if (slot < 0) {
+            for (int h = 0; h < kMaxHypotheses; ++h) {
+                if (h != selected_ && (slot < 0 || hypotheses_[h].score < hypotheses_[slot].score)) {
+                    slot = h;
+                }
+            }
+            if (hypotheses_[slot].score >= candidates[c]->confidence) {
+                break; // later candidates have lower confidence still
+            }
+        }
+        hypotheses_[slot] = {true, points[c], cv::Point2f(), candidates[c]->confidence, candidates[c]->confidence, 0};
+        match[slot] = c;
+    }
+
+    int best = -1;
+    for (int h = 0; h < kMaxHypotheses; ++h) {
+        if (hypotheses_[h].active && (best < 0 || hypotheses_[h].score > hypotheses_[best].score)) {
+            best = h;
+        }
+    }
+    switched = best >= 0 && best != selected_ &&
+               (selected_ < 0 || hypotheses_[best].score > kSwitchMargin * hypotheses_[selected_].score);
+    if (switched) {
+        selected_ = best;
+    }
+    if (selected_ < 0 || match[selected_] < 0) {
+        return nullptr;
     }
+    selected_detection_ = points[match[selected_]];
+    return &selected_detection_;
+}
+
+void BallTracker::update(const std::vector<Detection>& detections) {
+    bool switched = false;
+    const cv::Point2f* ball = update_hypotheses(detections, switched);
+    propagated_frames_ = 0;
 
-    if (best_ball) {
-        cv::Point2f center(best_ball->box.x + best_ball->box.width / 2.0f, 
-                           best_ball->box.y + best_ball->box.height);
-        if (!is_tracking_) {
-            kf_.init(center);
+    if (ball) {
+        // A newly selected hypothesis restarts the filter instead of dragging it across the image
+        if (!is_tracking_ || switched) {
+            kf_.init(*ball);
             is_tracking_ = true;
         } else {
-            kf_.correct(center);
+            kf_.correct(*ball);
         }
         frames_since_detection_ = 0;
+        detection_ = {0, *ball};
     } else {
+        detection_ = {-1, {}};
+        if (switched) {
+            kf_.init(hypotheses_[selected_].position);
+            is_tracking_ = true;
+            frames_since_detection_ = hypotheses_[selected_].misses;
+        }
         if (is_tracking_) {
             frames_since_detection_++;
             if (frames_since_detection_ > max_frames_to_skip_) {
@@ -44,6 +197,66 @@ void BallTracker::update(const std::vector<Detection>& detections) {
     }
 }
 
+void BallTracker::propagate() {
+    for (Hypothesis& hypothesis : hypotheses_) {
+        if (hypothesis.active) {
+            hypothesis.position += hypothesis.velocity;
+        }
+    }
+    ++propagated_frames_;
+    detection_ = {-1, {}};
+    if (is_tracking_) {
+        track_ = {0, kf_.predict()};
+    }
+}
+
 std::pair<int, cv::Point2f> BallTracker::get_track() {
     return track_;
-}
\ No newline at end of file
+}
+
+float BallTracker::get_confidence() const {
+    return selected_ >= 0 ? hypotheses_[selected_].confidence : 0.0f;
+}
+
+cv::Rect BallTracker::search_region(float min_confidence) const {
+    if (track_.first == -1 || get_confidence() < min_confidence) {
+        return cv::Rect();
+    }
+    return cv::Rect(cv::Point(track_.second), cv::Size(1, 1));
+}
+
+void BallTracker::save_state(std::ostream& out) const {
+    kf_.save_state(out);
+    serialization::write_pod<uint8_t>(out, is_tracking_ ? 1 : 0);
+    serialization::write_pod<int32_t>(out, frames_since_detection_);
+    serialization::write_pod<int32_t>(out, track_.first);
+    serialization::write_point(out, track_.second);
+    for (const Hypothesis& hypothesis : hypotheses_) {
+        serialization::write_pod<uint8_t>(out, hypothesis.active ? 1 : 0);
+        serialization::write_point(out, hypothesis.position);
+        serialization::write_point(out, hypothesis.velocity);
+        serialization::write_pod(out, hypothesis.score);
+        serialization::write_pod(out, hypothesis.confidence);
+        serialization::write_pod<int32_t>(out, hypothesis.misses);
+    }
+    serialization::write_pod<int32_t>(out, selected_);
+    serialization::write_pod<int32_t>(out, propagated_frames_);
+}
+
+void BallTracker::load_state(std::istream& in) {
+    kf_.load_state(in);
+    is_tracking_ = serialization::read_pod<uint8_t>(in) != 0;
+    frames_since_detection_ = serialization::read_pod<int32_t>(in);
+    track_.first = serialization::read_pod<int32_t>(in);
+    track_.second = serialization::read_point(in);
+    for (Hypothesis& hypothesis : hypotheses_) {
+        hypothesis.active = serialization::read_pod<uint8_t>(in) != 0;
+        hypothesis.position = serialization::read_point(in);
+        hypothesis.velocity = serialization::read_point(in);
+        hypothesis.score = serialization::read_pod<float>(in);
+        hypothesis.confidence = serialization::read_pod<float>(in);
+        hypothesis.misses = serialization::read_pod<int32_t>(in);
+    }
+    selected_ = serialization::read_pod<int32_t>(in);
+    propagated_frames_ = serialization::read_pod<int32_t>(in);
+}
@@ -1,26 +1,77 @@
 #ifndef BALL_TRACKER_H
 #define BALL_TRACKER_H
 
+#include <array>
+#include <istream>
+#include <ostream>
 #include <vector>
 #include <opencv2/opencv.hpp>
-#include "detection/yolov8.h"
+#include "detection/detection.h"
 #include "utils/kalman_filter.h"
 
+// Keeps a few ball hypotheses alive at once, each with its own constant-velocity estimate and a
+// motion-consistency score, and follows the most plausible one. A spurious ball-like detection
+// (penalty spot, head, spare ball) starts its own hypothesis instead of pulling the track, and
+// only takes over once it has clearly out-scored the followed ball.
 class BallTracker {
 public:
+    static constexpr int kMaxHypotheses = 4;
+    static constexpr int kMaxCandidates = 8; // highest-confidence detections considered per frame
+
     BallTracker();
     ~BallTracker();
 
     void update(const std::vector<Detection>& detections);
 
+    // Advances the ball on a frame the detector did not run on (keyframe mode): the hypotheses and
+    // the output filter coast on their motion models without counting a miss, and get_detection()
+    // reports none
+    void propagate();
+
     std::pair<int, cv::Point2f> get_track();
 
+    // The raw detection accepted in the last update (id 0), or {-1, ...} if there was none;
+    // unlike get_track() never a Kalman prediction
+    std::pair<int, cv::Point2f> get_detection() const { return detection_; }
+
+    // How sure the tracker is of the followed ball: a running average of its detections'
+    // confidence weighted by how well they fit the predicted motion, decaying with every missed
+    // frame; 0 while no ball is followed
+    float get_confidence() const;
+
+    // Where to look for the ball in the next frame: the predicted pixel position as a 1x1 rect
+    // while get_confidence() is at least `min_confidence`, otherwise empty (search everywhere)
+    cv::Rect search_region(float min_confidence) const;
+
+    // Checkpoint support
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
 private:
+    struct Hypothesis {
+        bool active = false;
+        cv::Point2f position;    // pixels
+        cv::Point2f velocity;    // pixels per frame
+        float score = 0.0f;      // decaying sum of confidence weighted by how well detections fit
+        float confidence = 0.0f; // running average of the same, see get_confidence()
+        int misses = 0;          // consecutive frames without a detection
+    };
+
+    // Associates this frame's detections with the hypotheses and returns the detection matched
+    // to the selected hypothesis, or nullptr; `switched` is set when a new hypothesis was selected
+    const cv::Point2f* update_hypotheses(const std::vector<Detection>& detections, bool& switched);
+
+    std::array<Hypothesis, kMaxHypotheses> hypotheses_;
+    int selected_ = -1;
+    cv::Point2f selected_detection_;
+    int propagated_frames_ = 0; // frames propagated since the last update
+
     KalmanFilter kf_;
     bool is_tracking_ = false;
     int frames_since_detection_ = 0;
-    const int max_frames_to_skip_ = 10; // Allow more frames for ball occlusion
+    static constexpr int max_frames_to_skip_ = 10; // Allow more frames for ball occlusion
     std::pair<int, cv::Point2f> track_;
+    std::pair<int, cv::Point2f> detection_{-1, {}};
 };
 
 #endif // BALL_TRACKER_H
@@ -0,0 +1,13 @@
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include <opencv2/opencv.hpp>
+
+// Struct to hold detection results
+struct Detection {
+    cv::Rect box;
+    float confidence;
+    int class_id;
+};
+
+#endif // DETECTION_H
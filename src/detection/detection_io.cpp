@@ -0,0 +1,109 @@
+#include "detection/detection_io.h"
+#include "utils/serialization.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t kDetectionMagic = 0x53544544; // "DETS"
+const uint32_t kDetectionVersion = 1;
+
+// COCO class IDs the dump is split by
+const int kPersonClass = 0;
+const int kBallClass = 32;
+
+// Boxes are stored as 16-bit pixel coordinates, which covers frames up to 8K
+int16_t to_i16(int value) {
+    return static_cast<int16_t>(std::clamp<int>(value, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max()));
+}
+
+void write_box(std::ostream& out, const Detection& det) {
+    serialization::write_pod(out, to_i16(det.box.x));
+    serialization::write_pod(out, to_i16(det.box.y));
+    serialization::write_pod(out, to_i16(det.box.width));
+    serialization::write_pod(out, to_i16(det.box.height));
+    serialization::write_pod(out, det.confidence);
+}
+
+Detection read_box(std::istream& in, int class_id) {
+    Detection det;
+    det.box.x = serialization::read_pod<int16_t>(in);
+    det.box.y = serialization::read_pod<int16_t>(in);
+    det.box.width = serialization::read_pod<int16_t>(in);
+    det.box.height = serialization::read_pod<int16_t>(in);
+    det.confidence = serialization::read_pod<float>(in);
+    det.class_id = class_id;
+    return det;
+}
+
+} // namespace
+
+DetectionWriter::DetectionWriter(const std::string& path, double fps)
+    : out_(path, std::ios::binary | std::ios::trunc), path_(path) {
+    if (!out_.is_open()) {
+        throw std::runtime_error("Could not open detection dump " + path + " for writing.");
+    }
+    serialization::write_pod(out_, kDetectionMagic);
+    serialization::write_pod(out_, kDetectionVersion);
+    serialization::write_pod(out_, fps);
+}
+
+void DetectionWriter::write(const DetectionFrame& frame) {
+    size_t num_players = std::min<size_t>(frame.players.size(), std::numeric_limits<uint16_t>::max());
+    size_t num_balls = std::min<size_t>(frame.balls.size(), std::numeric_limits<uint16_t>::max());
+
+    serialization::write_pod<int32_t>(out_, frame.frame_index);
+    serialization::write_pod<uint16_t>(out_, static_cast<uint16_t>(num_players));
+    serialization::write_pod<uint16_t>(out_, static_cast<uint16_t>(num_balls));
+    for (size_t i = 0; i < num_players; ++i) {
+        write_box(out_, frame.players[i]);
+        cv::Scalar color = i < frame.player_colors.size() ? frame.player_colors[i] : cv::Scalar(-1, -1, -1);
+        for (int c = 0; c < 3; ++c) {
+            serialization::write_pod(out_, static_cast<float>(color[c]));
+        }
+    }
+    for (size_t i = 0; i < num_balls; ++i) {
+        write_box(out_, frame.balls[i]);
+    }
+    if (!out_) {
+        throw std::runtime_error("Failed to write detection dump " + path_);
+    }
+}
+
+DetectionReader::DetectionReader(const std::string& path) : buffer_(1 << 20) {
+    in_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+    in_.open(path, std::ios::binary);
+    if (!in_.is_open()) {
+        throw std::runtime_error("Could not open detection dump " + path);
+    }
+    if (serialization::read_pod<uint32_t>(in_) != kDetectionMagic ||
+        serialization::read_pod<uint32_t>(in_) != kDetectionVersion) {
+        throw std::runtime_error(path + " is not a detection dump (or has an unsupported version).");
+    }
+    fps_ = serialization::read_pod<double>(in_);
+}
+
+bool DetectionReader::read(DetectionFrame& frame) {
+    if (in_.peek() == std::char_traits<char>::eof()) {
+        return false;
+    }
+    frame.frame_index = serialization::read_pod<int32_t>(in_);
+    uint16_t num_players = serialization::read_pod<uint16_t>(in_);
+    uint16_t num_balls = serialization::read_pod<uint16_t>(in_);
+
+    frame.players.clear();
+    frame.player_colors.clear();
+    frame.balls.clear();
+    for (uint16_t i = 0; i < num_players; ++i) {
+        frame.players.push_back(read_box(in_, kPersonClass));
+        float h = serialization::read_pod<float>(in_);
+        float s = serialization::read_pod<float>(in_);
+        float v = serialization::read_pod<float>(in_);
+        frame.player_colors.emplace_back(h, s, v);
+    }
+    for (uint16_t i = 0; i < num_balls; ++i) {
+        frame.balls.push_back(read_box(in_, kBallClass));
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef DETECTION_IO_H
+#define DETECTION_IO_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "detection/detection.h"
+
+// Filtered detector output for one analysed frame, as consumed by the trackers
+struct DetectionFrame {
+    int frame_index = 0;
+    std::vector<Detection> players;
+    std::vector<cv::Scalar> player_colors; // From PlayerTracker::extract_colors, parallel to players
+    std::vector<Detection> balls;
+};
+
+// Compact binary dump of per-frame detections, so tracking and analytics can be re-run without
+// decoding the video or running the detector.
+//
+// Layout (host byte order): magic "DETS", version, fps (f64), then one record per frame:
+//   i32 frame_index, u16 num_players, u16 num_balls,
+//   players: i16 x, y, w, h, f32 confidence, f32 h, s, v
+//   balls:   i16 x, y, w, h, f32 confidence
+class DetectionWriter {
+public:
+    // Throws std::runtime_error if the file cannot be created
+    DetectionWriter(const std::string& path, double fps);
+
+    void write(const DetectionFrame& frame);
+
+private:
+    std::ofstream out_;
+    std::string path_;
+};
+
+class DetectionReader {
+public:
+    // Throws std::runtime_error if the file is missing or not a detection dump
+    explicit DetectionReader(const std::string& path);
+
+    double fps() const { return fps_; }
+
+    // Reads the next frame; returns false at end of file. Throws on a truncated record.
+    bool read(DetectionFrame& frame);
+
+private:
+    std::ifstream in_;
+    std::vector<char> buffer_;
+    double fps_ = 0.0;
+};
+
+#endif // DETECTION_IO_H
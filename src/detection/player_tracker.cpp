@@ -1,11 +1,59 @@
 #include "detection/player_tracker.h"
+#include "utils/serialization.h"
 #include <algorithm> // For std::max
+#include <cmath>     // For std::cos, std::sin
 #include <numeric>   // For std::iota
 #include <opencv2/imgproc.hpp> // For cvtColor, kmeans
+#include <opencv2/video/tracking.hpp> // For calcOpticalFlowPyrLK
 #include <map> // For std::map
 #include <set> // For std::set
+#include <iterator> // For std::next
 #include <iostream> // For debugging, can be removed later
 
+namespace {
+
+// Optical flow between keyframes: a kFlowGrid x kFlowGrid grid of points per box, of which at
+// least kMinFlowPoints must be followed for the median shift to correct the track
+const int kFlowGrid = 3;
+const int kMinFlowPoints = 4;
+const cv::Size kFlowWindow(15, 15);
+const int kFlowPyramidLevels = 2;
+
+// Online team assignment: jersey colors of kTeamWarmupUpdates detection frames (two seconds at
+// 25 fps), and at least kMinTeamSamples of them, are clustered into the team colors
+const int kTeamWarmupUpdates = 50;
+const size_t kMinTeamSamples = 30;
+const size_t kMaxTeamSamples = 4096;
+// A track's votes are halved once one team reaches this count, so a track that changes jersey
+// (an ID switch) is relabelled after about a second of evidence
+const int kMaxTeamVotes = 50;
+// Team colors follow gradual lighting changes as a running mean over about this many samples
+const double kTeamColorMemory = 1000.0;
+
+// Team colors are compared as chroma coordinates (S cos H, S sin H) plus V rather than raw HSV:
+// hue wraps at 180, so a red kit straddles both ends of the range, and the hue of a white or
+// black kit is noise that only the low saturation makes irrelevant
+cv::Scalar color_features(const cv::Scalar& hsv) {
+    double hue = hsv[0] * CV_PI / 90.0;
+    return cv::Scalar(hsv[1] * std::cos(hue), hsv[1] * std::sin(hue), hsv[2]);
+}
+
+double color_distance2(const cv::Scalar& a, const cv::Scalar& b) {
+    double distance2 = 0.0;
+    for (int c = 0; c < 3; ++c) {
+        distance2 += (a[c] - b[c]) * (a[c] - b[c]);
+    }
+    return distance2;
+}
+
+float median(std::vector<float>& values) {
+    auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+} // namespace
+
 PlayerTracker::PlayerTracker() : next_track_id_(0) {}
 
 PlayerTracker::~PlayerTracker() {}
@@ -64,7 +112,26 @@ cv::Scalar PlayerTracker::get_dominant_color(const cv::Mat& image_roi) {
 }
 
 
+std::vector<cv::Scalar> PlayerTracker::extract_colors(const std::vector<Detection>& detections, const cv::Mat& frame) {
+    std::vector<cv::Scalar> colors;
+    colors.reserve(detections.size());
+    for (const auto& det : detections) {
+        cv::Rect bbox_int = det.box;
+        if (bbox_int.x >= 0 && bbox_int.y >= 0 && bbox_int.x + bbox_int.width <= frame.cols && bbox_int.y + bbox_int.height <= frame.rows) {
+            cv::Mat player_roi = frame(bbox_int);
+            colors.push_back(get_dominant_color(player_roi));
+        } else {
+            colors.push_back(cv::Scalar(-1, -1, -1));
+        }
+    }
+    return colors;
+}
+
 void PlayerTracker::update(const std::vector<Detection>& detections, const cv::Mat& frame) {
+    update(detections, extract_colors(detections, frame));
+}
+
+void PlayerTracker::update(const std::vector<Detection>& detections, const std::vector<cv::Scalar>& colors) {
     // 1. Predict new locations of existing tracks
     for (auto& track : tracks_) {
         cv::Point2f predicted_pos = track.kf.predict();
@@ -101,19 +168,15 @@ void PlayerTracker::update(const std::vector<Detection>& detections, const cv::M
             matched_detections[best_match_idx] = true;
 
             // Update dominant color for matched track
-            cv::Rect bbox_int = detections[best_match_idx].box;
-            if (bbox_int.x >= 0 && bbox_int.y >= 0 && bbox_int.x + bbox_int.width <= frame.cols && bbox_int.y + bbox_int.height <= frame.rows) {
-                cv::Mat player_roi = frame(bbox_int);
-                tracks_[i].dominant_color = get_dominant_color(player_roi);
+            if (colors[best_match_idx][0] >= 0) {
+                tracks_[i].dominant_color = colors[best_match_idx];
+                observe_color(tracks_[i].id, colors[best_match_idx]);
             }
         }
     }
 
     // 3. Remove stale tracks
-    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
-        [this](const Track& track) {
-            return track.frames_since_update > max_frames_to_skip_;
-        }), tracks_.end());
+    remove_stale_tracks();
 
     // 4. Create new tracks for unmatched detections
     for (int i = 0; i < detections.size(); ++i) {
@@ -127,16 +190,120 @@ void PlayerTracker::update(const std::vector<Detection>& detections, const cv::M
             new_track.frames_since_update = 0;
 
             // Get dominant color for new track
-            cv::Rect bbox_int = detections[i].box;
-            if (bbox_int.x >= 0 && bbox_int.y >= 0 && bbox_int.x + bbox_int.width <= frame.cols && bbox_int.y + bbox_int.height <= frame.rows) {
-                cv::Mat player_roi = frame(bbox_int);
-                new_track.dominant_color = get_dominant_color(player_roi);
+            if (colors[i][0] >= 0) {
+                new_track.dominant_color = colors[i];
+                observe_color(new_track.id, colors[i]);
             } else {
                 new_track.dominant_color = cv::Scalar(0,0,0); // Default to black if ROI is invalid
             }
             tracks_.push_back(new_track);
         }
     }
+
+    // 5. Fit the team colors once the warm-up is over
+    if (team_colors_.empty() && ++updates_ >= kTeamWarmupUpdates && color_samples_.size() >= kMinTeamSamples) {
+        assign_teams();
+    }
+}
+
+void PlayerTracker::observe_color(int track_id, const cv::Scalar& hsv) {
+    cv::Scalar features = color_features(hsv);
+    if (team_colors_.empty()) {
+        if (color_samples_.size() < kMaxTeamSamples) {
+            color_samples_.push_back(features);
+        }
+        return;
+    }
+
+    size_t nearest = 0;
+    for (size_t j = 1; j < team_colors_.size(); ++j) {
+        if (color_distance2(features, team_colors_[j].center) < color_distance2(features, team_colors_[nearest].center)) {
+            nearest = j;
+        }
+    }
+    cv::Scalar& center = team_colors_[nearest].center;
+    for (int c = 0; c < 3; ++c) {
+        center[c] += (features[c] - center[c]) / kTeamColorMemory;
+    }
+
+    std::vector<int>& votes = team_votes_[track_id];
+    votes.resize(team_colors_.size(), 0);
+    if (++votes[nearest] > kMaxTeamVotes) {
+        for (int& vote : votes) {
+            vote /= 2;
+        }
+    }
+    size_t team = std::max_element(votes.begin(), votes.end()) - votes.begin();
+    team_assignments_[track_id] = team_colors_[team].label;
+}
+
+void PlayerTracker::propagate(const cv::Mat& prev_gray, const cv::Mat& gray) {
+    // Grid points inside each box as it was in the previous frame, all tracked in one call
+    std::vector<cv::Point2f> points;
+    points.reserve(tracks_.size() * kFlowGrid * kFlowGrid);
+    const float max_x = static_cast<float>(prev_gray.cols - 1);
+    const float max_y = static_cast<float>(prev_gray.rows - 1);
+    for (const auto& track : tracks_) {
+        for (int gy = 1; gy <= kFlowGrid; ++gy) {
+            for (int gx = 1; gx <= kFlowGrid; ++gx) {
+                float x = track.last_bbox.x + track.last_bbox.width * gx / (kFlowGrid + 1);
+                float y = track.last_bbox.y + track.last_bbox.height * gy / (kFlowGrid + 1);
+                points.emplace_back(std::min(std::max(x, 0.0f), max_x), std::min(std::max(y, 0.0f), max_y));
+            }
+        }
+    }
+    std::vector<cv::Point2f> moved;
+    std::vector<unsigned char> status;
+    std::vector<float> error;
+    if (!points.empty()) {
+        cv::calcOpticalFlowPyrLK(prev_gray, gray, points, moved, status, error, kFlowWindow, kFlowPyramidLevels);
+    }
+
+    std::vector<float> dx, dy;
+    for (size_t i = 0; i < tracks_.size(); ++i) {
+        Track& track = tracks_[i];
+        cv::Point2f predicted_pos = track.kf.predict();
+
+        dx.clear();
+        dy.clear();
+        for (size_t k = i * kFlowGrid * kFlowGrid; k < (i + 1) * kFlowGrid * kFlowGrid; ++k) {
+            if (status[k]) {
+                dx.push_back(moved[k].x - points[k].x);
+                dy.push_back(moved[k].y - points[k].y);
+            }
+        }
+        if (static_cast<int>(dx.size()) >= kMinFlowPoints) {
+            // The median ignores points on the background or on another player
+            track.last_bbox.x += median(dx);
+            track.last_bbox.y += median(dy);
+            track.kf.correct(cv::Point2f(track.last_bbox.x + track.last_bbox.width / 2.0f,
+                                         track.last_bbox.y + track.last_bbox.height));
+        } else {
+            track.last_bbox.x = predicted_pos.x - track.last_bbox.width / 2.0f;
+            track.last_bbox.y = predicted_pos.y - track.last_bbox.height;
+            track.frames_since_update++;
+        }
+    }
+    remove_stale_tracks();
+}
+
+void PlayerTracker::remove_stale_tracks() {
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
+        [this](const Track& track) {
+            return track.frames_since_update > max_frames_to_skip_;
+        }), tracks_.end());
+
+    // Team state of tracks that are gone
+    std::set<int> live_ids;
+    for (const auto& track : tracks_) {
+        live_ids.insert(track.id);
+    }
+    for (auto it = team_votes_.begin(); it != team_votes_.end();) {
+        it = live_ids.count(it->first) ? std::next(it) : team_votes_.erase(it);
+    }
+    for (auto it = team_assignments_.begin(); it != team_assignments_.end();) {
+        it = live_ids.count(it->first) ? std::next(it) : team_assignments_.erase(it);
+    }
 }
 
 std::vector<std::pair<int, cv::Point2f>> PlayerTracker::get_tracks() {
@@ -150,74 +317,155 @@ std::vector<std::pair<int, cv::Point2f>> PlayerTracker::get_tracks() {
 }
 
 void PlayerTracker::assign_teams() {
-    if (tracks_.empty()) {
-        return;
+    // The warm-up samples, or the current jersey colors when the team colors are refitted
+    std::vector<cv::Scalar> samples = color_samples_;
+    if (samples.empty()) {
+        for (const auto& track : tracks_) {
+            samples.push_back(color_features(track.dominant_color));
+        }
     }
-
-    // Collect all dominant colors
-    cv::Mat all_colors_hsv(tracks_.size(), 3, CV_32F);
-    std::map<int, int> track_id_to_row_idx; // Map track ID to its row in all_colors_hsv
-    for (size_t i = 0; i < tracks_.size(); ++i) {
-        all_colors_hsv.at<float>(i, 0) = tracks_[i].dominant_color[0]; // H
-        all_colors_hsv.at<float>(i, 1) = tracks_[i].dominant_color[1]; // S
-        all_colors_hsv.at<float>(i, 2) = tracks_[i].dominant_color[2]; // V
-        track_id_to_row_idx[tracks_[i].id] = i;
+    if (samples.size() < 2) {
+        return;
     }
 
-    // Determine number of clusters (K)
-    // Assuming 2 teams + 1 referee = 3 clusters, or 2 teams if no referee
-    int K = std::min((int)tracks_.size(), 3); 
-    if (K < 2) { // Need at least 2 clusters for 2 teams
-        K = tracks_.size(); // Assign each player to their own "team" if less than 2
-        if (K == 0) return;
+    cv::Mat all_colors(static_cast<int>(samples.size()), 3, CV_32F);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            all_colors.at<float>(i, c) = static_cast<float>(samples[i][c]);
+        }
     }
 
+    // Two teams and the referees
+    const int K = std::min(static_cast<int>(samples.size()), 3);
     cv::Mat labels;
     cv::Mat centers;
     cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 10, 1.0);
-    cv::kmeans(all_colors_hsv, K, labels, criteria, 1, cv::KMEANS_PP_CENTERS, centers);
+    cv::kmeans(all_colors, K, labels, criteria, 3, cv::KMEANS_PP_CENTERS, centers);
 
-    // Analyze clusters and assign team labels
-    std::map<int, std::vector<int>> cluster_to_track_ids;
-    for (size_t i = 0; i < tracks_.size(); ++i) {
-        int cluster_label = labels.at<int>(i);
-        cluster_to_track_ids[cluster_label].push_back(tracks_[i].id);
+    // Clusters by size: the two largest are the teams
+    std::vector<int> sizes(K, 0);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        sizes[labels.at<int>(i)]++;
     }
+    std::vector<int> order(K);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
 
-    // Sort clusters by size (number of players)
-    std::vector<std::pair<int, std::vector<int>>> sorted_clusters;
-    for (auto const& [cluster_label, track_ids] : cluster_to_track_ids) {
-        sorted_clusters.push_back({(int)track_ids.size(), track_ids});
+    team_colors_.assign(K, TeamColor());
+    for (int k = 0; k < K; ++k) {
+        team_colors_[k].center = cv::Scalar(centers.at<float>(k, 0), centers.at<float>(k, 1), centers.at<float>(k, 2));
+    }
+    team_colors_[order[0]].label = "Team A";
+    if (K > 1) {
+        team_colors_[order[1]].label = "Team B";
+    }
+    if (K > 2) {
+        TeamColor& third = team_colors_[order[2]];
+        if (sizes[order[2]] * 2 < sizes[order[1]]) {
+            // Heuristic for Referee: a cluster much smaller than either team
+            third.label = "Referee";
+        } else {
+            // As large as a team: k-means split one team's jerseys (shade, shadow), so it joins
+            // the nearer team
+            const TeamColor& a = team_colors_[order[0]];
+            const TeamColor& b = team_colors_[order[1]];
+            third.label = color_distance2(third.center, a.center) <= color_distance2(third.center, b.center) ? a.label : b.label;
+        }
     }
-    std::sort(sorted_clusters.rbegin(), sorted_clusters.rend()); // Sort in descending order of size
 
-    // Assign team labels
+    // Relabel every track from its current jersey
+    color_samples_.clear();
+    color_samples_.shrink_to_fit();
+    team_votes_.clear();
     team_assignments_.clear();
-    std::set<std::string> assigned_labels; // To ensure unique labels like "Team A", "Team B", "Referee"
-
-    for (size_t i = 0; i < sorted_clusters.size(); ++i) {
-        const auto& cluster_info = sorted_clusters[i];
-        const std::vector<int>& track_ids = cluster_info.second;
-        std::string current_label = "Unknown";
-
-        if (i == 0 && assigned_labels.find("Team A") == assigned_labels.end()) {
-            current_label = "Team A";
-            assigned_labels.insert("Team A");
-        } else if (i == 1 && assigned_labels.find("Team B") == assigned_labels.end()) {
-            current_label = "Team B";
-            assigned_labels.insert("Team B");
-        } else if (track_ids.size() <= 2 && assigned_labels.find("Referee") == assigned_labels.end()) {
-            // Heuristic for Referee: a very small cluster (1 or 2 players)
-            current_label = "Referee";
-            assigned_labels.insert("Referee");
-        } else {
-            // For any other clusters, assign "Unknown" or a generic "Team X" if more teams are expected
-            // For simplicity, we'll stick to "Unknown" for remaining small clusters
-            current_label = "Unknown";
+    for (const auto& track : tracks_) {
+        observe_color(track.id, track.dominant_color);
+    }
+}
+
+void PlayerTracker::save_state(std::ostream& out) const {
+    serialization::write_pod<int32_t>(out, next_track_id_);
+
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(tracks_.size()));
+    for (const auto& track : tracks_) {
+        serialization::write_pod<int32_t>(out, track.id);
+        track.kf.save_state(out);
+        serialization::write_rect(out, track.last_bbox);
+        serialization::write_pod<int32_t>(out, track.frames_since_update);
+        serialization::write_scalar(out, track.dominant_color);
+    }
+
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(team_assignments_.size()));
+    for (const auto& [track_id, team] : team_assignments_) {
+        serialization::write_pod<int32_t>(out, track_id);
+        serialization::write_string(out, team);
+    }
+
+    serialization::write_pod<int32_t>(out, updates_);
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(color_samples_.size()));
+    for (const cv::Scalar& sample : color_samples_) {
+        serialization::write_scalar(out, sample);
+    }
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(team_colors_.size()));
+    for (const TeamColor& color : team_colors_) {
+        serialization::write_scalar(out, color.center);
+        serialization::write_string(out, color.label);
+    }
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(team_votes_.size()));
+    for (const auto& [track_id, votes] : team_votes_) {
+        serialization::write_pod<int32_t>(out, track_id);
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(votes.size()));
+        for (int vote : votes) {
+            serialization::write_pod<int32_t>(out, vote);
         }
+    }
+}
 
-        for (int track_id : track_ids) {
-            team_assignments_[track_id] = current_label;
+void PlayerTracker::load_state(std::istream& in) {
+    next_track_id_ = serialization::read_pod<int32_t>(in);
+
+    tracks_.clear();
+    uint32_t num_tracks = serialization::read_pod<uint32_t>(in);
+    tracks_.reserve(num_tracks);
+    for (uint32_t i = 0; i < num_tracks; ++i) {
+        Track track;
+        track.id = serialization::read_pod<int32_t>(in);
+        track.kf.load_state(in);
+        track.last_bbox = serialization::read_rect(in);
+        track.frames_since_update = serialization::read_pod<int32_t>(in);
+        track.dominant_color = serialization::read_scalar(in);
+        tracks_.push_back(track);
+    }
+
+    team_assignments_.clear();
+    uint32_t num_assignments = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < num_assignments; ++i) {
+        int track_id = serialization::read_pod<int32_t>(in);
+        team_assignments_[track_id] = serialization::read_string(in);
+    }
+
+    updates_ = serialization::read_pod<int32_t>(in);
+    color_samples_.clear();
+    uint32_t num_samples = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < num_samples; ++i) {
+        color_samples_.push_back(serialization::read_scalar(in));
+    }
+    team_colors_.clear();
+    uint32_t num_colors = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < num_colors; ++i) {
+        TeamColor color;
+        color.center = serialization::read_scalar(in);
+        color.label = serialization::read_string(in);
+        team_colors_.push_back(color);
+    }
+    team_votes_.clear();
+    uint32_t num_voters = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < num_voters; ++i) {
+        int track_id = serialization::read_pod<int32_t>(in);
+        std::vector<int>& votes = team_votes_[track_id];
+        votes.resize(serialization::read_pod<uint32_t>(in));
+        for (int& vote : votes) {
+            vote = serialization::read_pod<int32_t>(in);
         }
     }
-}
\ No newline at end of file
+}
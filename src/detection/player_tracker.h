@@ -3,9 +3,11 @@
 
 #include <vector>
 #include <opencv2/opencv.hpp>
-#include "detection/yolov8.h"
+#include "detection/detection.h"
 #include "utils/kalman_filter.h"
+#include <istream>
 #include <map>
+#include <ostream>
 #include <string>
 
 struct Track {
@@ -23,20 +25,58 @@ public:
 
     void update(const std::vector<Detection>& detections, const cv::Mat& frame);
 
+    // Same as above with jersey colors precomputed by extract_colors, so tracking can run
+    // without the video frame (detection replay)
+    void update(const std::vector<Detection>& detections, const std::vector<cv::Scalar>& colors);
+
+    // Moves the tracks from `prev_gray` to `gray` (consecutive grayscale frames) on a frame without
+    // detections: Kalman prediction, corrected by the median Lucas-Kanade flow of a grid of points
+    // inside each box. Tracks whose points cannot be followed coast on the prediction and age as if
+    // they had missed a detection.
+    void propagate(const cv::Mat& prev_gray, const cv::Mat& gray);
+
+    // Dominant jersey color (HSV) of each detection; boxes not fully inside the frame get a
+    // negative (invalid) color
+    std::vector<cv::Scalar> extract_colors(const std::vector<Detection>& detections, const cv::Mat& frame);
+
+    // Teams are assigned online: update() collects jersey colors for a warm-up of
+    // kTeamWarmupUpdates detection frames, then clusters them into team colors (assign_teams) and
+    // from there on labels each track by a vote over the team colors nearest to its jersey.
+    // Calling assign_teams() earlier fits the team colors from the colors seen so far.
     void assign_teams();
 
     std::vector<std::pair<int, cv::Point2f>> get_tracks();
 
+    // Empty during the warm-up
     const std::map<int, std::string>& get_team_assignments() const { return team_assignments_; }
 
+    // Checkpoint support: tracks (including Kalman state), ID counter and team assignment state
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
 private:
+    // A cluster of jersey colors and the label given to the tracks nearest to it. The center is
+    // in the hue-free color space of color_features() in player_tracker.cpp, not HSV.
+    struct TeamColor {
+        cv::Scalar center;
+        std::string label;
+    };
+
     int next_track_id_ = 0;
     std::vector<Track> tracks_;
     std::map<int, std::string> team_assignments_;
-    const int max_frames_to_skip_ = 5;
+    static constexpr int max_frames_to_skip_ = 5;
+
+    int updates_ = 0;                        // detection frames seen, for the warm-up
+    std::vector<cv::Scalar> color_samples_;  // jersey colors seen during the warm-up, as features
+    std::vector<TeamColor> team_colors_;     // empty until the warm-up is over
+    std::map<int, std::vector<int>> team_votes_; // per track, matches per entry of team_colors_
 
     double calculate_iou(const cv::Rect2f& box1, const cv::Rect2f& box2);
+    void remove_stale_tracks();
     cv::Scalar get_dominant_color(const cv::Mat& image_roi);
+    // Records a valid jersey color of `track_id`: a warm-up sample, or a vote for its team
+    void observe_color(int track_id, const cv::Scalar& hsv);
 };
 
 #endif // PLAYER_TRACKER_H
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "detection/yolo_processing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/dnn.hpp> // For NMS
+
+std::vector<float> yolo_preprocess(const cv::Mat& image, int input_width, int input_height) {
+    std::vector<float> result(input_width * input_height * 3);
+    yolo_preprocess_into(image, input_width, input_height, result.data());
+    return result;
+}
+
+void yolo_preprocess_into(const cv::Mat& image, int input_width, int input_height, float* output) {
+    cv::Mat resized_image, float_image, rgb_image;
+    
+    cv::resize(image, resized_image, cv::Size(input_width, input_height));
+    cv::cvtColor(resized_image, rgb_image, cv::COLOR_BGR2RGB);
+    rgb_image.convertTo(float_image, CV_32FC3, 1.0 / 255.0);
+
+    std::vector<cv::Mat> channels(3);
+    cv::split(float_image, channels);
+    
+    memcpy(output, channels[0].data, input_width * input_height * sizeof(float));
+    memcpy(output + input_width * input_height, channels[1].data, input_width * input_height * sizeof(float));
+    memcpy(output + 2 * input_width * input_height, channels[2].data, input_width * input_height * sizeof(float));
+}
+
+std::vector<Detection> yolo_postprocess(const float* output, const cv::Size& original_image_size,
+                                        int input_width, int input_height) {
+    YoloCandidates candidates;
+    yolo_decode(output, cv::Rect(cv::Point(), original_image_size), original_image_size, input_width, input_height,
+                false, candidates);
+    return yolo_nms(candidates);
+}
+
+void yolo_decode(const float* output, const cv::Rect& roi, const cv::Size& image_size, int input_width,
+                 int input_height, bool drop_cut_boxes, YoloCandidates& candidates) {
+    const int num_detections = kYoloNumAnchors;
+    const int num_classes = kYoloNumClasses;
+    const int elements_per_detection = num_classes + 4;
+
+    // A box within this many pixels of an inner crop edge counts as cut
+    const int kCutMargin = 2;
+    const int kNoCut = std::numeric_limits<int>::max();
+    const int cut_left = roi.x > 0 ? roi.x + kCutMargin : -kNoCut;
+    const int cut_top = roi.y > 0 ? roi.y + kCutMargin : -kNoCut;
+    const int cut_right = roi.x + roi.width < image_size.width ? roi.x + roi.width - kCutMargin : kNoCut;
+    const int cut_bottom = roi.y + roi.height < image_size.height ? roi.y + roi.height - kCutMargin : kNoCut;
+
+    std::vector<float> transposed_output(num_detections * elements_per_detection);
+    for (int i = 0; i < num_detections; ++i) {
+        for (int j = 0; j < elements_per_detection; ++j) {
+            transposed_output[i * elements_per_detection + j] = output[j * num_detections + i];
+        }
+    }
+
+    float scale_x = static_cast<float>(roi.width) / input_width;
+    float scale_y = static_cast<float>(roi.height) / input_height;
+
+    for (int i = 0; i < num_detections; ++i) {
+        const float* detection = transposed_output.data() + i * elements_per_detection;
+        const float* class_scores = detection + 4;
+        
+        int class_id = -1;
+        float max_score = 0.0f;
+        for (int j = 0; j < num_classes; ++j) {
+            if (class_scores[j] > max_score) {
+                max_score = class_scores[j];
+                class_id = j;
+            }
+        }
+
+        if (max_score > 0.25f) { 
+            float cx = detection[0];
+            float cy = detection[1];
+            float w = detection[2];
+            float h = detection[3];
+
+            int left = roi.x + static_cast<int>((cx - 0.5 * w) * scale_x);
+            int top = roi.y + static_cast<int>((cy - 0.5 * h) * scale_y);
+            int width = static_cast<int>(w * scale_x);
+            int height = static_cast<int>(h * scale_y);
+
+            if (drop_cut_boxes && (left <= cut_left || top <= cut_top || left + width >= cut_right ||
+                                   top + height >= cut_bottom)) {
+                continue;
+            }
+            candidates.boxes.emplace_back(left, top, width, height);
+            candidates.confidences.push_back(max_score);
+            candidates.class_ids.push_back(class_id);
+        }
+    }
+}
+
+std::vector<Detection> yolo_nms(const YoloCandidates& candidates) {
+    std::vector<int> nms_indices;
+    cv::dnn::NMSBoxes(candidates.boxes, candidates.confidences, 0.4f, 0.5f, nms_indices);
+
+    std::vector<Detection> final_detections;
+    for (int index : nms_indices) {
+        final_detections.push_back({candidates.boxes[index], candidates.confidences[index], candidates.class_ids[index]});
+    }
+
+    return final_detections;
+}
+
+TilingMode parse_tiling_mode(const std::string& name) {
+    if (name == "off") {
+        return TilingMode::Off;
+    }
+    if (name == "full") {
+        return TilingMode::Full;
+    }
+    if (name == "ball") {
+        return TilingMode::Ball;
+    }
+    throw std::invalid_argument("Unknown tiling mode '" + name + "' (expected off, full or ball)");
+}
+
+void validate_tiling_options(const TilingOptions& options) {
+    if (options.tile_size < 32 || options.roi_size < 32) {
+        throw std::invalid_argument("Tile size and ball crop size must be at least 32 pixels");
+    }
+    if (!(options.overlap >= 0.0f && options.overlap < 1.0f)) {
+        throw std::invalid_argument("Tile overlap must be in [0, 1)");
+    }
+}
+
+int default_batch_size(TilingMode mode) {
+    switch (mode) {
+    case TilingMode::Full:
+        return 9;
+    case TilingMode::Ball:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+namespace {
+
+// Start offsets of `tile`-sized spans covering [begin, begin + length), evenly spread
+void tile_offsets(int begin, int length, int tile, float overlap, std::vector<int>& offsets) {
+    offsets.clear();
+    if (length <= tile) {
+        offsets.push_back(begin);
+        return;
+    }
+    float stride = tile * (1.0f - overlap);
+    int count = static_cast<int>(std::ceil((length - tile) / stride)) + 1;
+    for (int i = 0; i < count; ++i) {
+        offsets.push_back(begin + static_cast<int>(std::lround(static_cast<double>(i) * (length - tile) / (count - 1))));
+    }
+}
+
+} // namespace
+
+std::vector<cv::Rect> yolo_tiles(const cv::Size& image_size, const cv::Rect& region, int tile_size, float overlap) {
+    const cv::Rect image_rect(cv::Point(), image_size);
+    const int tile_w = std::min(tile_size, image_size.width);
+    const int tile_h = std::min(tile_size, image_size.height);
+    overlap = std::min(std::max(overlap, 0.0f), 0.9f);
+
+    // Grow the region to at least one tile around its centre, then shift it back inside the image
+    cv::Rect area = region & image_rect;
+    if (area.empty()) {
+        area = image_rect;
+    }
+    if (area.width < tile_w) {
+        area.x = std::min(std::max(area.x + area.width / 2 - tile_w / 2, 0), image_size.width - tile_w);
+        area.width = tile_w;
+    }
+    if (area.height < tile_h) {
+        area.y = std::min(std::max(area.y + area.height / 2 - tile_h / 2, 0), image_size.height - tile_h);
+        area.height = tile_h;
+    }
+
+    std::vector<int> xs, ys;
+    tile_offsets(area.x, area.width, tile_w, overlap, xs);
+    tile_offsets(area.y, area.height, tile_h, overlap, ys);
+    std::vector<cv::Rect> tiles;
+    tiles.reserve(xs.size() * ys.size());
+    for (int y : ys) {
+        for (int x : xs) {
+            tiles.emplace_back(x, y, tile_w, tile_h);
+        }
+    }
+    return tiles;
+}
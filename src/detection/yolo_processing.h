@@ -0,0 +1,74 @@
+#ifndef YOLO_PROCESSING_H
+#define YOLO_PROCESSING_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "detection/detection.h"
+
+// CPU-side pre/post-processing for YOLOv8, independent of the inference backend so it can be
+// benchmarked and tested without TensorRT.
+
+// YOLOv8 output layout: [4 box + 80 class scores] x 8400 anchors, attribute-major
+const int kYoloNumAnchors = 8400;
+const int kYoloNumClasses = 80;
+const int kYoloOutputSize = kYoloNumAnchors * (kYoloNumClasses + 4);
+
+// Resizes to the network input, converts BGR->RGB, scales to [0,1] and lays out as planar CHW
+std::vector<float> yolo_preprocess(const cv::Mat& image, int input_width, int input_height);
+
+// Same, writing into `output` (input_width * input_height * 3 floats), e.g. one slot of a batch
+void yolo_preprocess_into(const cv::Mat& image, int input_width, int input_height, float* output);
+
+// Decodes raw output into detections in original image coordinates, with class-wise NMS
+std::vector<Detection> yolo_postprocess(const float* output, const cv::Size& original_image_size,
+                                        int input_width, int input_height);
+
+// Boxes above the score threshold, before NMS, gathered from one or more network outputs
+struct YoloCandidates {
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    std::vector<int> class_ids;
+};
+
+// Appends the boxes of the output for the crop `roi` of an image of `image_size`, in image
+// coordinates. With `drop_cut_boxes`, boxes touching a crop edge that lies inside the image are
+// skipped: they are cut objects, which the overlapping neighbour tile or the full frame sees whole.
+void yolo_decode(const float* output, const cv::Rect& roi, const cv::Size& image_size, int input_width,
+                 int input_height, bool drop_cut_boxes, YoloCandidates& candidates);
+
+// NMS over candidates merged from any number of crops
+std::vector<Detection> yolo_nms(const YoloCandidates& candidates);
+
+// Tiled inference: besides the downscaled full frame, the detector sees overlapping square crops
+// of `tile_size` source pixels, so a ball that is a few pixels wide in a 4K frame stays visible
+enum class TilingMode {
+    Off,
+    Full, // tiles cover the whole frame
+    Ball  // one crop on the predicted ball while tracking is confident, the whole frame otherwise
+};
+
+// "off", "full" or "ball"; throws std::invalid_argument otherwise
+TilingMode parse_tiling_mode(const std::string& name);
+
+// Crops per inference that fit a frame of `mode` in one batch with the default options: the full
+// frame plus the eight tiles of a 4K frame, the full frame plus the ball crop, or the full frame alone
+int default_batch_size(TilingMode mode);
+
+struct TilingOptions {
+    TilingMode mode = TilingMode::Off;
+    int tile_size = 1280;            // crop size in source pixels
+    float overlap = 0.2f;            // fraction of a tile shared with its neighbour
+    int roi_size = 640;              // ball mode crop in source pixels; 640 keeps native resolution
+    float min_roi_confidence = 0.3f; // ball mode searches all tiles below this tracking confidence
+};
+
+// Throws std::invalid_argument unless tile_size and roi_size are at least 32 and overlap is in
+// [0, 1); smaller tiles would split a frame into an unbounded number of crops
+void validate_tiling_options(const TilingOptions& options);
+
+// Crops of `tile_size` (clamped to the image) covering `region`, overlapping by at least
+// `overlap`. A region smaller than a tile yields one tile centred on it.
+std::vector<cv::Rect> yolo_tiles(const cv::Size& image_size, const cv::Rect& region, int tile_size, float overlap);
+
+#endif // YOLO_PROCESSING_H
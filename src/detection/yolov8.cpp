@@ -1,16 +1,18 @@
 #include "yolov8.h"
+#include "detection/yolo_processing.h"
 #include "NvOnnxParser.h"
 #include "NvInfer.h"
 #include "utils/logger.h" // Use the existing logger
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <opencv2/imgproc.hpp>
-#include <opencv2/dnn.hpp> // For NMS
 
 // Constructor
-YoloV8::YoloV8(const std::string& onnx_model_path) : onnx_model_path_(onnx_model_path) {
-    engine_file_path_ = onnx_model_path + ".engine";
+YoloV8::YoloV8(const std::string& onnx_model_path, int max_batch_size)
+    : onnx_model_path_(onnx_model_path), max_batch_size_(std::max(1, max_batch_size)) {
+    engine_file_path_ = onnx_model_path +
+                        (max_batch_size_ > 1 ? ".b" + std::to_string(max_batch_size_) + ".engine" : ".engine");
     std::ifstream engine_file(engine_file_path_, std::ios::binary);
 
     if (engine_file.good()) {
@@ -30,12 +32,25 @@ YoloV8::YoloV8(const std::string& onnx_model_path) : onnx_model_path_(onnx_model
         throw std::runtime_error("Failed to create TensorRT execution context.");
     }
     
+    // A fixed-shape engine always runs its own batch size; a dynamic one up to the profile maximum
+    const char* input_name = engine_->getIOTensorName(0);
+    nvinfer1::Dims input_dims = engine_->getTensorShape(input_name);
+    dynamic_shape_ = std::any_of(input_dims.d, input_dims.d + input_dims.nbDims, [](int64_t d) { return d < 0; });
+    if (dynamic_shape_) {
+        max_batch_size_ = static_cast<int>(
+            engine_->getProfileShape(input_name, 0, nvinfer1::OptProfileSelector::kMAX).d[0]);
+    } else {
+        max_batch_size_ = static_cast<int>(std::max<int64_t>(1, input_dims.d[0]));
+    }
+
     cudaStreamCreate(&stream_);
 
     // Allocate buffers
-    cudaMalloc(&buffers_[0], input_width_ * input_height_ * 3 * sizeof(float));
-    // The output tensor size is 8400 * (4+80) = 705600
-    cudaMalloc(&buffers_[1], 8400 * 84 * sizeof(float));
+    input_host_.resize(static_cast<size_t>(max_batch_size_) * input_width_ * input_height_ * 3);
+    output_host_.resize(static_cast<size_t>(max_batch_size_) * kYoloOutputSize);
+    cudaMalloc(&buffers_[0], input_host_.size() * sizeof(float));
+    // The output tensor size is 8400 * (4+80) = 705600 per image
+    cudaMalloc(&buffers_[1], output_host_.size() * sizeof(float));
 }
 
 // Destructor
@@ -75,6 +90,23 @@ void YoloV8::buildEngine() {
 
     config->setMemoryPoolLimit(nvinfer1::MemoryPoolType::kWORKSPACE, 1 << 30); // 1GB
 
+    // Models exported with dynamic axes need a profile; the batch ranges up to max_batch_size_
+    nvinfer1::ITensor* input = network->getInput(0);
+    nvinfer1::Dims input_dims = input->getDimensions();
+    if (std::any_of(input_dims.d, input_dims.d + input_dims.nbDims, [](int64_t d) { return d < 0; })) {
+        nvinfer1::IOptimizationProfile* profile = builder->createOptimizationProfile();
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMIN,
+                               nvinfer1::Dims4(1, 3, input_height_, input_width_));
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kOPT,
+                               nvinfer1::Dims4(max_batch_size_, 3, input_height_, input_width_));
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMAX,
+                               nvinfer1::Dims4(max_batch_size_, 3, input_height_, input_width_));
+        config->addOptimizationProfile(profile);
+    } else if (max_batch_size_ > 1) {
+        std::cerr << "Warning: " << onnx_model_path_ << " has a fixed batch size; tiles run "
+                  << input_dims.d[0] << " per inference" << std::endl;
+    }
+
     nvinfer1::IHostMemory* serialized_engine = builder->buildSerializedNetwork(*network, *config);
     if (!serialized_engine) {
         throw std::runtime_error("Failed to build serialized network.");
@@ -107,98 +139,67 @@ void YoloV8::loadEngine() {
 }
 
 std::vector<Detection> YoloV8::detect(const cv::Mat& image) {
-    std::vector<float> preprocessed_image = preprocess(image);
-
-    cudaMemcpyAsync(buffers_[0], preprocessed_image.data(), preprocessed_image.size() * sizeof(float), cudaMemcpyHostToDevice, stream_);
-
-    context_->setTensorAddress(engine_->getIOTensorName(0), buffers_[0]);
-    context_->setTensorAddress(engine_->getIOTensorName(1), buffers_[1]);
-
-    context_->enqueueV3(stream_);
-
-    int output_size = 8400 * 84;
-    std::vector<float> output_data(output_size);
-    cudaMemcpyAsync(output_data.data(), buffers_[1], output_data.size() * sizeof(float), cudaMemcpyDeviceToHost, stream_);
-
-    cudaStreamSynchronize(stream_);
-
-    return postprocess(output_data.data(), image.size());
+    return detect_rois(image, {cv::Rect(cv::Point(), image.size())});
 }
 
-std::vector<float> YoloV8::preprocess(const cv::Mat& image) {
-    cv::Mat resized_image, float_image, rgb_image;
-    
-    cv::resize(image, resized_image, cv::Size(input_width_, input_height_));
-    cv::cvtColor(resized_image, rgb_image, cv::COLOR_BGR2RGB);
-    rgb_image.convertTo(float_image, CV_32FC3, 1.0 / 255.0);
-
-    std::vector<cv::Mat> channels(3);
-    cv::split(float_image, channels);
-    
-    std::vector<float> result(input_width_ * input_height_ * 3);
-    memcpy(result.data(), channels[0].data, input_width_ * input_height_ * sizeof(float));
-    memcpy(result.data() + input_width_ * input_height_, channels[1].data, input_width_ * input_height_ * sizeof(float));
-    memcpy(result.data() + 2 * input_width_ * input_height_, channels[2].data, input_width_ * input_height_ * sizeof(float));
-
-    return result;
+std::vector<Detection> YoloV8::detect_tiled(const cv::Mat& image, const TilingOptions& tiling,
+                                            const cv::Rect& region) {
+    std::vector<cv::Rect> rois = region.empty() ? yolo_tiles(image.size(), region, tiling.tile_size, tiling.overlap)
+                                                : yolo_tiles(image.size(), region, tiling.roi_size, 0.0f);
+    // The downscaled full frame still finds the large objects, including those cut by every tile
+    rois.insert(rois.begin(), cv::Rect(cv::Point(), image.size()));
+    return detect_rois(image, rois);
 }
 
-std::vector<Detection> YoloV8::postprocess(const float* output, const cv::Size& original_image_size) {
-    const int num_detections = 8400;
-    const int num_classes = 80;
-    const int elements_per_detection = num_classes + 4;
+std::vector<Detection> YoloV8::detect_rois(const cv::Mat& image, const std::vector<cv::Rect>& rois) {
+    const size_t input_size = static_cast<size_t>(input_width_) * input_height_ * 3;
+    const cv::Rect full_frame(cv::Point(), image.size());
 
-    std::vector<cv::Rect> boxes;
-    std::vector<float> confidences;
-    std::vector<int> class_ids;
+    // Each stage runs over all crops at once, so the profiler gets one sample per stage per frame.
+    // The host buffers hold every batch, rounded up to whole batches for fixed-shape engines.
+    const size_t slots = (rois.size() + max_batch_size_ - 1) / max_batch_size_ * max_batch_size_;
+    if (input_host_.size() < slots * input_size) {
+        input_host_.resize(slots * input_size);
+        output_host_.resize(slots * kYoloOutputSize);
+    }
 
-    std::vector<float> transposed_output(num_detections * elements_per_detection);
-    for (int i = 0; i < num_detections; ++i) {
-        for (int j = 0; j < elements_per_detection; ++j) {
-            transposed_output[i * elements_per_detection + j] = output[j * num_detections + i];
+    {
+        PROFILE_STAGE(profiler_, Stage::Preprocess);
+        for (size_t i = 0; i < rois.size(); ++i) {
+            yolo_preprocess_into(image(rois[i]), input_width_, input_height_, input_host_.data() + i * input_size);
         }
     }
 
-    float scale_x = static_cast<float>(original_image_size.width) / input_width_;
-    float scale_y = static_cast<float>(original_image_size.height) / input_height_;
-
-    for (int i = 0; i < num_detections; ++i) {
-        const float* detection = transposed_output.data() + i * elements_per_detection;
-        const float* class_scores = detection + 4;
-        
-        int class_id = -1;
-        float max_score = 0.0f;
-        for (int j = 0; j < num_classes; ++j) {
-            if (class_scores[j] > max_score) {
-                max_score = class_scores[j];
-                class_id = j;
+    {
+        // Includes host<->device copies and waiting for the stream
+        PROFILE_STAGE(profiler_, Stage::Inference);
+        context_->setTensorAddress(engine_->getIOTensorName(0), buffers_[0]);
+        context_->setTensorAddress(engine_->getIOTensorName(1), buffers_[1]);
+        for (size_t first = 0; first < rois.size(); first += max_batch_size_) {
+            const int count = static_cast<int>(std::min<size_t>(max_batch_size_, rois.size() - first));
+            // Fixed-shape engines always process their full batch; the unused slots are ignored
+            const int batch = dynamic_shape_ ? count : max_batch_size_;
+            cudaMemcpyAsync(buffers_[0], input_host_.data() + first * input_size, batch * input_size * sizeof(float),
+                            cudaMemcpyHostToDevice, stream_);
+
+            if (dynamic_shape_) {
+                context_->setInputShape(engine_->getIOTensorName(0),
+                                        nvinfer1::Dims4(batch, 3, input_height_, input_width_));
             }
-        }
-
-        if (max_score > 0.25f) { 
-            float cx = detection[0];
-            float cy = detection[1];
-            float w = detection[2];
-            float h = detection[3];
-
-            int left = static_cast<int>((cx - 0.5 * w) * scale_x);
-            int top = static_cast<int>((cy - 0.5 * h) * scale_y);
-            int width = static_cast<int>(w * scale_x);
-            int height = static_cast<int>(h * scale_y);
+            context_->enqueueV3(stream_);
 
-            boxes.emplace_back(left, top, width, height);
-            confidences.push_back(max_score);
-            class_ids.push_back(class_id);
+            // The stream orders the next batch's upload after this download
+            cudaMemcpyAsync(output_host_.data() + first * kYoloOutputSize, buffers_[1],
+                            batch * kYoloOutputSize * sizeof(float), cudaMemcpyDeviceToHost, stream_);
         }
+        cudaStreamSynchronize(stream_);
     }
 
-    std::vector<int> nms_indices;
-    cv::dnn::NMSBoxes(boxes, confidences, 0.4f, 0.5f, nms_indices);
-
-    std::vector<Detection> final_detections;
-    for (int index : nms_indices) {
-        final_detections.push_back({boxes[index], confidences[index], class_ids[index]});
+    PROFILE_STAGE(profiler_, Stage::Postprocess);
+    YoloCandidates candidates;
+    for (size_t i = 0; i < rois.size(); ++i) {
+        yolo_decode(output_host_.data() + i * kYoloOutputSize, rois[i], image.size(), input_width_, input_height_,
+                    rois[i] != full_frame, candidates);
     }
-
-    return final_detections;
+    return yolo_nms(candidates);
 }
@@ -5,18 +5,16 @@
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include "NvInfer.h"
-
-// Struct to hold detection results
-struct Detection {
-    cv::Rect box;
-    float confidence;
-    int class_id;
-};
+#include "detection/detection.h"
+#include "detection/yolo_processing.h"
+#include "utils/profiler.h"
 
 class YoloV8 {
 public:
-    // Constructor: Takes the path to the ONNX model file
-    YoloV8(const std::string& onnx_model_path);
+    // Constructor: Takes the path to the ONNX model file. A max_batch_size above 1 lets tiled
+    // detection run several crops per inference if the model has a dynamic batch dimension; the
+    // engine is then cached as <model>.b<N>.engine.
+    YoloV8(const std::string& onnx_model_path, int max_batch_size = 1);
 
     // Destructor
     ~YoloV8();
@@ -24,6 +22,18 @@ public:
     // Main detection function
     std::vector<Detection> detect(const cv::Mat& image);
 
+    // The full frame plus either the overlapping tiles covering the whole frame (empty `region`)
+    // or one `tiling.roi_size` crop centred on `region`, batched through the engine and merged
+    // with NMS
+    std::vector<Detection> detect_tiled(const cv::Mat& image, const TilingOptions& tiling,
+                                        const cv::Rect& region = cv::Rect());
+
+    // Crops per inference; 1 unless the engine was built with a dynamic batch profile
+    int max_batch_size() const { return max_batch_size_; }
+
+    // Optional stage timings for preprocess / inference / postprocess (null disables)
+    void set_profiler(StageProfiler* profiler) { profiler_ = profiler; }
+
 private:
     // --- TensorRT Members ---
     nvinfer1::IRuntime* runtime_ = nullptr;
@@ -35,18 +45,23 @@ private:
     std::string engine_file_path_;
     const int input_width_ = 640;
     const int input_height_ = 640;
+    int max_batch_size_ = 1;
+    bool dynamic_shape_ = false; // input dimensions are set per inference
 
     // --- Buffers ---
-    void* buffers_[2]; // 0 for input, 1 for output
+    void* buffers_[2]; // 0 for input, 1 for output, each max_batch_size_ images
+    std::vector<float> input_host_;  // all crops of one detect call, in whole batches
+    std::vector<float> output_host_;
     cudaStream_t stream_ = nullptr;
 
+    StageProfiler* profiler_ = nullptr;
+
     // --- Initialization ---
     void buildEngine();
     void loadEngine();
 
-    // --- Inference Helpers ---
-    std::vector<float> preprocess(const cv::Mat& image);
-    std::vector<Detection> postprocess(const float* output, const cv::Size& original_image_size);
+    // Runs the crops `rois` of `image` through the engine, max_batch_size_ at a time
+    std::vector<Detection> detect_rois(const cv::Mat& image, const std::vector<cv::Rect>& rois);
 };
 
 #endif // YOLOV8_H
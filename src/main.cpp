@@ -1,12 +1,19 @@
+#include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <vector>
 #include "cxxopts.hpp"
 #include "utils/config.h"
 #include "detection/player_tracker.h"
 #include "detection/ball_tracker.h"
 #include "detection/yolov8.h" // Include the new YOLOv8 header
+#include "detection/detection_io.h"
 #include "analytics/metrics.h"
 #include "utils/calibration.h"
+#include "utils/checkpoint.h"
+#include "utils/profiler.h"
 #include <opencv2/videoio.hpp>
 #include <opencv2/highgui.hpp>
 
@@ -19,8 +26,27 @@ int main(int argc, char** argv) {
         ("m,model", "Path to the YOLOv8 ONNX model file", cxxopts::value<std::string>())
         ("o,output-dir", "Directory to save the output CSV files", cxxopts::value<std::string>()->default_value("."))
         ("conf", "Confidence threshold for detection", cxxopts::value<float>()->default_value("0.5"))
+        ("batch-size", "Maximum crops per TensorRT inference (needs a model exported with a dynamic batch); defaults to one batch per frame of the --tiling mode", cxxopts::value<int>())
+        ("tiling", "Also detect on overlapping high-resolution tiles: off, full (whole frame) or ball (around the predicted ball)", cxxopts::value<std::string>()->default_value("off"))
+        ("tile-size", "Tile size in source pixels", cxxopts::value<int>()->default_value("1280"))
+        ("tile-overlap", "Fraction of a tile shared with its neighbours", cxxopts::value<float>()->default_value("0.2"))
+        ("ball-roi-size", "Size in source pixels of the crop around the predicted ball in --tiling ball", cxxopts::value<int>()->default_value("640"))
+        ("ball-roi-confidence", "Ball tracking confidence below which --tiling ball searches all tiles", cxxopts::value<float>()->default_value("0.3"))
         ("no-ball", "Disable ball tracking", cxxopts::value<bool>()->default_value("false"))
         ("skip-frames", "Number of frames to skip between analyses (e.g., 3 for every 3rd frame)", cxxopts::value<int>()->default_value("1"))
+        ("keyframe-interval", "Run the detector every N frames and propagate tracks with optical flow in between", cxxopts::value<int>()->default_value("1"))
+        ("checkpoint-interval", "Frames between state checkpoints in the output directory (0 disables)", cxxopts::value<int>()->default_value("0"))
+        ("resume", "Resume from the checkpoint in the output directory, if any", cxxopts::value<bool>()->default_value("false"))
+        ("trace", "Write a Chrome trace (chrome://tracing, Perfetto) of per-frame pipeline stages to this file", cxxopts::value<std::string>()->default_value(""))
+        ("dump-detections", "Write the filtered per-frame detections to this binary file for later replay", cxxopts::value<std::string>()->default_value(""))
+        ("replay-detections", "Run tracking and analytics from a detection dump instead of the video and detector", cxxopts::value<std::string>()->default_value(""))
+        ("heatmap-cell-size", "Heatmap grid cell size in meters", cxxopts::value<float>()->default_value("1.0"))
+        ("ball-latency", "Look-ahead in seconds for ball outlier rejection and gap filling (0 uses the raw tracker output)", cxxopts::value<float>()->default_value("1.5"))
+        ("pitch-control-interval", "Compute pitch control every N frames (0 disables)", cxxopts::value<int>()->default_value("0"))
+        ("pitch-control-model", "Pitch control model: voronoi or time-to-intercept", cxxopts::value<std::string>()->default_value("time-to-intercept"))
+        ("pitch-control-cell-size", "Pitch control grid cell size in meters", cxxopts::value<float>()->default_value("1.0"))
+        ("pitch-control-grids", "Also write every pitch control surface as a PNG", cxxopts::value<bool>()->default_value("false"))
+        ("csv-precision", "Decimals of float CSV columns: N for all, or column=N,... (e.g. x=2,y=2)", cxxopts::value<std::string>()->default_value(""))
         ("h,help", "Print usage");
 
     auto result = options.parse(argc, argv);
@@ -32,24 +58,104 @@ int main(int argc, char** argv) {
 
     Config config;
     try {
-        config.video_path = result["video"].as<std::string>();
+        config.replay_detections_path = result["replay-detections"].as<std::string>();
+        config.dump_detections_path = result["dump-detections"].as<std::string>();
+        // Replay needs neither the video nor the model
+        bool replay = !config.replay_detections_path.empty();
+        config.video_path = replay && !result.count("video") ? "" : result["video"].as<std::string>();
         config.calibration_path = result["calib"].as<std::string>();
-        config.yolo_model_path = result["model"].as<std::string>();
+        config.yolo_model_path = replay && !result.count("model") ? "" : result["model"].as<std::string>();
         config.output_dir = result["output-dir"].as<std::string>();
         config.confidence_threshold = result["conf"].as<float>();
+        config.batch_size = result.count("batch-size") ? result["batch-size"].as<int>() : 0;
+        config.tiling = result["tiling"].as<std::string>();
+        config.tile_size = result["tile-size"].as<int>();
+        config.tile_overlap = result["tile-overlap"].as<float>();
+        config.ball_roi_size = result["ball-roi-size"].as<int>();
+        config.ball_roi_confidence = result["ball-roi-confidence"].as<float>();
         config.track_ball = !result["no-ball"].as<bool>();
         config.frame_skip_interval = result["skip-frames"].as<int>();
+        config.keyframe_interval = result["keyframe-interval"].as<int>();
+        config.checkpoint_interval = result["checkpoint-interval"].as<int>();
+        config.resume = result["resume"].as<bool>();
+        config.trace_path = result["trace"].as<std::string>();
+        config.csv_precision = result["csv-precision"].as<std::string>();
+        config.heatmap_cell_size = result["heatmap-cell-size"].as<float>();
+        config.ball_latency_seconds = result["ball-latency"].as<float>();
+        config.pitch_control_interval = result["pitch-control-interval"].as<int>();
+        config.pitch_control_model = result["pitch-control-model"].as<std::string>();
+        config.pitch_control_cell_size = result["pitch-control-cell-size"].as<float>();
+        config.pitch_control_grids = result["pitch-control-grids"].as<bool>();
     } catch (const std::exception& e) {
         std::cerr << "Error parsing arguments: " << e.what() << std::endl;
         std::cerr << options.help() << std::endl;
         return 1;
     }
 
+    if (config.keyframe_interval < 1) {
+        std::cerr << "Error: --keyframe-interval must be positive" << std::endl;
+        return 1;
+    }
+    if (config.keyframe_interval > 1 && (config.frame_skip_interval > 1 || !config.replay_detections_path.empty())) {
+        std::cerr << "Error: --keyframe-interval needs every video frame and cannot be combined with --skip-frames or --replay-detections" << std::endl;
+        return 1;
+    }
+
+    TilingOptions tiling;
+    tiling.tile_size = config.tile_size;
+    tiling.overlap = config.tile_overlap;
+    tiling.roi_size = config.ball_roi_size;
+    tiling.min_roi_confidence = config.ball_roi_confidence;
+    try {
+        tiling.mode = parse_tiling_mode(config.tiling);
+        validate_tiling_options(tiling);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (!result.count("batch-size")) {
+        config.batch_size = default_batch_size(tiling.mode);
+    }
+    if (config.batch_size < 1) {
+        std::cerr << "Error: --batch-size must be positive" << std::endl;
+        return 1;
+    }
+
     // Load calibration
     Calibration calibration(config.calibration_path);
 
-    // Initialize YOLOv8 detector
-    YoloV8 yolo_detector(config.yolo_model_path);
+    // Per-stage latency histograms, reported at exit
+    StageProfiler profiler;
+    std::unique_ptr<TraceRecorder> tracer;
+    if (!config.trace_path.empty()) {
+        tracer = std::make_unique<TraceRecorder>();
+        profiler.set_tracer(tracer.get());
+    }
+
+    // Detections come either from the YOLOv8 detector on decoded frames or from a previous dump
+    std::unique_ptr<YoloV8> yolo_detector;
+    std::unique_ptr<DetectionReader> replay_reader;
+    cv::VideoCapture cap;
+    double video_fps = 0;
+    try {
+        if (!config.replay_detections_path.empty()) {
+            replay_reader = std::make_unique<DetectionReader>(config.replay_detections_path);
+            video_fps = replay_reader->fps();
+        } else {
+            yolo_detector = std::make_unique<YoloV8>(config.yolo_model_path, config.batch_size);
+            yolo_detector->set_profiler(&profiler);
+
+            cap.open(config.video_path);
+            if (!cap.isOpened()) {
+                std::cerr << "Error: Could not open video file " << config.video_path << std::endl;
+                return 1;
+            }
+            video_fps = cap.get(cv::CAP_PROP_FPS);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 
     // Initialize trackers
     PlayerTracker player_tracker;
@@ -57,69 +163,228 @@ int main(int argc, char** argv) {
 
     // Initialize metrics calculator
     MetricsCalculator metrics_calculator(config.output_dir);
-
-    // Open video
-    cv::VideoCapture cap(config.video_path);
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Could not open video file " << config.video_path << std::endl;
+    if (config.heatmap_cell_size <= 0.0f) {
+        std::cerr << "Error: --heatmap-cell-size must be positive" << std::endl;
+        return 1;
+    }
+    metrics_calculator.set_heatmap_cell_size(config.heatmap_cell_size);
+    if (config.pitch_control_interval < 0 || config.pitch_control_cell_size <= 0.0f) {
+        std::cerr << "Error: --pitch-control-interval must not be negative and --pitch-control-cell-size must be positive" << std::endl;
         return 1;
     }
+    try {
+        metrics_calculator.set_pitch_control(config.pitch_control_interval,
+                                             parse_pitch_control_model(config.pitch_control_model),
+                                             config.pitch_control_cell_size, config.pitch_control_grids);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (!config.csv_precision.empty()) {
+        try {
+            std::stringstream spec(config.csv_precision);
+            std::string item;
+            while (std::getline(spec, item, ',')) {
+                size_t eq = item.find('=');
+                if (eq == std::string::npos) {
+                    metrics_calculator.set_csv_precision(std::stoi(item));
+                } else {
+                    metrics_calculator.set_csv_precision(item.substr(0, eq), std::stoi(item.substr(eq + 1)));
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Invalid --csv-precision '" << config.csv_precision << "'" << std::endl;
+            return 1;
+        }
+    }
 
-    double video_fps = cap.get(cv::CAP_PROP_FPS);
     if (video_fps == 0) {
         std::cerr << "Warning: Could not retrieve video FPS. Assuming 30 FPS." << std::endl;
         video_fps = 30.0; // Default to 30 FPS if not available
     }
 
+    // With ball refinement the metrics take raw detections instead of the tracker's predictions
+    if (config.ball_latency_seconds < 0.0f) {
+        std::cerr << "Error: --ball-latency must not be negative" << std::endl;
+        return 1;
+    }
+    const int ball_latency_frames = static_cast<int>(std::lround(config.ball_latency_seconds * video_fps));
+    const bool refine_ball = ball_latency_frames > 0;
+    metrics_calculator.set_ball_latency(ball_latency_frames);
+
     cv::Mat frame;
     int current_frame_idx = 0; // Actual frame index from video
-    while (cap.read(frame)) {
-        current_frame_idx++;
 
-        // Skip frames if interval is greater than 1
-        if (config.frame_skip_interval > 1 && (current_frame_idx - 1) % config.frame_skip_interval != 0) {
-            continue; // Skip this frame
+    std::string checkpoint_path = config.output_dir + "/checkpoint.bin";
+    std::string job_fingerprint = (replay_reader ? config.replay_detections_path : config.video_path) + "|" + config.yolo_model_path + "|" +
+                                  config.calibration_path + "|" + std::to_string(config.confidence_threshold) + "|" +
+                                  std::to_string(config.frame_skip_interval) + "," + std::to_string(config.keyframe_interval) + "|" +
+                                  std::to_string(config.pitch_control_interval) + "," + config.pitch_control_model +
+                                  "," + std::to_string(config.pitch_control_cell_size) + "|" +
+                                  std::to_string(config.ball_latency_seconds) + "|" + config.tiling + "," +
+                                  std::to_string(config.tile_size) + "," + std::to_string(config.tile_overlap) + "," +
+                                  std::to_string(config.ball_roi_size) + "," + std::to_string(config.ball_roi_confidence);
+    if (config.resume) {
+        current_frame_idx = load_checkpoint(checkpoint_path, job_fingerprint, player_tracker, ball_tracker, metrics_calculator);
+        if (current_frame_idx > 0) {
+            if (!replay_reader && !seek_to_frame(cap, current_frame_idx)) {
+                std::cerr << "Error: Could not seek video to checkpoint frame " << current_frame_idx << std::endl;
+                return 1;
+            }
+            std::cout << "Resuming from checkpoint at frame " << current_frame_idx << std::endl;
+        }
+    }
+    int last_checkpoint_idx = current_frame_idx;
+
+    std::unique_ptr<DetectionWriter> dump_writer;
+    if (!config.dump_detections_path.empty()) {
+        try {
+            dump_writer = std::make_unique<DetectionWriter>(config.dump_detections_path, video_fps);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
         }
+    }
+    DetectionFrame detection_frame;
+    // Keyframe mode: grayscale of the current and previous frame for optical flow
+    cv::Mat gray, prev_gray;
+    bool keyframe = true;
+
+    while (true) {
+        profiler.set_current_frame(current_frame_idx + 1);
+        if (replay_reader) {
+            // Replayed frames take the place of decode; frame skipping was applied when dumping
+            bool has_frame;
+            {
+                PROFILE_STAGE(&profiler, Stage::Decode);
+                has_frame = replay_reader->read(detection_frame);
+            }
+            if (!has_frame) {
+                break;
+            }
+            if (detection_frame.frame_index <= current_frame_idx) {
+                continue; // Already covered by the restored checkpoint
+            }
+            current_frame_idx = detection_frame.frame_index;
+            profiler.set_current_frame(current_frame_idx);
+        } else {
+            {
+                PROFILE_STAGE(&profiler, Stage::Decode);
+                if (!cap.read(frame)) {
+                    break;
+                }
+            }
+            current_frame_idx++;
+
+            // Skip frames if interval is greater than 1
+            if (config.frame_skip_interval > 1 && (current_frame_idx - 1) % config.frame_skip_interval != 0) {
+                continue; // Skip this frame
+            }
+
+            // Between keyframes the trackers follow the image instead of running the detector
+            if (config.keyframe_interval > 1) {
+                std::swap(prev_gray, gray);
+                keyframe = prev_gray.empty() || (current_frame_idx - 1) % config.keyframe_interval == 0;
+            }
+
+            if (keyframe) {
+                // Perform detection for all objects
+                std::vector<Detection> all_detections;
+                if (tiling.mode == TilingMode::Off) {
+                    all_detections = yolo_detector->detect(frame);
+                } else {
+                    // Ball mode crops around the tracker's prediction, and tiles the whole frame when unsure
+                    cv::Rect region;
+                    if (tiling.mode == TilingMode::Ball && config.track_ball) {
+                        region = ball_tracker.search_region(tiling.min_roi_confidence);
+                    }
+                    all_detections = yolo_detector->detect_tiled(frame, tiling, region);
+                }
 
-        // Perform detection for all objects
-        auto all_detections = yolo_detector.detect(frame);
-
-        // Filter detections for players and the ball
-        // COCO class IDs: 0 for person, 32 for sports ball
-        std::vector<Detection> player_detections;
-        std::vector<Detection> ball_detections;
-        for (const auto& det : all_detections) {
-            if (det.class_id == 0 && det.confidence >= config.confidence_threshold) {
-                player_detections.push_back(det);
-            } else if (det.class_id == 32 && det.confidence >= config.confidence_threshold) {
-                ball_detections.push_back(det);
+                // Filter detections for players and the ball
+                // COCO class IDs: 0 for person, 32 for sports ball
+                detection_frame.frame_index = current_frame_idx;
+                detection_frame.players.clear();
+                detection_frame.balls.clear();
+                for (const auto& det : all_detections) {
+                    if (det.class_id == 0 && det.confidence >= config.confidence_threshold) {
+                        detection_frame.players.push_back(det);
+                    } else if (det.class_id == 32 && det.confidence >= config.confidence_threshold) {
+                        detection_frame.balls.push_back(det);
+                    }
+                }
+
+                {
+                    PROFILE_STAGE(&profiler, Stage::PlayerTracking);
+                    detection_frame.player_colors = player_tracker.extract_colors(detection_frame.players, frame);
+                }
+                if (dump_writer) {
+                    dump_writer->write(detection_frame);
+                }
             }
         }
 
-        // Update trackers with the new detections
-        player_tracker.update(player_detections, frame); // Pass frame for color extraction
+        // Update trackers with the new detections, or propagate them to this frame
+        if (keyframe) {
+            {
+                PROFILE_STAGE(&profiler, Stage::PlayerTracking);
+                if (config.keyframe_interval > 1) {
+                    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY); // flow source for the next frame
+                }
+                player_tracker.update(detection_frame.players, detection_frame.player_colors);
+            }
+
+            if (config.track_ball) {
+                PROFILE_STAGE(&profiler, Stage::BallTracking);
+                ball_tracker.update(detection_frame.balls);
+            }
+        } else {
+            {
+                PROFILE_STAGE(&profiler, Stage::PlayerTracking);
+                cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+                player_tracker.propagate(prev_gray, gray);
+            }
 
-        if (config.track_ball) {
-            ball_tracker.update(ball_detections);
+            if (config.track_ball) {
+                PROFILE_STAGE(&profiler, Stage::BallTracking);
+                ball_tracker.propagate();
+            }
         }
 
         // Convert to real-world coordinates
-        auto real_world_players = calibration.transform(player_tracker.get_tracks());
-        auto real_world_ball = calibration.transform(ball_tracker.get_track());
+        std::vector<std::pair<int, cv::Point2f>> real_world_players;
+        std::pair<int, cv::Point2f> real_world_ball;
+        {
+            PROFILE_STAGE(&profiler, Stage::Calibration);
+            real_world_players = calibration.transform(player_tracker.get_tracks());
+            real_world_ball = calibration.transform(refine_ball ? ball_tracker.get_detection() : ball_tracker.get_track());
+        }
 
-        // Calculate metrics
-        // Team assignments are done after the loop, so pass an empty map for now
-        // This is a simplified approach. A more robust solution would involve
-        // storing all raw data and processing it once at the end.
-        metrics_calculator.process_frame(current_frame_idx, video_fps, real_world_players, real_world_ball, player_tracker.get_team_assignments());
-    }
+        // Calculate metrics; team assignments are empty until the tracker's team warm-up is over
+        {
+            PROFILE_STAGE(&profiler, Stage::Metrics);
+            metrics_calculator.process_frame(current_frame_idx, video_fps, real_world_players, real_world_ball, player_tracker.get_team_assignments());
+        }
+        profiler.record_frame();
 
-    // Assign teams after all frames are processed (this is called again for final assignments)
-    // The team assignments are already passed to process_frame, but this ensures final consistency
-    player_tracker.assign_teams(); 
+        // Compare against the last checkpoint rather than using a modulo, which frame skipping could step over
+        if (config.checkpoint_interval > 0 && current_frame_idx - last_checkpoint_idx >= config.checkpoint_interval) {
+            save_checkpoint(checkpoint_path, job_fingerprint, current_frame_idx, player_tracker, ball_tracker, metrics_calculator);
+            last_checkpoint_idx = current_frame_idx;
+        }
+    }
 
     // Save metrics to CSV
+    metrics_calculator.finish();
     metrics_calculator.save_to_csv();
+    metrics_calculator.save_to_columnar();
+    metrics_calculator.save_heatmaps();
+    remove_checkpoint(checkpoint_path);
+
+    std::cout << profiler.format_report();
+    if (tracer && tracer->write_chrome_trace(config.trace_path)) {
+        std::cout << "Pipeline trace written to " << config.trace_path << std::endl;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <fcntl.h>
 #include <filesystem>
 #include <iostream>
@@ -17,10 +20,16 @@
 #include "detection/player_tracker.h"
 #include "detection/yolov8.h"
 #include "utils/calibration.h"
+#include "utils/checkpoint.h"
+#include "utils/profiler.h"
+#include "utils/result_cache.h"
+#include "utils/service_stats.h"
+#include "utils/stats_server.h"
 #include <opencv2/videoio.hpp>
 
 using analysis::AnalysisEngine;
 using analysis::AnalysisResult;
+using analysis::StageLatency;
 using analysis::VideoRequest;
 using analysis::VideoResponse;
 using grpc::Server;
@@ -31,7 +40,133 @@ using grpc::Status;
 
 namespace fs = std::filesystem;
 
+// Replaces `out` with the per-stage latency distributions recorded so far
+void FillStageLatencies(
+    const StageProfiler &profiler,
+    google::protobuf::RepeatedPtrField<StageLatency> *out) {
+  out->Clear();
+  for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+    const LatencyHistogram &histogram =
+        profiler.histogram(static_cast<Stage>(i));
+    if (histogram.count() == 0) {
+      continue;
+    }
+    StageLatency *latency = out->Add();
+    latency->set_stage(stage_name(static_cast<Stage>(i)));
+    latency->set_count(histogram.count());
+    latency->set_mean_ms(histogram.mean() / 1e6);
+    latency->set_p50_ms(histogram.percentile(0.50) / 1e6);
+    latency->set_p90_ms(histogram.percentile(0.90) / 1e6);
+    latency->set_p99_ms(histogram.percentile(0.99) / 1e6);
+    latency->set_max_ms(histogram.max() / 1e6);
+    latency->set_total_ms(histogram.sum() / 1e6);
+  }
+}
+
+// Replaces `out` with the per-player match totals
+void FillPlayerSummaries(
+    const std::vector<PlayerSummary> &summaries,
+    google::protobuf::RepeatedPtrField<analysis::PlayerSummary> *out) {
+  out->Clear();
+  for (const PlayerSummary &summary : summaries) {
+    analysis::PlayerSummary *entry = out->Add();
+    entry->set_player_id(summary.player_id);
+    entry->set_team_id(summary.team);
+    entry->set_frames(summary.frames);
+    entry->set_minutes_played(summary.minutes_played);
+    entry->set_distance_meters(summary.distance_meters);
+    entry->set_top_speed_mps(summary.top_speed_mps);
+    entry->set_sprint_count(summary.sprint_count);
+    entry->set_high_intensity_run_count(summary.high_intensity_run_count);
+    entry->set_acceleration_count(summary.acceleration_count);
+    entry->set_deceleration_count(summary.deceleration_count);
+    entry->set_walking_distance_meters(summary.walking_distance_meters);
+    entry->set_jogging_distance_meters(summary.jogging_distance_meters);
+    entry->set_running_distance_meters(summary.running_distance_meters);
+    entry->set_high_speed_distance_meters(summary.high_speed_distance_meters);
+    entry->set_sprint_distance_meters(summary.sprint_distance_meters);
+  }
+}
+
+// Replaces `out` with the per-team possession totals
+void FillTeamPossession(
+    const std::vector<TeamPossession> &teams,
+    google::protobuf::RepeatedPtrField<analysis::TeamPossession> *out) {
+  out->Clear();
+  for (const TeamPossession &team : teams) {
+    analysis::TeamPossession *entry = out->Add();
+    entry->set_team_id(team.team);
+    entry->set_possession_seconds(team.possession_seconds);
+    entry->set_possession_percent(team.possession_percent);
+    entry->set_spells(team.spells);
+    entry->set_turnovers_won(team.turnovers_won);
+  }
+}
+
+// Appends passes [first, end) of `passes` to `out`
+void AddPassEvents(const std::vector<PassEvent> &passes, size_t first,
+                   google::protobuf::RepeatedPtrField<analysis::PassEvent> *out) {
+  for (size_t i = first; i < passes.size(); ++i) {
+    const PassEvent &pass = passes[i];
+    analysis::PassEvent *entry = out->Add();
+    entry->set_passer_id(pass.passer_id);
+    entry->set_passer_team_id(pass.passer_team);
+    entry->set_receiver_id(pass.receiver_id);
+    entry->set_receiver_team_id(pass.receiver_team);
+    entry->set_release_frame(pass.release_frame);
+    entry->set_reception_frame(pass.reception_frame);
+    entry->set_distance_meters(pass.distance_meters);
+    entry->set_completed(pass.completed);
+  }
+}
+
 class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
+public:
+  // `result_cache` may be null to disable caching; a `checkpoint_interval` of
+  // 0 disables checkpointing of AnalyzeVideo jobs
+  // A non-empty `trace_dir` enables a Chrome trace per job
+  AnalysisEngineServiceImpl(ResultCache *result_cache, int checkpoint_interval,
+                            ServiceStats *stats, const std::string &trace_dir)
+      : result_cache_(result_cache), checkpoint_interval_(checkpoint_interval),
+        stats_(stats), trace_dir_(trace_dir) {}
+
+private:
+  ResultCache *result_cache_;
+  int checkpoint_interval_;
+  ServiceStats *stats_;
+  std::string trace_dir_;
+
+  // Attaches a trace recorder to `profiler` when tracing is enabled
+  std::unique_ptr<TraceRecorder> StartTrace(StageProfiler &profiler) {
+    if (trace_dir_.empty()) {
+      return nullptr;
+    }
+    auto tracer = std::make_unique<TraceRecorder>();
+    profiler.set_tracer(tracer.get());
+    return tracer;
+  }
+
+  void WriteTrace(const TraceRecorder *tracer, const std::string &job_name) {
+    if (!tracer) {
+      return;
+    }
+    std::string path = trace_dir_ + "/trace_" + job_name + ".json";
+    if (tracer->write_chrome_trace(path)) {
+      std::cout << "Pipeline trace written to " << path << std::endl;
+    }
+  }
+
+  // Constructs the detector, recording how long the engine took to load
+  std::unique_ptr<YoloV8> LoadDetector(const std::string &model_path,
+                                       int max_batch_size = 1) {
+    auto start = std::chrono::steady_clock::now();
+    auto detector = std::make_unique<YoloV8>(model_path, max_batch_size);
+    stats_->record_model_load(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count());
+    return detector;
+  }
+
   Status AnalyzeVideo(ServerContext *context, const VideoRequest *request,
                       ServerWriter<VideoResponse> *writer) override {
 
@@ -47,24 +182,145 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
     response.set_message("Initializing analysis engine...");
     writer->Write(response);
 
-    try {
-      // Initialize components
-      Calibration calibration(request->calibration_path());
+    StageProfiler profiler;
+    std::unique_ptr<TraceRecorder> tracer = StartTrace(profiler);
+    ActiveJobScope job_scope(stats_, false, &profiler);
 
+    try {
       // Use model path from request
       std::string model_path = request->model_path();
       if (model_path.empty()) {
         model_path = "yolov8m.onnx"; // Fallback
       }
-      YoloV8 yolo_detector(model_path);
 
-      PlayerTracker player_tracker;
-      BallTracker ball_tracker;
+      // Pitch control is off unless requested; its options also key the
+      // cache and checkpoints
+      PitchControlModel pitch_control_model = PitchControlModel::TimeToIntercept;
+      if (!request->pitch_control_model().empty()) {
+        try {
+          pitch_control_model =
+              parse_pitch_control_model(request->pitch_control_model());
+        } catch (const std::invalid_argument &e) {
+          response.set_status("FAILED");
+          response.set_message(e.what());
+          writer->Write(response);
+          return Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+        }
+      }
+      TilingOptions tiling;
+      if (request->tile_size() != 0) {
+        tiling.tile_size = request->tile_size();
+      }
+      try {
+        if (!request->tiling().empty()) {
+          tiling.mode = parse_tiling_mode(request->tiling());
+        }
+        validate_tiling_options(tiling);
+      } catch (const std::invalid_argument &e) {
+        response.set_status("FAILED");
+        response.set_message(e.what());
+        writer->Write(response);
+        return Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+      }
+      const bool pitch_control = request->pitch_control_interval() > 0;
+      std::string job_options;
+      if (pitch_control) {
+        job_options =
+            "pitch_control=" +
+            std::to_string(request->pitch_control_interval()) + "," +
+            (pitch_control_model == PitchControlModel::Voronoi
+                 ? "voronoi"
+                 : "time-to-intercept") +
+            (request->pitch_control_grids() ? ",grids" : "");
+      }
+      if (tiling.mode != TilingMode::Off) {
+        job_options += ";tiling=" + request->tiling() + "," +
+                       std::to_string(tiling.tile_size);
+      }
+      const int keyframe_interval = std::max(1, request->keyframe_interval());
+      if (keyframe_interval > 1) {
+        job_options += ";keyframes=" + std::to_string(keyframe_interval);
+      }
 
-      // Create a temporary output directory
+      // Outputs go to a per-match directory, whether computed or served from
+      // the cache
       std::string output_dir = "/tmp/analysis_" + request->match_id();
       fs::create_directories(output_dir);
+
+      // Serve repeated submissions of identical inputs from the result cache
+      std::string cache_key;
+      if (result_cache_) {
+        cache_key = result_cache_->make_key(
+            request->video_path(), model_path, request->calibration_path(),
+            request->confidence_threshold(), job_options);
+        CachedResult cached;
+        bool cache_hit = result_cache_->lookup(cache_key, output_dir, cached);
+        stats_->record_cache_lookup(cache_hit);
+        if (cache_hit) {
+          std::cout << "Result cache hit for match " << request->match_id()
+                    << " (key " << cache_key << ")" << std::endl;
+          response.set_status("COMPLETED");
+          response.set_progress(1.0);
+          response.set_message("Analysis served from result cache");
+
+          AnalysisResult *result = response.mutable_result();
+          result->set_match_id(request->match_id());
+          result->set_total_frames(cached.total_frames);
+          result->set_players_tracked(cached.players_tracked);
+          result->set_report_id("report_" + request->match_id());
+          result->set_player_metrics_csv_path(cached.player_metrics_csv_path);
+          result->set_ball_metrics_csv_path(cached.ball_metrics_csv_path);
+          result->set_player_metrics_columnar_path(
+              cached.player_metrics_columnar_path);
+          result->set_ball_metrics_columnar_path(
+              cached.ball_metrics_columnar_path);
+          result->set_player_summary_csv_path(cached.player_summary_csv_path);
+          result->set_player_events_csv_path(cached.player_events_csv_path);
+          result->set_heatmaps_path(cached.heatmaps_path);
+          result->set_heatmap_image_dir(cached.heatmap_image_dir);
+          result->set_possession_spells_csv_path(
+              cached.possession_spells_csv_path);
+          result->set_team_possession_csv_path(cached.team_possession_csv_path);
+          result->set_passes_csv_path(cached.passes_csv_path);
+          result->set_team_shape_csv_path(cached.team_shape_csv_path);
+          result->set_team_shape_columnar_path(cached.team_shape_columnar_path);
+          result->set_offsides_csv_path(cached.offsides_csv_path);
+          if (pitch_control) {
+            result->set_pitch_control_csv_path(cached.pitch_control_csv_path);
+            if (request->pitch_control_grids()) {
+              result->set_pitch_control_grid_dir(cached.pitch_control_grid_dir);
+            }
+          }
+          if (!cached.team_possession_csv_path.empty()) {
+            FillTeamPossession(PossessionTracker::load_team_possession(
+                                   cached.team_possession_csv_path),
+                               result->mutable_team_possession());
+          }
+          FillPlayerSummaries(MetricsCalculator::load_player_summaries(
+                                  cached.player_summary_csv_path),
+                              result->mutable_player_summaries());
+          writer->Write(response);
+          job_scope.mark_succeeded();
+          return Status::OK;
+        }
+      }
+
+      // Initialize components
+      Calibration calibration(request->calibration_path());
+      std::unique_ptr<YoloV8> detector =
+          LoadDetector(model_path, default_batch_size(tiling.mode));
+      YoloV8 &yolo_detector = *detector;
+      yolo_detector.set_profiler(&profiler);
+
+      PlayerTracker player_tracker;
+      BallTracker ball_tracker;
+
       MetricsCalculator metrics_calculator(output_dir);
+      if (pitch_control) {
+        metrics_calculator.set_pitch_control(request->pitch_control_interval(),
+                                             pitch_control_model, 1.0f,
+                                             request->pitch_control_grids());
+      }
 
       // Open video
       cv::VideoCapture cap(request->video_path());
@@ -79,43 +335,138 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
       double video_fps = cap.get(cv::CAP_PROP_FPS);
       if (video_fps == 0)
         video_fps = 30.0;
+      // Batch jobs refine the ball trajectory with the full look-ahead
+      metrics_calculator.set_ball_latency(static_cast<int>(
+          std::lround(BallTrajectoryFilter::kMaxGapSeconds * video_fps)));
 
       int total_frames = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
       cv::Mat frame;
       int current_frame_idx = 0;
 
+      // Resume from a checkpoint left by an interrupted run of the same job
+      std::string checkpoint_path = output_dir + "/checkpoint.bin";
+      std::string job_fingerprint =
+          request->video_path() + "|" + model_path + "|" +
+          request->calibration_path() + "|" +
+          std::to_string(request->confidence_threshold()) + "|" + job_options;
+      if (checkpoint_interval_ > 0) {
+        current_frame_idx =
+            load_checkpoint(checkpoint_path, job_fingerprint, player_tracker,
+                            ball_tracker, metrics_calculator);
+        if (current_frame_idx > 0) {
+          if (!seek_to_frame(cap, current_frame_idx)) {
+            remove_checkpoint(checkpoint_path);
+            response.set_status("FAILED");
+            response.set_message("Could not seek video to checkpoint frame " +
+                                 std::to_string(current_frame_idx));
+            writer->Write(response);
+            return Status(grpc::StatusCode::INTERNAL,
+                          "Failed to resume from checkpoint");
+          }
+          std::cout << "Resuming match " << request->match_id()
+                    << " from checkpoint at frame " << current_frame_idx
+                    << std::endl;
+          response.set_status("PROCESSING");
+          response.set_progress(total_frames > 0 ? static_cast<float>(
+                                                       current_frame_idx) /
+                                                       total_frames
+                                                 : 0.0f);
+          response.set_message("Resumed from checkpoint at frame " +
+                               std::to_string(current_frame_idx));
+          writer->Write(response);
+        }
+      }
+
       // 2. Processing loop
-      while (cap.read(frame)) {
+      cv::Mat gray, prev_gray; // keyframe mode: frames for optical flow
+      while (true) {
+        profiler.set_current_frame(current_frame_idx + 1);
+        {
+          PROFILE_STAGE(&profiler, Stage::Decode);
+          if (!cap.read(frame)) {
+            break;
+          }
+        }
         current_frame_idx++;
 
-        // Perform detection
-        auto all_detections = yolo_detector.detect(frame);
+        // Between keyframes the trackers follow the image instead of running
+        // the detector
+        bool keyframe = true;
+        if (keyframe_interval > 1) {
+          std::swap(prev_gray, gray);
+          keyframe = prev_gray.empty() ||
+                     (current_frame_idx - 1) % keyframe_interval == 0;
+        }
 
-        std::vector<Detection> player_detections;
-        std::vector<Detection> ball_detections;
-        for (const auto &det : all_detections) {
-          if (det.class_id == 0 &&
-              det.confidence >= request->confidence_threshold()) {
-            player_detections.push_back(det);
-          } else if (det.class_id == 32 &&
-                     det.confidence >= request->confidence_threshold()) {
-            ball_detections.push_back(det);
+        if (keyframe) {
+          // Perform detection; ball tiling crops around the tracker's prediction
+          std::vector<Detection> all_detections;
+          if (tiling.mode == TilingMode::Off) {
+            all_detections = yolo_detector.detect(frame);
+          } else {
+            cv::Rect region;
+            if (tiling.mode == TilingMode::Ball) {
+              region = ball_tracker.search_region(tiling.min_roi_confidence);
+            }
+            all_detections = yolo_detector.detect_tiled(frame, tiling, region);
+          }
+
+          std::vector<Detection> player_detections;
+          std::vector<Detection> ball_detections;
+          for (const auto &det : all_detections) {
+            if (det.class_id == 0 &&
+                det.confidence >= request->confidence_threshold()) {
+              player_detections.push_back(det);
+            } else if (det.class_id == 32 &&
+                       det.confidence >= request->confidence_threshold()) {
+              ball_detections.push_back(det);
+            }
           }
-        }
 
-        // Update trackers
-        player_tracker.update(player_detections, frame);
-        ball_tracker.update(ball_detections);
+          // Update trackers
+          {
+            PROFILE_STAGE(&profiler, Stage::PlayerTracking);
+            if (keyframe_interval > 1) {
+              // Flow source for the next frame
+              cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+            }
+            player_tracker.update(player_detections, frame);
+          }
+          {
+            PROFILE_STAGE(&profiler, Stage::BallTracking);
+            ball_tracker.update(ball_detections);
+          }
+        } else {
+          {
+            PROFILE_STAGE(&profiler, Stage::PlayerTracking);
+            cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+            player_tracker.propagate(prev_gray, gray);
+          }
+          {
+            PROFILE_STAGE(&profiler, Stage::BallTracking);
+            ball_tracker.propagate();
+          }
+        }
 
         // Convert to real-world coordinates
-        auto real_world_players =
-            calibration.transform(player_tracker.get_tracks());
-        auto real_world_ball = calibration.transform(ball_tracker.get_track());
+        std::vector<std::pair<int, cv::Point2f>> real_world_players;
+        std::pair<int, cv::Point2f> real_world_ball;
+        {
+          PROFILE_STAGE(&profiler, Stage::Calibration);
+          real_world_players =
+              calibration.transform(player_tracker.get_tracks());
+          real_world_ball =
+              calibration.transform(ball_tracker.get_detection());
+        }
 
         // Calculate metrics
-        metrics_calculator.process_frame(current_frame_idx, video_fps,
-                                         real_world_players, real_world_ball,
-                                         player_tracker.get_team_assignments());
+        {
+          PROFILE_STAGE(&profiler, Stage::Metrics);
+          metrics_calculator.process_frame(
+              current_frame_idx, video_fps, real_world_players,
+              real_world_ball, player_tracker.get_team_assignments());
+        }
+        profiler.record_frame();
 
         // Send progress update every 30 frames
         if (current_frame_idx % 30 == 0) {
@@ -125,17 +476,27 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
           response.set_message("Processing frame " +
                                std::to_string(current_frame_idx) + "/" +
                                std::to_string(total_frames));
+          FillStageLatencies(profiler, response.mutable_stage_latencies());
           writer->Write(response);
         }
 
+        if (checkpoint_interval_ > 0 &&
+            current_frame_idx % checkpoint_interval_ == 0) {
+          save_checkpoint(checkpoint_path, job_fingerprint, current_frame_idx,
+                          player_tracker, ball_tracker, metrics_calculator);
+        }
+
         if (context->IsCancelled()) {
           return Status::CANCELLED;
         }
       }
 
       // 3. Finalize
-      player_tracker.assign_teams();
+      metrics_calculator.finish();
       metrics_calculator.save_to_csv();
+      metrics_calculator.save_to_columnar();
+      metrics_calculator.save_heatmaps();
+      remove_checkpoint(checkpoint_path);
 
       // 4. Final response: COMPLETED
       response.set_status("COMPLETED");
@@ -149,8 +510,64 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
       result->set_report_id("report_" + request->match_id());
       result->set_player_metrics_csv_path(output_dir + "/player_metrics.csv");
       result->set_ball_metrics_csv_path(output_dir + "/ball_metrics.csv");
+      result->set_player_metrics_columnar_path(output_dir +
+                                               "/player_metrics.fcol");
+      result->set_ball_metrics_columnar_path(output_dir + "/ball_metrics.fcol");
+      result->set_player_summary_csv_path(output_dir + "/player_summary.csv");
+      result->set_player_events_csv_path(output_dir + "/player_events.csv");
+      result->set_heatmaps_path(output_dir + "/heatmaps.fcol");
+      result->set_heatmap_image_dir(output_dir + "/heatmaps");
+      result->set_possession_spells_csv_path(output_dir +
+                                             "/possession_spells.csv");
+      result->set_team_possession_csv_path(output_dir + "/team_possession.csv");
+      result->set_passes_csv_path(output_dir + "/passes.csv");
+      result->set_team_shape_csv_path(output_dir + "/team_shape.csv");
+      result->set_team_shape_columnar_path(output_dir + "/team_shape.fcol");
+      result->set_offsides_csv_path(output_dir + "/offsides.csv");
+      if (pitch_control) {
+        result->set_pitch_control_csv_path(output_dir + "/pitch_control.csv");
+        if (request->pitch_control_grids()) {
+          result->set_pitch_control_grid_dir(output_dir + "/pitch_control");
+        }
+      }
+      FillTeamPossession(metrics_calculator.possession().team_possession(),
+                         result->mutable_team_possession());
+      FillPlayerSummaries(metrics_calculator.player_summaries(),
+                          result->mutable_player_summaries());
+      FillStageLatencies(profiler, result->mutable_stage_latencies());
+      result->set_frames_per_second(profiler.frames_per_second());
+      response.clear_stage_latencies();
+      std::cout << profiler.format_report();
+      WriteTrace(tracer.get(), request->match_id());
+
+      if (result_cache_) {
+        CachedResult to_cache;
+        to_cache.player_metrics_csv_path = result->player_metrics_csv_path();
+        to_cache.ball_metrics_csv_path = result->ball_metrics_csv_path();
+        to_cache.player_metrics_columnar_path =
+            result->player_metrics_columnar_path();
+        to_cache.ball_metrics_columnar_path =
+            result->ball_metrics_columnar_path();
+        to_cache.player_summary_csv_path = result->player_summary_csv_path();
+        to_cache.player_events_csv_path = result->player_events_csv_path();
+        to_cache.heatmaps_path = result->heatmaps_path();
+        to_cache.heatmap_image_dir = result->heatmap_image_dir();
+        to_cache.possession_spells_csv_path =
+            result->possession_spells_csv_path();
+        to_cache.team_possession_csv_path = result->team_possession_csv_path();
+        to_cache.passes_csv_path = result->passes_csv_path();
+        to_cache.team_shape_csv_path = result->team_shape_csv_path();
+        to_cache.team_shape_columnar_path = result->team_shape_columnar_path();
+        to_cache.offsides_csv_path = result->offsides_csv_path();
+        to_cache.pitch_control_csv_path = result->pitch_control_csv_path();
+        to_cache.pitch_control_grid_dir = result->pitch_control_grid_dir();
+        to_cache.total_frames = result->total_frames();
+        to_cache.players_tracked = result->players_tracked();
+        result_cache_->store(cache_key, to_cache);
+      }
 
       writer->Write(response);
+      job_scope.mark_succeeded();
 
     } catch (const std::exception &e) {
       std::cerr << "Error during analysis: " << e.what() << std::endl;
@@ -204,14 +621,24 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
       streaming_done = true;
     });
 
+    StageProfiler profiler;
+    std::unique_ptr<TraceRecorder> tracer = StartTrace(profiler);
+    ActiveJobScope job_scope(stats_, true, &profiler);
+
     try {
       // Initialize Components (Same as AnalyzeVideo but streaming)
       Calibration calibration(first_chunk.calibration_path());
-      YoloV8 yolo_detector(first_chunk.model_path().empty()
-                               ? "yolov8m.onnx"
-                               : first_chunk.model_path());
+      std::unique_ptr<YoloV8> detector =
+          LoadDetector(first_chunk.model_path().empty()
+                           ? "yolov8m.onnx"
+                           : first_chunk.model_path());
+      YoloV8 &yolo_detector = *detector;
+      yolo_detector.set_profiler(&profiler);
       PlayerTracker player_tracker;
       BallTracker ball_tracker;
+      PossessionTracker possession;
+      PassDetector pass_detector;
+      size_t passes_sent = 0;
 
       // Output dir for final artifacts if needed
       std::string output_dir = "/tmp/analysis_stream_" + match_id;
@@ -232,7 +659,14 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
       if (video_fps == 0)
         video_fps = 30.0;
 
-      while (cap.read(frame)) {
+      while (true) {
+        profiler.set_current_frame(current_frame_idx + 1);
+        {
+          PROFILE_STAGE(&profiler, Stage::Decode);
+          if (!cap.read(frame)) {
+            break;
+          }
+        }
         current_frame_idx++;
 
         // 1. Detection
@@ -246,13 +680,30 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
         }
 
         // 2. Tracking
-        player_tracker.update(player_detections, frame);
-        ball_tracker.update(ball_detections);
+        {
+          PROFILE_STAGE(&profiler, Stage::PlayerTracking);
+          player_tracker.update(player_detections, frame);
+        }
+        {
+          PROFILE_STAGE(&profiler, Stage::BallTracking);
+          ball_tracker.update(ball_detections);
+        }
 
         // 3. Real-world Projection
-        auto real_world_players =
-            calibration.transform(player_tracker.get_tracks());
-        auto real_world_ball = calibration.transform(ball_tracker.get_track());
+        std::vector<std::pair<int, cv::Point2f>> real_world_players;
+        std::pair<int, cv::Point2f> real_world_ball;
+        {
+          PROFILE_STAGE(&profiler, Stage::Calibration);
+          real_world_players =
+              calibration.transform(player_tracker.get_tracks());
+          real_world_ball = calibration.transform(ball_tracker.get_track());
+        }
+        // Possession runs on every frame; updates below are throttled
+        int possessor = possession.update(
+            current_frame_idx, video_fps, real_world_players, real_world_ball,
+            player_tracker.get_team_assignments());
+        pass_detector.update(possession, video_fps);
+        profiler.record_frame();
 
         // 4. Send metrics back in real-time
         if (current_frame_idx % 5 == 0) { // Throttling updates to 6Hz approx
@@ -276,6 +727,18 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
             b->set_x(real_world_ball.second.x);
             b->set_y(real_world_ball.second.y);
             b->set_frame_index(current_frame_idx);
+            b->set_is_possessed(possessor != -1);
+            b->set_possessor_id(possessor);
+          }
+          AddPassEvents(pass_detector.passes(), passes_sent,
+                        update.mutable_passes());
+          passes_sent = pass_detector.passes().size();
+
+          // Latency and possession snapshot roughly every 10 seconds of video
+          if (current_frame_idx % 300 == 0) {
+            FillStageLatencies(profiler, update.mutable_stage_latencies());
+            FillTeamPossession(possession.team_possession(),
+                               update.mutable_team_possession());
           }
 
           stream->Write(update);
@@ -291,7 +754,15 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
       final_update.set_message("Real-time analysis finished. " +
                                std::to_string(current_frame_idx) +
                                " frames processed.");
+      FillStageLatencies(profiler, final_update.mutable_stage_latencies());
+      FillTeamPossession(possession.team_possession(),
+                         final_update.mutable_team_possession());
+      AddPassEvents(pass_detector.passes(), passes_sent,
+                    final_update.mutable_passes());
       stream->Write(final_update);
+      std::cout << profiler.format_report();
+      WriteTrace(tracer.get(), "stream_" + match_id);
+      job_scope.mark_succeeded();
 
     } catch (const std::exception &e) {
       if (feeder_thread.joinable())
@@ -306,7 +777,54 @@ class AnalysisEngineServiceImpl final : public AnalysisEngine::Service {
 
 void RunServer(const std::string &port) {
   std::string server_address("0.0.0.0:" + port);
-  AnalysisEngineServiceImpl service;
+
+  // Result cache location and size limit (ANALYSIS_CACHE_DIR="" disables it)
+  const char *cache_dir_env = std::getenv("ANALYSIS_CACHE_DIR");
+  const char *cache_max_mb_env = std::getenv("ANALYSIS_CACHE_MAX_MB");
+  std::string cache_dir = cache_dir_env ? cache_dir_env : "/tmp/analysis_cache";
+  std::uintmax_t cache_max_mb =
+      cache_max_mb_env ? std::strtoull(cache_max_mb_env, nullptr, 10) : 10240;
+
+  std::unique_ptr<ResultCache> result_cache;
+  if (!cache_dir.empty()) {
+    result_cache =
+        std::make_unique<ResultCache>(cache_dir, cache_max_mb * 1024 * 1024);
+    std::cout << "Result cache: " << cache_dir << " (max " << cache_max_mb
+              << " MB)" << std::endl;
+  }
+
+  // AnalyzeVideo checkpoint interval in frames (0 disables checkpointing)
+  const char *checkpoint_interval_env =
+      std::getenv("ANALYSIS_CHECKPOINT_INTERVAL");
+  int checkpoint_interval =
+      checkpoint_interval_env ? std::atoi(checkpoint_interval_env) : 9000;
+
+  // Prometheus metrics and health endpoint (ANALYSIS_METRICS_PORT=0 disables)
+  ServiceStats stats;
+  const char *metrics_port_env = std::getenv("ANALYSIS_METRICS_PORT");
+  int metrics_port = metrics_port_env ? std::atoi(metrics_port_env) : 9464;
+  std::unique_ptr<StatsServer> stats_server;
+  if (metrics_port > 0) {
+    try {
+      stats_server = std::make_unique<StatsServer>(
+          metrics_port, [&stats]() { return stats.render_prometheus(); });
+      std::cout << "Metrics endpoint listening on 0.0.0.0:" << metrics_port
+                << "/metrics" << std::endl;
+    } catch (const std::exception &e) {
+      std::cerr << "Warning: Metrics endpoint disabled: " << e.what()
+                << std::endl;
+    }
+  }
+
+  // Per-job Chrome traces of the pipeline timeline (unset disables tracing)
+  const char *trace_dir_env = std::getenv("ANALYSIS_TRACE_DIR");
+  std::string trace_dir = trace_dir_env ? trace_dir_env : "";
+  if (!trace_dir.empty()) {
+    fs::create_directories(trace_dir);
+  }
+
+  AnalysisEngineServiceImpl service(result_cache.get(), checkpoint_interval,
+                                    &stats, trace_dir);
 
   ServerBuilder builder;
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
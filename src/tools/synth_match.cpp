@@ -0,0 +1,537 @@
+// Synthetic football match generator for load and scaling tests.
+//
+// Simulates players of two teams, referees and a ball being passed between players, seen by a
+// broadcast-style camera that pans to follow play. Writes either a rendered video (to exercise
+// decode and detection) or a detection dump that test_runner can --replay-detections (to
+// exercise tracking and analytics), plus a ground-truth CSV with the true identity and pitch
+// position of every object in every frame.
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "cxxopts.hpp"
+#include "detection/detection_io.h"
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+namespace {
+
+const float kPitchLength = 105.0f;
+const float kPitchWidth = 68.0f;
+const float kPlayerHeight = 1.8f;
+const float kMaxPlayerSpeed = 7.5f;    // m/s
+const float kMaxPlayerAccel = 4.0f;    // m/s^2
+const float kPassSpeed = 16.0f;        // m/s
+const float kCameraViewLength = 60.0f; // metres of touchline visible when panning
+const float kOffsideRunDepth = 5.0f;   // metres a staged offside runner goes beyond the defenders
+const float kMaxOffsidePass = 60.0f;   // longest staged offside pass, in metres
+const float kThroughBallSpeed = 30.0f; // m/s, staged offside passes: too fast to be taken on the way
+const double kOffsideRunSeconds = 10.0; // the pass is played after this long even if the run is short
+
+enum class Role { Player, Referee };
+
+struct SynthConfig {
+    std::string output_path;
+    std::string mode;
+    std::string ground_truth_path;
+    std::string calibration_out_path;
+    double duration_s;
+    double fps;
+    int num_players;
+    int num_referees;
+    int width;
+    int height;
+    bool pan;
+    double ball_occlusion_rate; // occlusion events per second
+    double detection_miss_rate; // per object and frame
+    double offside_interval_s;  // a staged offside every this many seconds, 0 for none
+    unsigned seed;
+};
+
+struct Agent {
+    int id;
+    Role role;
+    int team; // 0 or 1 for players, -1 for referees
+    cv::Point2f home;
+    cv::Point2f pos;
+    cv::Point2f vel;
+    cv::Scalar jersey_bgr;
+};
+
+struct Ball {
+    cv::Point2f pos;
+    int owner = 0;      // index into agents, -1 while in flight
+    int receiver = -1;  // target of the current pass
+    double hold_time_s = 0.0;
+    double occluded_until_s = -1.0;
+    int runner = -1;            // teammate of the owner making a staged offside run, -1 if none
+    double run_deadline_s = 0.0;
+    double next_run_s = 0.0;    // earliest start of the next staged offside run
+    float speed = kPassSpeed;   // of the pass in flight
+};
+
+// Perspective view of the pitch: the far touchline (y = 0) at the top of the image, narrower
+// than the near one, over a window of the pitch centred on `center_x`
+cv::Mat camera_homography(float center_x, float view_length, int width, int height) {
+    float x0 = center_x - view_length / 2.0f;
+    float x1 = center_x + view_length / 2.0f;
+    std::vector<cv::Point2f> pitch = {{x0, 0.0f}, {x1, 0.0f}, {x1, kPitchWidth}, {x0, kPitchWidth}};
+    std::vector<cv::Point2f> image = {{0.15f * width, 0.12f * height}, {0.85f * width, 0.12f * height},
+                                      {1.02f * width, 0.98f * height}, {-0.02f * width, 0.98f * height}};
+    return cv::getPerspectiveTransform(pitch, image);
+}
+
+cv::Point2f project(const cv::Mat& homography, const cv::Point2f& point) {
+    std::vector<cv::Point2f> src = {point}, dst;
+    cv::perspectiveTransform(src, dst, homography);
+    return dst[0];
+}
+
+// Pixel height of a standing person at pitch position `foot`
+float person_height_px(const cv::Mat& homography, const cv::Point2f& foot, const cv::Point2f& foot_px) {
+    // Approximate the vertical scale by projecting a point slightly further from the camera
+    cv::Point2f behind_px = project(homography, cv::Point2f(foot.x, foot.y - 1.0f));
+    return std::max(4.0f, (foot_px.y - behind_px.y) * kPlayerHeight * 3.0f);
+}
+
+cv::Scalar bgr_to_hsv(const cv::Scalar& bgr) {
+    cv::Mat pixel(1, 1, CV_8UC3, bgr), hsv;
+    cv::cvtColor(pixel, hsv, cv::COLOR_BGR2HSV);
+    cv::Vec3b value = hsv.at<cv::Vec3b>(0, 0);
+    return cv::Scalar(value[0], value[1], value[2]);
+}
+
+std::vector<Agent> create_agents(const SynthConfig& config, std::mt19937& rng) {
+    std::vector<Agent> agents;
+    const cv::Scalar team_colors[2] = {cv::Scalar(40, 40, 200), cv::Scalar(235, 235, 235)};
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    for (int i = 0; i < config.num_players; ++i) {
+        Agent agent;
+        agent.id = static_cast<int>(agents.size());
+        agent.role = Role::Player;
+        agent.team = i % 2;
+        // Home positions spread over the team's own half, goalkeeper-ish depth included
+        float depth = 3.0f + unit(rng) * (kPitchLength / 2.0f - 3.0f);
+        agent.home = cv::Point2f(agent.team == 0 ? depth : kPitchLength - depth, 4.0f + unit(rng) * (kPitchWidth - 8.0f));
+        agent.pos = agent.home;
+        agent.vel = cv::Point2f(0.0f, 0.0f);
+        agent.jersey_bgr = team_colors[agent.team];
+        agents.push_back(agent);
+    }
+    for (int i = 0; i < config.num_referees; ++i) {
+        Agent agent;
+        agent.id = static_cast<int>(agents.size());
+        agent.role = Role::Referee;
+        agent.team = -1;
+        agent.home = cv::Point2f(kPitchLength / 2.0f, kPitchWidth / 2.0f);
+        agent.pos = agent.home;
+        agent.vel = cv::Point2f(0.0f, 0.0f);
+        agent.jersey_bgr = cv::Scalar(20, 220, 230);
+        agents.push_back(agent);
+    }
+    return agents;
+}
+
+cv::Point2f clamp_to_pitch(const cv::Point2f& p) {
+    return cv::Point2f(std::clamp(p.x, 0.0f, kPitchLength), std::clamp(p.y, 0.0f, kPitchWidth));
+}
+
+// Where a staged offside runner heads: kOffsideRunDepth beyond the opponents' second-last player.
+// Team 0 defends the left goal and attacks the right one.
+cv::Point2f offside_run_target(const std::vector<Agent>& agents, const Agent& runner) {
+    std::vector<float> depths; // opponents' distances from their own goal line
+    for (const Agent& agent : agents) {
+        if (agent.role == Role::Player && agent.team != runner.team) {
+            depths.push_back(agent.team == 0 ? agent.pos.x : kPitchLength - agent.pos.x);
+        }
+    }
+    float line = kPitchLength / 2.0f;
+    if (depths.size() >= 2) {
+        std::nth_element(depths.begin(), depths.begin() + 1, depths.end());
+        line = std::min(line, depths[1]);
+    }
+    float depth = std::max(0.0f, line - kOffsideRunDepth);
+    return clamp_to_pitch(cv::Point2f(runner.team == 0 ? kPitchLength - depth : depth, runner.pos.y));
+}
+
+void step_agents(std::vector<Agent>& agents, const Ball& ball, float dt, std::mt19937& rng) {
+    std::normal_distribution<float> jitter(0.0f, 1.5f);
+    const cv::Point2f pitch_center(kPitchLength / 2.0f, kPitchWidth / 2.0f);
+    cv::Point2f ball_shift = (ball.pos - pitch_center) * 0.35f;
+
+    // The player of each team closest to the ball presses it
+    int chaser[2] = {-1, -1};
+    float chaser_dist[2] = {1e9f, 1e9f};
+    for (size_t i = 0; i < agents.size(); ++i) {
+        if (agents[i].role != Role::Player) continue;
+        float dist = static_cast<float>(cv::norm(agents[i].pos - ball.pos));
+        if (dist < chaser_dist[agents[i].team]) {
+            chaser_dist[agents[i].team] = dist;
+            chaser[agents[i].team] = static_cast<int>(i);
+        }
+    }
+
+    for (size_t i = 0; i < agents.size(); ++i) {
+        Agent& agent = agents[i];
+        cv::Point2f target;
+        if (agent.role == Role::Referee) {
+            target = ball.pos + cv::Point2f(jitter(rng) * 4.0f, 8.0f + jitter(rng));
+        } else if (static_cast<int>(i) == ball.runner) {
+            target = offside_run_target(agents, agent);
+        } else if (static_cast<int>(i) == chaser[agent.team] && static_cast<int>(i) != ball.owner) {
+            target = ball.pos;
+        } else {
+            target = agent.home + ball_shift + cv::Point2f(jitter(rng), jitter(rng));
+        }
+
+        // Steer towards the target with bounded acceleration and speed
+        cv::Point2f desired = target - agent.pos;
+        float desired_len = static_cast<float>(cv::norm(desired));
+        if (desired_len > 1e-3f) {
+            desired = desired * (std::min(kMaxPlayerSpeed, desired_len) / desired_len);
+        }
+        cv::Point2f accel = (desired - agent.vel) * (1.0f / dt);
+        float accel_len = static_cast<float>(cv::norm(accel));
+        if (accel_len > kMaxPlayerAccel) {
+            accel = accel * (kMaxPlayerAccel / accel_len);
+        }
+        agent.vel += accel * dt;
+        agent.pos = clamp_to_pitch(agent.pos + agent.vel * dt);
+    }
+}
+
+void step_ball(Ball& ball, const std::vector<Agent>& agents, int num_players, double time_s, float dt,
+               double occlusion_rate, double offside_interval_s, std::mt19937& rng) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    if (ball.owner >= 0) {
+        const Agent& owner = agents[ball.owner];
+        ball.pos = clamp_to_pitch(owner.pos + cv::Point2f(owner.team == 0 ? 0.6f : -0.6f, 0.2f));
+        ball.hold_time_s -= dt;
+        // A staged offside: the owner's most advanced teammate runs beyond the defenders and the
+        // owner holds the ball until they get there. Owners too far from that spot for a pass
+        // wait for the next possession.
+        if (offside_interval_s > 0.0 && ball.runner < 0 && time_s >= ball.next_run_s) {
+            int runner = -1;
+            for (int i = 0; i < num_players; ++i) {
+                if (i == ball.owner || agents[i].team != owner.team) continue;
+                float advance = owner.team == 0 ? agents[i].pos.x : -agents[i].pos.x;
+                if (runner < 0 || advance > (owner.team == 0 ? agents[runner].pos.x : -agents[runner].pos.x)) {
+                    runner = i;
+                }
+            }
+            if (runner >= 0 && cv::norm(offside_run_target(agents, agents[runner]) - owner.pos) <= kMaxOffsidePass) {
+                ball.runner = runner;
+                ball.run_deadline_s = time_s + kOffsideRunSeconds;
+                ball.next_run_s = time_s + offside_interval_s;
+            }
+        }
+        if (ball.runner >= 0) {
+            const Agent& runner = agents[ball.runner];
+            if (time_s >= ball.run_deadline_s || cv::norm(runner.pos - offside_run_target(agents, runner)) < 1.5) {
+                ball.receiver = ball.runner;
+                ball.speed = kThroughBallSpeed;
+                ball.runner = -1;
+                ball.owner = -1;
+            }
+        } else if (ball.hold_time_s <= 0.0 && num_players > 1) {
+            // Mostly passes to a teammate; some go astray to an opponent
+            std::uniform_int_distribution<int> pick(0, num_players - 1);
+            bool to_teammate = unit(rng) < 0.8;
+            int receiver = ball.owner;
+            for (int attempt = 0; attempt < 16 && (receiver == ball.owner || (agents[receiver].team == owner.team) != to_teammate); ++attempt) {
+                receiver = pick(rng);
+            }
+            if (receiver != ball.owner) {
+                ball.receiver = receiver;
+                ball.speed = kPassSpeed;
+                ball.owner = -1;
+            } else {
+                ball.hold_time_s = 0.5;
+            }
+        }
+    } else {
+        cv::Point2f to_receiver = agents[ball.receiver].pos - ball.pos;
+        float dist = static_cast<float>(cv::norm(to_receiver));
+        if (dist <= ball.speed * dt) {
+            ball.owner = ball.receiver;
+            ball.receiver = -1;
+            ball.hold_time_s = 1.0 + unit(rng) * 3.0;
+        } else {
+            ball.pos = ball.pos + to_receiver * (ball.speed * dt / dist);
+        }
+    }
+
+    // Occlusion events (behind players, in the air against the crowd) last 0.2-1.2s
+    if (time_s >= ball.occluded_until_s && unit(rng) < occlusion_rate * dt) {
+        ball.occluded_until_s = time_s + 0.2 + unit(rng) * 1.0;
+    }
+}
+
+void draw_pitch(cv::Mat& image, const cv::Mat& homography) {
+    image.setTo(cv::Scalar(40, 120, 40));
+
+    // Mowing stripes every 5.25m
+    for (int stripe = 0; stripe < 20; stripe += 2) {
+        std::vector<cv::Point2f> corners = {{stripe * 5.25f, 0.0f}, {(stripe + 1) * 5.25f, 0.0f},
+                                            {(stripe + 1) * 5.25f, kPitchWidth}, {stripe * 5.25f, kPitchWidth}};
+        std::vector<cv::Point2f> projected;
+        cv::perspectiveTransform(corners, projected, homography);
+        std::vector<cv::Point> polygon(projected.begin(), projected.end());
+        cv::fillConvexPoly(image, polygon, cv::Scalar(50, 140, 50));
+    }
+
+    auto line = [&](cv::Point2f a, cv::Point2f b) {
+        cv::line(image, project(homography, a), project(homography, b), cv::Scalar(230, 230, 230), 2, cv::LINE_AA);
+    };
+    line({0, 0}, {kPitchLength, 0});
+    line({0, kPitchWidth}, {kPitchLength, kPitchWidth});
+    line({0, 0}, {0, kPitchWidth});
+    line({kPitchLength, 0}, {kPitchLength, kPitchWidth});
+    line({kPitchLength / 2.0f, 0}, {kPitchLength / 2.0f, kPitchWidth});
+    const int kCircleSegments = 32;
+    for (int i = 0; i < kCircleSegments; ++i) {
+        float a0 = 2.0f * static_cast<float>(CV_PI) * i / kCircleSegments;
+        float a1 = 2.0f * static_cast<float>(CV_PI) * (i + 1) / kCircleSegments;
+        cv::Point2f center(kPitchLength / 2.0f, kPitchWidth / 2.0f);
+        line(center + cv::Point2f(9.15f * std::cos(a0), 9.15f * std::sin(a0)),
+             center + cv::Point2f(9.15f * std::cos(a1), 9.15f * std::sin(a1)));
+    }
+}
+
+void draw_person(cv::Mat& image, const cv::Rect& box, const cv::Scalar& jersey) {
+    int shirt_height = box.height * 45 / 100;
+    int head = std::max(1, box.width / 3);
+    cv::circle(image, cv::Point(box.x + box.width / 2, box.y + head), head, cv::Scalar(120, 150, 200), cv::FILLED);
+    cv::rectangle(image, cv::Rect(box.x, box.y + 2 * head, box.width, shirt_height), jersey, cv::FILLED);
+    cv::rectangle(image, cv::Rect(box.x + box.width / 6, box.y + 2 * head + shirt_height, box.width * 2 / 3,
+                                  std::max(1, box.height - 2 * head - shirt_height)),
+                  cv::Scalar(30, 30, 30), cv::FILLED);
+}
+
+bool write_calibration(const std::string& path, const cv::Mat& homography) {
+    // Calibration maps image pixels to pitch metres, the inverse of the rendering homography
+    cv::Mat image_to_pitch = homography.inv();
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.precision(12);
+    file << "homography_matrix:\n";
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            file << "  - " << image_to_pitch.at<double>(i, j) / image_to_pitch.at<double>(2, 2) << "\n";
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("synth_match", "Generates synthetic football matches for load and scaling tests.");
+
+    options.add_options()
+        ("o,output", "Output file: a video (--mode video) or a detection dump (--mode detections)", cxxopts::value<std::string>())
+        ("mode", "What to generate: video or detections", cxxopts::value<std::string>()->default_value("detections"))
+        ("ground-truth", "Ground-truth CSV path (default: <output>.truth.csv)", cxxopts::value<std::string>()->default_value(""))
+        ("calib-out", "Write the pixel-to-pitch calibration of the first frame to this YAML file", cxxopts::value<std::string>()->default_value(""))
+        ("duration", "Match duration in seconds", cxxopts::value<double>()->default_value("60"))
+        ("fps", "Frames per second", cxxopts::value<double>()->default_value("25"))
+        ("players", "Number of outfield players (split evenly between two teams)", cxxopts::value<int>()->default_value("22"))
+        ("referees", "Number of referees", cxxopts::value<int>()->default_value("1"))
+        ("width", "Frame width in pixels", cxxopts::value<int>()->default_value("1920"))
+        ("height", "Frame height in pixels", cxxopts::value<int>()->default_value("1080"))
+        ("no-pan", "Keep the camera static on the whole pitch (the --calib-out calibration then holds for every frame)", cxxopts::value<bool>()->default_value("false"))
+        ("ball-occlusion-rate", "Ball occlusion events per second", cxxopts::value<double>()->default_value("0.3"))
+        ("miss-rate", "Probability that a visible object is not detected in a frame", cxxopts::value<double>()->default_value("0.03"))
+        ("offside-every", "Stage an offside every this many seconds: a player runs beyond the defenders and is passed the ball (0: never)", cxxopts::value<double>()->default_value("0"))
+        ("seed", "Random seed", cxxopts::value<unsigned>()->default_value("1"))
+        ("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("h")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    SynthConfig config;
+    try {
+        config.output_path = result["output"].as<std::string>();
+        config.mode = result["mode"].as<std::string>();
+        config.ground_truth_path = result["ground-truth"].as<std::string>();
+        config.calibration_out_path = result["calib-out"].as<std::string>();
+        config.duration_s = result["duration"].as<double>();
+        config.fps = result["fps"].as<double>();
+        config.num_players = result["players"].as<int>();
+        config.num_referees = result["referees"].as<int>();
+        config.width = result["width"].as<int>();
+        config.height = result["height"].as<int>();
+        config.pan = !result["no-pan"].as<bool>();
+        config.ball_occlusion_rate = result["ball-occlusion-rate"].as<double>();
+        config.detection_miss_rate = result["miss-rate"].as<double>();
+        config.offside_interval_s = result["offside-every"].as<double>();
+        config.seed = result["seed"].as<unsigned>();
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing arguments: " << e.what() << std::endl;
+        std::cerr << options.help() << std::endl;
+        return 1;
+    }
+    if (config.mode != "video" && config.mode != "detections") {
+        std::cerr << "Error: --mode must be 'video' or 'detections'" << std::endl;
+        return 1;
+    }
+    if (config.num_players < 1 || config.fps <= 0 || config.width <= 0 || config.height <= 0) {
+        std::cerr << "Error: --players, --fps, --width and --height must be positive" << std::endl;
+        return 1;
+    }
+    if (config.ground_truth_path.empty()) {
+        config.ground_truth_path = config.output_path + ".truth.csv";
+    }
+
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<float> box_noise(0.0f, 1.5f);
+    std::normal_distribution<float> color_noise(0.0f, 8.0f);
+
+    std::vector<Agent> agents = create_agents(config, rng);
+    Ball ball;
+    ball.owner = 0;
+    ball.pos = agents[0].pos;
+    ball.hold_time_s = 1.0;
+    ball.next_run_s = config.offside_interval_s;
+
+    std::unique_ptr<cv::VideoWriter> video_writer;
+    std::unique_ptr<DetectionWriter> detection_writer;
+    try {
+        if (config.mode == "video") {
+            video_writer = std::make_unique<cv::VideoWriter>(config.output_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'),
+                                                             config.fps, cv::Size(config.width, config.height));
+            if (!video_writer->isOpened()) {
+                std::cerr << "Error: Could not open video writer for " << config.output_path << std::endl;
+                return 1;
+            }
+        } else {
+            detection_writer = std::make_unique<DetectionWriter>(config.output_path, config.fps);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ofstream truth(config.ground_truth_path);
+    if (!truth.is_open()) {
+        std::cerr << "Error: Could not open ground-truth file " << config.ground_truth_path << std::endl;
+        return 1;
+    }
+    truth << "frame,object_id,role,team,x_m,y_m,pixel_x,pixel_y,visible\n";
+
+    const int total_frames = static_cast<int>(std::lround(config.duration_s * config.fps));
+    const float dt = static_cast<float>(1.0 / config.fps);
+    const float view_length = config.pan ? kCameraViewLength : kPitchLength;
+    const cv::Rect image_rect(0, 0, config.width, config.height);
+    float camera_x = kPitchLength / 2.0f;
+    cv::Mat image(config.height, config.width, CV_8UC3);
+    DetectionFrame detections;
+
+    for (int frame_idx = 1; frame_idx <= total_frames; ++frame_idx) {
+        double time_s = (frame_idx - 1) * dt;
+        step_agents(agents, ball, dt, rng);
+        step_ball(ball, agents, config.num_players, time_s, dt, config.ball_occlusion_rate, config.offside_interval_s, rng);
+
+        // The camera eases towards the ball, never showing beyond the goal lines
+        if (config.pan) {
+            float target_x = std::clamp(ball.pos.x, view_length / 2.0f, kPitchLength - view_length / 2.0f);
+            camera_x += (target_x - camera_x) * std::min(1.0f, 1.5f * dt);
+        }
+        cv::Mat homography = camera_homography(camera_x, view_length, config.width, config.height);
+        if (frame_idx == 1 && !config.calibration_out_path.empty() && !write_calibration(config.calibration_out_path, homography)) {
+            std::cerr << "Warning: Could not write calibration to " << config.calibration_out_path << std::endl;
+        }
+
+        detections.frame_index = frame_idx;
+        detections.players.clear();
+        detections.player_colors.clear();
+        detections.balls.clear();
+        if (video_writer) {
+            draw_pitch(image, homography);
+        }
+
+        // Far-to-near so nearer people are drawn on top
+        std::vector<int> order(agents.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return agents[a].pos.y < agents[b].pos.y; });
+
+        for (int index : order) {
+            const Agent& agent = agents[index];
+            cv::Point2f foot_px = project(homography, agent.pos);
+            float height_px = person_height_px(homography, agent.pos, foot_px);
+            float width_px = height_px * 0.4f;
+            cv::Rect box(cv::Point(static_cast<int>(foot_px.x - width_px / 2.0f), static_cast<int>(foot_px.y - height_px)),
+                         cv::Size(static_cast<int>(width_px), static_cast<int>(height_px)));
+            bool visible = (box & image_rect).area() > 0;
+
+            truth << frame_idx << "," << agent.id << "," << (agent.role == Role::Player ? "player" : "referee") << ","
+                  << (agent.team == 0 ? "Team A" : agent.team == 1 ? "Team B" : "Referee") << ","
+                  << agent.pos.x << "," << agent.pos.y << "," << foot_px.x << "," << foot_px.y << "," << (visible ? 1 : 0) << "\n";
+
+            if (!visible) {
+                continue;
+            }
+            if (video_writer) {
+                draw_person(image, box, agent.jersey_bgr);
+            } else if (unit(rng) >= config.detection_miss_rate) {
+                Detection det;
+                det.box = cv::Rect(box.x + static_cast<int>(box_noise(rng)), box.y + static_cast<int>(box_noise(rng)),
+                                   std::max(1, box.width + static_cast<int>(box_noise(rng))),
+                                   std::max(1, box.height + static_cast<int>(box_noise(rng))));
+                det.confidence = static_cast<float>(0.55 + 0.4 * unit(rng));
+                det.class_id = 0;
+                cv::Scalar jersey(agent.jersey_bgr[0] + color_noise(rng), agent.jersey_bgr[1] + color_noise(rng),
+                                  agent.jersey_bgr[2] + color_noise(rng));
+                for (int c = 0; c < 3; ++c) jersey[c] = std::clamp(jersey[c], 0.0, 255.0);
+                detections.players.push_back(det);
+                // Boxes reaching outside the frame get no color, as PlayerTracker::extract_colors would do
+                detections.player_colors.push_back((box & image_rect).area() == box.area() ? bgr_to_hsv(jersey) : cv::Scalar(-1, -1, -1));
+            }
+        }
+
+        cv::Point2f ball_px = project(homography, ball.pos);
+        bool ball_visible = time_s >= ball.occluded_until_s && image_rect.contains(cv::Point(ball_px));
+        truth << frame_idx << ",-1,ball,," << ball.pos.x << "," << ball.pos.y << "," << ball_px.x << "," << ball_px.y << ","
+              << (ball_visible ? 1 : 0) << "\n";
+        int ball_size = std::max(3, config.height / 120);
+        if (ball_visible) {
+            if (video_writer) {
+                cv::circle(image, cv::Point(ball_px), ball_size / 2, cv::Scalar(250, 250, 250), cv::FILLED, cv::LINE_AA);
+            } else if (unit(rng) >= config.detection_miss_rate) {
+                Detection det;
+                det.box = cv::Rect(static_cast<int>(ball_px.x) - ball_size / 2, static_cast<int>(ball_px.y) - ball_size,
+                                   ball_size, ball_size);
+                det.confidence = static_cast<float>(0.4 + 0.5 * unit(rng));
+                det.class_id = 32;
+                detections.balls.push_back(det);
+            }
+        }
+
+        if (video_writer) {
+            video_writer->write(image);
+        } else {
+            detection_writer->write(detections);
+        }
+
+        if (frame_idx % 10000 == 0) {
+            std::cout << "Generated " << frame_idx << " / " << total_frames << " frames" << std::endl;
+        }
+    }
+
+    std::cout << "Wrote " << total_frames << " frames to " << config.output_path << " and ground truth to "
+              << config.ground_truth_path << std::endl;
+    return 0;
+}
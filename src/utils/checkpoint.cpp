@@ -0,0 +1,241 @@
+#include "utils/checkpoint.h"
+#include "utils/serialization.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <opencv2/videoio.hpp>
+
+namespace {
+
+const uint32_t kCheckpointMagic = 0x4b435046; // "FPCK"
+// 2: metric rows stored as column tables, 3: per-player aggregates, 4: speed smoothing filters,
+// 5: load event state, 6: heatmaps, 7: ball possession, 8: passes, 9: pitch control,
+// 10: team shapes, 11: offsides, 12: ball trajectory refinement, 13: ball hypotheses,
+// 14: ball tracking confidence, 15: keyframe propagation, 16: metric rows in an append-only sidecar,
+// 17: online team assignment, 18: event lists in the sidecar
+const uint32_t kCheckpointVersion = 18;
+
+// The metric rows grow with the video, so instead of re-encoding all of them in every checkpoint
+// each checkpoint appends the rows added since the previous one to <path>.rows as a chunk
+// (size, checksum, payload) and records the sidecar length
+const char* const kRowsSuffix = ".rows";
+
+bool append_rows(const std::string& rows_path, MetricsCalculator& metrics_calculator, uint64_t& rows_length) {
+    std::ostringstream chunk_stream;
+    metrics_calculator.save_new_rows(chunk_stream);
+    const std::string chunk = chunk_stream.str();
+    uint64_t checksum = serialization::kFnvOffsetBasis;
+    serialization::fnv1a(checksum, chunk.data(), chunk.size());
+    std::ostringstream header;
+    serialization::write_pod<uint64_t>(header, chunk.size());
+    serialization::write_pod(header, checksum);
+    const std::string header_bytes = header.str();
+
+    // A job that has not saved any rows yet starts a new file, replacing one left by an earlier job
+    FILE* file = std::fopen(rows_path.c_str(), metrics_calculator.has_saved_rows() ? "ab" : "wb");
+    if (!file) {
+        std::cerr << "Warning: Could not open checkpoint rows file " << rows_path << " for writing." << std::endl;
+        return false;
+    }
+    long start = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1;
+    bool ok = start >= 0 && std::fwrite(header_bytes.data(), 1, header_bytes.size(), file) == header_bytes.size() &&
+              std::fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size() &&
+              std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (ok) {
+        rows_length = static_cast<uint64_t>(std::ftell(file));
+    } else if (start >= 0 && ftruncate(fileno(file), start) != 0) {
+        // The partial chunk stays behind and the next append does not start at a chunk boundary
+        std::cerr << "Warning: Could not drop partial rows chunk from " << rows_path << std::endl;
+    }
+    std::fclose(file);
+    if (!ok) {
+        std::cerr << "Warning: Failed to append checkpoint rows to " << rows_path << std::endl;
+        return false;
+    }
+    metrics_calculator.mark_rows_saved();
+    return true;
+}
+
+// Reads the first `rows_length` bytes of the sidecar and returns the concatenated chunk payloads
+bool read_rows(const std::string& rows_path, uint64_t rows_length, std::string& rows) {
+    std::ifstream file(rows_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open() || static_cast<uint64_t>(file.tellg()) < rows_length) {
+        return false;
+    }
+    file.seekg(0);
+    uint64_t position = 0;
+    while (file && position < rows_length) {
+        uint64_t chunk_size = serialization::read_pod<uint64_t>(file);
+        uint64_t expected_checksum = serialization::read_pod<uint64_t>(file);
+        position += 2 * sizeof(uint64_t) + chunk_size;
+        if (position > rows_length) {
+            return false;
+        }
+        std::string chunk(chunk_size, '\0');
+        if (!file.read(&chunk[0], chunk_size)) {
+            return false;
+        }
+        uint64_t checksum = serialization::kFnvOffsetBasis;
+        serialization::fnv1a(checksum, chunk.data(), chunk.size());
+        if (checksum != expected_checksum) {
+            return false;
+        }
+        rows += chunk;
+    }
+    return file && position == rows_length;
+}
+
+} // namespace
+
+bool save_checkpoint(const std::string& path, const std::string& job_fingerprint, int frame_index,
+                     const PlayerTracker& player_tracker, const BallTracker& ball_tracker,
+                     MetricsCalculator& metrics_calculator) {
+    // The rows are synced before the checkpoint that records their length is renamed into place;
+    // rows appended for a checkpoint that never made it are cut off again on load
+    uint64_t rows_length = 0;
+    if (!append_rows(path + kRowsSuffix, metrics_calculator, rows_length)) {
+        return false;
+    }
+
+    std::ostringstream payload_stream;
+    serialization::write_string(payload_stream, job_fingerprint);
+    serialization::write_pod<int32_t>(payload_stream, frame_index);
+    serialization::write_pod<uint64_t>(payload_stream, rows_length);
+    player_tracker.save_state(payload_stream);
+    ball_tracker.save_state(payload_stream);
+    metrics_calculator.save_state(payload_stream);
+    const std::string payload = payload_stream.str();
+
+    uint64_t checksum = serialization::kFnvOffsetBasis;
+    serialization::fnv1a(checksum, payload.data(), payload.size());
+
+    std::ostringstream header;
+    serialization::write_pod(header, kCheckpointMagic);
+    serialization::write_pod(header, kCheckpointVersion);
+    serialization::write_pod<uint64_t>(header, payload.size());
+    serialization::write_pod(header, checksum);
+
+    // Write to a temporary file, fsync, then rename over the previous checkpoint
+    std::string tmp_path = path + ".tmp";
+    FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Warning: Could not open checkpoint file " << tmp_path << " for writing." << std::endl;
+        return false;
+    }
+    const std::string header_bytes = header.str();
+    bool ok = std::fwrite(header_bytes.data(), 1, header_bytes.size(), file) == header_bytes.size() &&
+              std::fwrite(payload.data(), 1, payload.size(), file) == payload.size() &&
+              std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    std::fclose(file);
+
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Warning: Failed to write checkpoint " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+int load_checkpoint(const std::string& path, const std::string& job_fingerprint,
+                    PlayerTracker& player_tracker, BallTracker& ball_tracker,
+                    MetricsCalculator& metrics_calculator) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    try {
+        if (serialization::read_pod<uint32_t>(file) != kCheckpointMagic ||
+            serialization::read_pod<uint32_t>(file) != kCheckpointVersion) {
+            std::cerr << "Warning: Ignoring checkpoint " << path << " with unknown format." << std::endl;
+            return 0;
+        }
+        uint64_t payload_size = serialization::read_pod<uint64_t>(file);
+        uint64_t expected_checksum = serialization::read_pod<uint64_t>(file);
+
+        std::string payload(payload_size, '\0');
+        if (!file.read(&payload[0], payload_size)) {
+            std::cerr << "Warning: Ignoring truncated checkpoint " << path << std::endl;
+            return 0;
+        }
+        uint64_t checksum = serialization::kFnvOffsetBasis;
+        serialization::fnv1a(checksum, payload.data(), payload.size());
+        if (checksum != expected_checksum) {
+            std::cerr << "Warning: Ignoring corrupt checkpoint " << path << std::endl;
+            return 0;
+        }
+
+        std::istringstream payload_stream(payload);
+        if (serialization::read_string(payload_stream) != job_fingerprint) {
+            std::cerr << "Warning: Ignoring checkpoint " << path << " from a different job." << std::endl;
+            return 0;
+        }
+        int frame_index = serialization::read_pod<int32_t>(payload_stream);
+        uint64_t rows_length = serialization::read_pod<uint64_t>(payload_stream);
+        const std::string rows_path = path + kRowsSuffix;
+        std::string rows;
+        if (!read_rows(rows_path, rows_length, rows)) {
+            std::cerr << "Warning: Ignoring checkpoint " << path << " with missing or corrupt rows." << std::endl;
+            return 0;
+        }
+
+        // Restore into copies (which keep the configuration of the originals) and only replace
+        // the originals once every component has loaded, so a failure leaves the state untouched
+        PlayerTracker restored_player_tracker = player_tracker;
+        BallTracker restored_ball_tracker = ball_tracker;
+        MetricsCalculator restored_metrics_calculator = metrics_calculator;
+        restored_player_tracker.load_state(payload_stream);
+        restored_ball_tracker.load_state(payload_stream);
+        restored_metrics_calculator.load_state(payload_stream);
+        std::istringstream rows_stream(rows);
+        restored_metrics_calculator.load_rows(rows_stream);
+
+        // Drop rows appended by a checkpoint that was never renamed into place, so the next one
+        // appends right after the rows restored here
+        if (truncate(rows_path.c_str(), static_cast<off_t>(rows_length)) != 0) {
+            std::cerr << "Warning: Could not truncate checkpoint rows " << rows_path << std::endl;
+            return 0;
+        }
+        player_tracker = std::move(restored_player_tracker);
+        ball_tracker = std::move(restored_ball_tracker);
+        metrics_calculator = std::move(restored_metrics_calculator);
+        return frame_index;
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Could not read checkpoint " << path << ": " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+void remove_checkpoint(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + kRowsSuffix).c_str());
+}
+
+bool seek_to_frame(cv::VideoCapture& cap, int frame_index) {
+    if (frame_index <= 0) {
+        return true;
+    }
+    if (cap.set(cv::CAP_PROP_POS_FRAMES, frame_index) &&
+        static_cast<int>(cap.get(cv::CAP_PROP_POS_FRAMES)) == frame_index) {
+        return true;
+    }
+
+    // Inexact seek (keyframe snapping) or no random access (pipes): skip from the start by
+    // grabbing, which avoids decoding
+    int position = static_cast<int>(cap.get(cv::CAP_PROP_POS_FRAMES));
+    if (position > frame_index) {
+        cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+        position = static_cast<int>(cap.get(cv::CAP_PROP_POS_FRAMES));
+        if (position != 0) {
+            return false;
+        }
+    }
+    for (int i = position; i < frame_index; ++i) {
+        if (!cap.grab()) {
+            return false;
+        }
+    }
+    return true;
+}
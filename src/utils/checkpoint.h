@@ -0,0 +1,33 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include "analytics/metrics.h"
+#include "detection/ball_tracker.h"
+#include "detection/player_tracker.h"
+
+// Periodic snapshots of the per-frame pipeline state so long jobs can resume after a restart.
+// A checkpoint is bound to a job fingerprint (video, model, calibration, thresholds) and is
+// only restored when the fingerprint matches.
+
+// Atomically writes the pipeline state after `frame_index` frames to `path`. The metric rows added
+// since the previous checkpoint are appended to `path`.rows, so each checkpoint costs only the
+// bounded per-track state plus the new rows.
+bool save_checkpoint(const std::string& path, const std::string& job_fingerprint, int frame_index,
+                     const PlayerTracker& player_tracker, const BallTracker& ball_tracker,
+                     MetricsCalculator& metrics_calculator);
+
+// Restores the pipeline state from `path` and returns the number of frames already processed,
+// or 0 (state untouched) if there is no valid checkpoint for this job.
+int load_checkpoint(const std::string& path, const std::string& job_fingerprint,
+                    PlayerTracker& player_tracker, BallTracker& ball_tracker,
+                    MetricsCalculator& metrics_calculator);
+
+// Deletes the checkpoint at `path` together with its rows file
+void remove_checkpoint(const std::string& path);
+
+// Positions `cap` so that the next read returns frame `frame_index` + 1 (1-based, as counted by the
+// processing loops). Falls back to grabbing frames when the container does not support seeking.
+bool seek_to_frame(cv::VideoCapture& cap, int frame_index);
+
+#endif // CHECKPOINT_H
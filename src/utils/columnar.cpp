@@ -0,0 +1,298 @@
+#include "utils/columnar.h"
+#include "utils/serialization.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t kColumnarMagic = 0x4c4f4346; // "FCOL"
+const uint32_t kColumnarVersion = 1;
+
+enum class Encoding : uint8_t { Plain = 0, Rle = 1, Dict = 2 };
+
+// Dictionaries larger than this are never worth it against PLAIN for our data
+const size_t kMaxDictSize = 1 << 16;
+
+template <typename T>
+void write_value(std::ostream& out, const T& value) {
+    serialization::write_pod(out, value);
+}
+
+void write_value(std::ostream& out, const std::string& value) {
+    serialization::write_string(out, value);
+}
+
+template <typename T>
+T read_value(std::istream& in) {
+    return serialization::read_pod<T>(in);
+}
+
+template <>
+std::string read_value<std::string>(std::istream& in) {
+    return serialization::read_string(in);
+}
+
+template <typename T>
+size_t value_size(const T&) {
+    return sizeof(T);
+}
+
+size_t value_size(const std::string& value) {
+    return sizeof(uint32_t) + value.size();
+}
+
+// Values are compared bitwise so NaNs form runs and dictionary entries like any other value
+template <typename T>
+bool same_value(const T& a, const T& b) {
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+bool same_value(const std::string& a, const std::string& b) {
+    return a == b;
+}
+
+template <typename T>
+struct BitwiseHash {
+    size_t operator()(const T& value) const {
+        uint64_t hash = serialization::kFnvOffsetBasis;
+        serialization::fnv1a(hash, &value, sizeof(T));
+        return static_cast<size_t>(hash);
+    }
+};
+
+template <>
+struct BitwiseHash<std::string> {
+    size_t operator()(const std::string& value) const { return std::hash<std::string>()(value); }
+};
+
+template <typename T>
+struct BitwiseEqual {
+    bool operator()(const T& a, const T& b) const { return same_value(a, b); }
+};
+
+template <typename T>
+void encode_column(std::ostream& out, const std::vector<T>& values) {
+    size_t plain_size = 0;
+    size_t num_runs = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        plain_size += value_size(values[i]);
+        if (i == 0 || !same_value(values[i], values[i - 1])) {
+            ++num_runs;
+        }
+    }
+
+    size_t rle_size = sizeof(uint32_t);
+    for (size_t i = 0; i < values.size();) {
+        size_t end = i + 1;
+        while (end < values.size() && same_value(values[end], values[i])) ++end;
+        rle_size += sizeof(uint32_t) + value_size(values[i]);
+        i = end;
+    }
+
+    std::unordered_map<T, uint32_t, BitwiseHash<T>, BitwiseEqual<T>> dict_index;
+    std::vector<const T*> dict;
+    size_t dict_values_size = 0;
+    for (const T& value : values) {
+        if (dict.size() > kMaxDictSize) break;
+        if (dict_index.emplace(value, static_cast<uint32_t>(dict.size())).second) {
+            dict.push_back(&value);
+            dict_values_size += value_size(value);
+        }
+    }
+    uint8_t index_width = dict.size() <= 0x100 ? 1 : dict.size() <= 0x10000 ? 2 : 4;
+    size_t dict_size = dict.size() > kMaxDictSize
+        ? SIZE_MAX
+        : sizeof(uint32_t) + dict_values_size + 1 + values.size() * index_width;
+
+    if (rle_size <= plain_size && rle_size <= dict_size) {
+        serialization::write_pod(out, Encoding::Rle);
+        serialization::write_pod<uint64_t>(out, rle_size);
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(num_runs));
+        for (size_t i = 0; i < values.size();) {
+            size_t end = i + 1;
+            while (end < values.size() && same_value(values[end], values[i])) ++end;
+            serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(end - i));
+            write_value(out, values[i]);
+            i = end;
+        }
+    } else if (dict_size < plain_size) {
+        serialization::write_pod(out, Encoding::Dict);
+        serialization::write_pod<uint64_t>(out, dict_size);
+        serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(dict.size()));
+        for (const T* value : dict) {
+            write_value(out, *value);
+        }
+        serialization::write_pod(out, index_width);
+        for (const T& value : values) {
+            uint32_t index = dict_index.at(value);
+            if (index_width == 1) {
+                serialization::write_pod<uint8_t>(out, static_cast<uint8_t>(index));
+            } else if (index_width == 2) {
+                serialization::write_pod<uint16_t>(out, static_cast<uint16_t>(index));
+            } else {
+                serialization::write_pod<uint32_t>(out, index);
+            }
+        }
+    } else {
+        serialization::write_pod(out, Encoding::Plain);
+        serialization::write_pod<uint64_t>(out, plain_size);
+        for (const T& value : values) {
+            write_value(out, value);
+        }
+    }
+}
+
+template <typename T>
+std::vector<T> decode_column(std::istream& in, Encoding encoding, uint64_t num_rows) {
+    std::vector<T> values;
+    values.reserve(num_rows);
+    if (encoding == Encoding::Plain) {
+        for (uint64_t i = 0; i < num_rows; ++i) {
+            values.push_back(read_value<T>(in));
+        }
+    } else if (encoding == Encoding::Rle) {
+        uint32_t num_runs = serialization::read_pod<uint32_t>(in);
+        for (uint32_t run = 0; run < num_runs; ++run) {
+            uint32_t run_length = serialization::read_pod<uint32_t>(in);
+            T value = read_value<T>(in);
+            if (run_length == 0 || run_length > num_rows - values.size()) {
+                throw std::runtime_error("Corrupt RLE column.");
+            }
+            values.insert(values.end(), run_length, value);
+        }
+    } else if (encoding == Encoding::Dict) {
+        uint32_t dict_size = serialization::read_pod<uint32_t>(in);
+        std::vector<T> dict;
+        dict.reserve(dict_size);
+        for (uint32_t i = 0; i < dict_size; ++i) {
+            dict.push_back(read_value<T>(in));
+        }
+        uint8_t index_width = serialization::read_pod<uint8_t>(in);
+        for (uint64_t i = 0; i < num_rows; ++i) {
+            uint32_t index = index_width == 1 ? serialization::read_pod<uint8_t>(in)
+                           : index_width == 2 ? serialization::read_pod<uint16_t>(in)
+                                              : serialization::read_pod<uint32_t>(in);
+            if (index >= dict.size()) {
+                throw std::runtime_error("Corrupt dictionary column.");
+            }
+            values.push_back(dict[index]);
+        }
+    } else {
+        throw std::runtime_error("Unknown column encoding.");
+    }
+    if (values.size() != num_rows) {
+        throw std::runtime_error("Column has the wrong number of rows.");
+    }
+    return values;
+}
+
+} // namespace
+
+void ColumnTable::add_column(const std::string& name, Values values) {
+    size_t size = std::visit([](const auto& column) { return column.size(); }, values);
+    if (size != num_rows_) {
+        throw std::invalid_argument("Column " + name + " has " + std::to_string(size) + " values, expected " +
+                                    std::to_string(num_rows_));
+    }
+    columns_.push_back({name, std::move(values)});
+}
+
+bool ColumnTable::has_column(const std::string& name) const {
+    for (const auto& column : columns_) {
+        if (column.name == name) return true;
+    }
+    return false;
+}
+
+const ColumnTable::Values& ColumnTable::find(const std::string& name) const {
+    for (const auto& column : columns_) {
+        if (column.name == name) return column.values;
+    }
+    throw std::runtime_error("Missing column " + name);
+}
+
+const std::vector<int32_t>& ColumnTable::int32_column(const std::string& name) const {
+    const auto* values = std::get_if<std::vector<int32_t>>(&find(name));
+    if (!values) throw std::runtime_error("Column " + name + " is not int32");
+    return *values;
+}
+
+const std::vector<float>& ColumnTable::float32_column(const std::string& name) const {
+    const auto* values = std::get_if<std::vector<float>>(&find(name));
+    if (!values) throw std::runtime_error("Column " + name + " is not float32");
+    return *values;
+}
+
+const std::vector<double>& ColumnTable::float64_column(const std::string& name) const {
+    const auto* values = std::get_if<std::vector<double>>(&find(name));
+    if (!values) throw std::runtime_error("Column " + name + " is not float64");
+    return *values;
+}
+
+const std::vector<std::string>& ColumnTable::string_column(const std::string& name) const {
+    const auto* values = std::get_if<std::vector<std::string>>(&find(name));
+    if (!values) throw std::runtime_error("Column " + name + " is not string");
+    return *values;
+}
+
+void ColumnTable::write(std::ostream& out) const {
+    serialization::write_pod(out, kColumnarMagic);
+    serialization::write_pod(out, kColumnarVersion);
+    serialization::write_pod<uint64_t>(out, num_rows_);
+    serialization::write_pod<uint32_t>(out, static_cast<uint32_t>(columns_.size()));
+    for (const auto& column : columns_) {
+        serialization::write_string(out, column.name);
+        // Variant alternatives are declared in Type order
+        serialization::write_pod<uint8_t>(out, static_cast<uint8_t>(column.values.index() + 1));
+        std::visit([&out](const auto& values) { encode_column(out, values); }, column.values);
+    }
+}
+
+ColumnTable ColumnTable::read(std::istream& in) {
+    if (serialization::read_pod<uint32_t>(in) != kColumnarMagic ||
+        serialization::read_pod<uint32_t>(in) != kColumnarVersion) {
+        throw std::runtime_error("Not a columnar table (or unsupported version).");
+    }
+    ColumnTable table(serialization::read_pod<uint64_t>(in));
+    uint32_t num_columns = serialization::read_pod<uint32_t>(in);
+    for (uint32_t i = 0; i < num_columns; ++i) {
+        std::string name = serialization::read_string(in);
+        Type type = static_cast<Type>(serialization::read_pod<uint8_t>(in));
+        Encoding encoding = serialization::read_pod<Encoding>(in);
+        serialization::read_pod<uint64_t>(in); // payload size, only needed to skip columns
+        switch (type) {
+            case Type::Int32: table.add_column(name, decode_column<int32_t>(in, encoding, table.num_rows_)); break;
+            case Type::Float32: table.add_column(name, decode_column<float>(in, encoding, table.num_rows_)); break;
+            case Type::Float64: table.add_column(name, decode_column<double>(in, encoding, table.num_rows_)); break;
+            case Type::String: table.add_column(name, decode_column<std::string>(in, encoding, table.num_rows_)); break;
+            default: throw std::runtime_error("Unknown column type in column " + name);
+        }
+    }
+    return table;
+}
+
+bool ColumnTable::write_file(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing." << std::endl;
+        return false;
+    }
+    write(file);
+    if (!file) {
+        std::cerr << "Error: Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ColumnTable ColumnTable::read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    return read(file);
+}
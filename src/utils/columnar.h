@@ -0,0 +1,64 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Typed column table with a simple self-describing binary encoding, used for the .fcol metric
+// exports and for metric rows in checkpoints. Each column is encoded independently with
+// whichever of PLAIN, RLE or DICT is smallest for its data.
+//
+// File layout (host byte order, i.e. little-endian on every supported platform):
+//   u32 magic "FCOL", u32 version, u64 num_rows, u32 num_columns, then per column:
+//     u32 name_length, name bytes, u8 type, u8 encoding, u64 payload_size, payload
+//   types:     1 = int32, 2 = float32, 3 = float64, 4 = string (u32 length + bytes)
+//   encodings: 0 PLAIN  num_rows values
+//              1 RLE    u32 num_runs, then per run: u32 run_length, value
+//              2 DICT   u32 dict_size, dict values, u8 index_width (1, 2 or 4),
+//                       num_rows unsigned indices of that width
+// payload_size lets readers skip columns they do not need.
+class ColumnTable {
+public:
+    enum class Type : uint8_t { Int32 = 1, Float32 = 2, Float64 = 3, String = 4 };
+
+    using Values = std::variant<std::vector<int32_t>, std::vector<float>, std::vector<double>, std::vector<std::string>>;
+
+    explicit ColumnTable(uint64_t num_rows = 0) : num_rows_(num_rows) {}
+
+    uint64_t num_rows() const { return num_rows_; }
+
+    // Columns must have num_rows() values; throws std::invalid_argument otherwise
+    void add_column(const std::string& name, Values values);
+
+    bool has_column(const std::string& name) const;
+
+    // Throws std::runtime_error if the column is missing or has a different type
+    const std::vector<int32_t>& int32_column(const std::string& name) const;
+    const std::vector<float>& float32_column(const std::string& name) const;
+    const std::vector<double>& float64_column(const std::string& name) const;
+    const std::vector<std::string>& string_column(const std::string& name) const;
+
+    void write(std::ostream& out) const;
+    static ColumnTable read(std::istream& in);
+
+    // Convenience wrappers; write_file returns false (with a warning) on I/O errors
+    bool write_file(const std::string& path) const;
+    static ColumnTable read_file(const std::string& path);
+
+private:
+    struct Column {
+        std::string name;
+        Values values;
+    };
+
+    uint64_t num_rows_;
+    std::vector<Column> columns_;
+
+    const Values& find(const std::string& name) const;
+};
+
+#endif // COLUMNAR_H
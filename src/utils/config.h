@@ -9,8 +9,27 @@ struct Config {
     std::string output_dir;
     std::string yolo_model_path; // Consolidated model path
     float confidence_threshold;
+    int batch_size; // Maximum crops per TensorRT inference
+    std::string tiling; // "off", "full" or "ball"
+    int tile_size; // Tile size in source pixels
+    float tile_overlap; // Fraction of a tile shared with its neighbours
+    int ball_roi_size; // Crop around the predicted ball in ball tiling, in source pixels
+    float ball_roi_confidence; // Ball tiling searches all tiles below this tracking confidence
     bool track_ball;
     int frame_skip_interval; // New member for frame skipping
+    int keyframe_interval; // Frames per detector run; tracks are propagated with optical flow in between
+    int checkpoint_interval; // Frames between checkpoints, 0 disables
+    bool resume; // Resume from output_dir/checkpoint.bin if present
+    std::string trace_path; // Chrome trace output, empty disables tracing
+    std::string dump_detections_path; // Binary detection dump output, empty disables
+    std::string replay_detections_path; // Replay detections from this dump instead of running the detector
+    float heatmap_cell_size; // Heatmap grid resolution in meters
+    float ball_latency_seconds; // Ball trajectory refinement look-ahead, 0 disables
+    int pitch_control_interval; // Frames between pitch control evaluations, 0 disables
+    std::string pitch_control_model; // "voronoi" or "time-to-intercept"
+    float pitch_control_cell_size; // Pitch control grid resolution in meters
+    bool pitch_control_grids; // Write each pitch control surface as a PNG
+    std::string csv_precision; // "N" for all float CSV columns or "column=N,..." per column; empty keeps 6
 };
 
 #endif // CONFIG_H
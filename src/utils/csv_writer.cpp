@@ -0,0 +1,23 @@
+#include "utils/csv_writer.h"
+
+CsvWriter::CsvWriter(const std::string& path, size_t buffer_bytes)
+    : out_(path, std::ios::binary | std::ios::trunc), buffer_(buffer_bytes) {}
+
+CsvWriter::~CsvWriter() {
+    if (out_.is_open()) {
+        close();
+    }
+}
+
+void CsvWriter::flush() {
+    if (used_ > 0) {
+        out_.write(buffer_.data(), used_);
+        used_ = 0;
+    }
+}
+
+bool CsvWriter::close() {
+    flush();
+    out_.close();
+    return !out_.fail();
+}
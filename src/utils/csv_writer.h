@@ -0,0 +1,81 @@
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Buffered CSV writer for large exports. Numbers are formatted with std::to_chars (no locale,
+// no allocation) straight into a reusable buffer that is handed to the stream in one write per
+// block. Fixed-precision output matches std::to_string / printf("%.*f").
+class CsvWriter {
+public:
+    explicit CsvWriter(const std::string& path, size_t buffer_bytes = 1 << 20);
+    ~CsvWriter();
+
+    bool is_open() const { return out_.is_open(); }
+
+    void field(long long value) {
+        separator();
+        reserve(24);
+        used_ = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value).ptr - buffer_.data();
+    }
+
+    void field(int value) { field(static_cast<long long>(value)); }
+
+    // Fixed notation with `precision` decimals
+    void field(double value, int precision) {
+        separator();
+        // Fixed notation of large magnitudes can need ~310 digits before the point
+        reserve(static_cast<size_t>(precision) + 330);
+        used_ = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value,
+                              std::chars_format::fixed, precision).ptr - buffer_.data();
+    }
+
+    // Written verbatim: callers are responsible for quoting text that may contain separators
+    void field(std::string_view text) {
+        separator();
+        reserve(text.size());
+        std::memcpy(buffer_.data() + used_, text.data(), text.size());
+        used_ += text.size();
+    }
+
+    void end_row() {
+        reserve(1);
+        buffer_[used_++] = '\n';
+        row_start_ = true;
+    }
+
+    // Flushes and closes the file; returns false if any write failed
+    bool close();
+
+private:
+    std::ofstream out_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    bool row_start_ = true;
+
+    void separator() {
+        if (!row_start_) {
+            reserve(1);
+            buffer_[used_++] = ',';
+        }
+        row_start_ = false;
+    }
+
+    void reserve(size_t bytes) {
+        if (buffer_.size() - used_ < bytes) {
+            flush();
+            if (buffer_.size() < bytes) {
+                buffer_.resize(bytes);
+            }
+        }
+    }
+
+    void flush();
+};
+
+#endif // CSV_WRITER_H
@@ -1,4 +1,5 @@
 #include "utils/kalman_filter.h"
+#include "utils/serialization.h"
 
 KalmanFilter::KalmanFilter() {
     // State: [x, y, vx, vy]'
@@ -56,3 +57,18 @@ cv::Point2f KalmanFilter::correct(const cv::Point2f& measurement) {
 cv::Point2f KalmanFilter::get_state() const {
     return cv::Point2f(kf_.statePost.at<float>(0), kf_.statePost.at<float>(1));
 }
+
+void KalmanFilter::save_state(std::ostream& out) const {
+    // The model matrices (F, H, Q, R) are constant and rebuilt by the constructor
+    serialization::write_mat(out, kf_.statePre);
+    serialization::write_mat(out, kf_.statePost);
+    serialization::write_mat(out, kf_.errorCovPre);
+    serialization::write_mat(out, kf_.errorCovPost);
+}
+
+void KalmanFilter::load_state(std::istream& in) {
+    kf_.statePre = serialization::read_mat(in);
+    kf_.statePost = serialization::read_mat(in);
+    kf_.errorCovPre = serialization::read_mat(in);
+    kf_.errorCovPost = serialization::read_mat(in);
+}
@@ -2,6 +2,8 @@
 #define KALMAN_FILTER_H
 
 #include <opencv2/opencv.hpp>
+#include <istream>
+#include <ostream>
 
 class KalmanFilter {
 public:
@@ -19,6 +21,10 @@ public:
     // Get the current state (position) from the Kalman filter
     cv::Point2f get_state() const;
 
+    // Checkpoint support: persist / restore the filter state and covariances
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
 private:
     cv::KalmanFilter kf_;
     cv::Mat state_;       // [x, y, vx, vy]
@@ -0,0 +1,121 @@
+#include "utils/profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::Decode: return "decode";
+        case Stage::Preprocess: return "preprocess";
+        case Stage::Inference: return "inference";
+        case Stage::Postprocess: return "postprocess";
+        case Stage::PlayerTracking: return "player_tracking";
+        case Stage::BallTracking: return "ball_tracking";
+        case Stage::Calibration: return "calibration";
+        case Stage::Metrics: return "metrics";
+        default: return "unknown";
+    }
+}
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0) {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n > 0 ? static_cast<double>(sum()) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::bucket_midpoint(int index) {
+    if (index < kSubBuckets) {
+        return static_cast<uint64_t>(index);
+    }
+    int exponent = (index - kSubBuckets) / kSubBuckets + kSubBucketBits;
+    int sub_bucket = (index - kSubBuckets) % kSubBuckets;
+    int shift = exponent - kSubBucketBits;
+    uint64_t lower = static_cast<uint64_t>(kSubBuckets + sub_bucket) << shift;
+    return lower + ((1ULL << shift) >> 1);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    uint64_t total = 0;
+    std::array<uint64_t, kNumBuckets> snapshot;
+    for (int i = 0; i < kNumBuckets; ++i) {
+        snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+        seen += snapshot[i];
+        if (seen >= rank) {
+            // The midpoint can overshoot the largest recorded value in the top bucket
+            return std::min(bucket_midpoint(i), max());
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::merge_into(LatencyHistogram& target) const {
+    for (int i = 0; i < kNumBuckets; ++i) {
+        bump(target.buckets_[i], buckets_[i].load(std::memory_order_relaxed));
+    }
+    bump(target.count_, count());
+    bump(target.sum_, sum());
+    if (max() > target.max()) {
+        target.max_.store(max(), std::memory_order_relaxed);
+    }
+}
+
+StageProfiler::StageProfiler() : frames_(0), start_time_(std::chrono::steady_clock::now()) {}
+
+double StageProfiler::frames_per_second() const {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    return elapsed > 0.0 ? frames() / elapsed : 0.0;
+}
+
+void StageProfiler::merge_into(StageProfiler& target) const {
+    for (size_t i = 0; i < histograms_.size(); ++i) {
+        histograms_[i].merge_into(target.histograms_[i]);
+    }
+    target.frames_.store(target.frames() + frames(), std::memory_order_relaxed);
+}
+
+std::string StageProfiler::format_report() const {
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+    report << "Processed " << frames() << " frames at " << std::setprecision(2) << frames_per_second()
+           << " frames/s" << std::setprecision(3) << "\n";
+
+    uint64_t grand_total = 0;
+    for (const auto& histogram : histograms_) {
+        grand_total += histogram.sum();
+    }
+
+    report << std::left << std::setw(16) << "stage" << std::right
+           << std::setw(10) << "count" << std::setw(11) << "mean_ms" << std::setw(11) << "p50_ms"
+           << std::setw(11) << "p90_ms" << std::setw(11) << "p99_ms" << std::setw(11) << "max_ms"
+           << std::setw(9) << "share" << "\n";
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        const LatencyHistogram& histogram = histograms_[i];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        double share = grand_total > 0 ? 100.0 * histogram.sum() / grand_total : 0.0;
+        report << std::left << std::setw(16) << stage_name(static_cast<Stage>(i)) << std::right
+               << std::setw(10) << histogram.count()
+               << std::setw(11) << histogram.mean() / 1e6
+               << std::setw(11) << histogram.percentile(0.50) / 1e6
+               << std::setw(11) << histogram.percentile(0.90) / 1e6
+               << std::setw(11) << histogram.percentile(0.99) / 1e6
+               << std::setw(11) << histogram.max() / 1e6
+               << std::setw(8) << std::setprecision(1) << share << "%" << std::setprecision(3) << "\n";
+    }
+    return report.str();
+}
@@ -0,0 +1,156 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "utils/trace.h"
+
+// Pipeline stages timed by the stage profiler
+enum class Stage : int {
+    Decode,
+    Preprocess,
+    Inference,
+    Postprocess,
+    PlayerTracking,
+    BallTracking,
+    Calibration,
+    Metrics,
+    Count
+};
+
+const char* stage_name(Stage stage);
+
+// Log-linear (HDR-style) latency histogram in nanoseconds: 16 linear sub-buckets per power of two,
+// i.e. <= 6.25% relative error over 1ns..~18min. Recording is single-writer and lock-free
+// (relaxed loads/stores, no read-modify-write); readers may snapshot concurrently.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds) {
+        bump(buckets_[bucket_index(nanoseconds)], 1);
+        bump(count_, 1);
+        bump(sum_, nanoseconds);
+        if (nanoseconds > max_.load(std::memory_order_relaxed)) {
+            max_.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    // Approximate value at quantile q in [0, 1]
+    uint64_t percentile(double q) const;
+
+    // Adds this histogram's counts to `target` (target must not be concurrently recorded into)
+    void merge_into(LatencyHistogram& target) const;
+
+private:
+    static const int kSubBucketBits = 4;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kMaxExponent = 40;
+    static const int kNumBuckets = kSubBuckets + (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    static int bucket_index(uint64_t value) {
+        if (value < static_cast<uint64_t>(kSubBuckets)) {
+            return static_cast<int>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        if (exponent > kMaxExponent) {
+            return kNumBuckets - 1;
+        }
+        int sub_bucket = static_cast<int>(value >> (exponent - kSubBucketBits)) - kSubBuckets;
+        return kSubBuckets + (exponent - kSubBucketBits) * kSubBuckets + sub_bucket;
+    }
+
+    static uint64_t bucket_midpoint(int index);
+};
+
+// Per-job stage timings plus a frame counter for throughput. Owned by the thread running the
+// job's processing loop, which is the only writer. Optionally forwards every timed stage to a
+// TraceRecorder, tagged with the frame currently being processed.
+class StageProfiler {
+public:
+    StageProfiler();
+
+    LatencyHistogram& histogram(Stage stage) { return histograms_[static_cast<int>(stage)]; }
+    const LatencyHistogram& histogram(Stage stage) const { return histograms_[static_cast<int>(stage)]; }
+
+    void record_frame() { frames_.store(frames_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+    uint64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+
+    // Frames per second of wall time since construction
+    double frames_per_second() const;
+
+    void merge_into(StageProfiler& target) const;
+
+    void set_tracer(TraceRecorder* tracer) { tracer_ = tracer; }
+    TraceRecorder* tracer() const { return tracer_; }
+    void set_current_frame(int frame) { current_frame_ = frame; }
+    int current_frame() const { return current_frame_; }
+
+    // Human-readable table of per-stage latencies and throughput
+    std::string format_report() const;
+
+private:
+    std::array<LatencyHistogram, static_cast<int>(Stage::Count)> histograms_;
+    std::atomic<uint64_t> frames_;
+    std::chrono::steady_clock::time_point start_time_;
+    TraceRecorder* tracer_ = nullptr;
+    int current_frame_ = 0;
+};
+
+// Times the enclosing scope into `profiler` (no-op when profiler is null)
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(StageProfiler* profiler, Stage stage) : profiler_(profiler), stage_(stage) {
+        if (profiler_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedStageTimer() {
+        if (profiler_) {
+            auto end = std::chrono::steady_clock::now();
+            profiler_->histogram(stage_).record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+            if (TraceRecorder* tracer = profiler_->tracer()) {
+                tracer->record(stage_, profiler_->current_frame(), start_, end);
+            }
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    StageProfiler* profiler_;
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Instrumentation is compiled in with -DENABLE_STAGE_PROFILING (CMake option of the same name);
+// without it PROFILE_STAGE expands to nothing.
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#ifdef ENABLE_STAGE_PROFILING
+#define PROFILE_STAGE(profiler, stage) ScopedStageTimer PROFILER_CONCAT(stage_timer_, __LINE__)(profiler, stage)
+#else
+#define PROFILE_STAGE(profiler, stage) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,279 @@
+#include "utils/result_cache.h"
+#include "utils/serialization.h"
+#include "yaml-cpp/yaml.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump whenever the pipeline changes in a way that alters the CSV outputs
+// (detector post-processing thresholds, tracker parameters, CSV schema, ...)
+const char* kCacheFormatVersion = "analysis-cache-v10";
+
+// Large files (video, model) are hashed from their size plus evenly spaced samples
+const int kNumSamples = 16;
+const std::streamsize kSampleBytes = 64 * 1024;
+
+using serialization::fnv1a;
+
+// Every output an entry can hold, under its file name in the entry directory
+struct Artifact {
+    std::string CachedResult::*path;
+    const char* name;
+    bool required;
+};
+
+const Artifact kArtifacts[] = {
+    {&CachedResult::player_metrics_csv_path, "player_metrics.csv", true},
+    {&CachedResult::ball_metrics_csv_path, "ball_metrics.csv", false},
+    {&CachedResult::player_metrics_columnar_path, "player_metrics.fcol", false},
+    {&CachedResult::ball_metrics_columnar_path, "ball_metrics.fcol", false},
+    {&CachedResult::player_summary_csv_path, "player_summary.csv", true},
+    {&CachedResult::player_events_csv_path, "player_events.csv", false},
+    {&CachedResult::heatmaps_path, "heatmaps.fcol", false},
+    {&CachedResult::heatmap_image_dir, "heatmaps", false},
+    {&CachedResult::possession_spells_csv_path, "possession_spells.csv", false},
+    {&CachedResult::team_possession_csv_path, "team_possession.csv", false},
+    {&CachedResult::passes_csv_path, "passes.csv", false},
+    {&CachedResult::pitch_control_csv_path, "pitch_control.csv", false},
+    {&CachedResult::pitch_control_grid_dir, "pitch_control", false},
+    {&CachedResult::team_shape_csv_path, "team_shape.csv", false},
+    {&CachedResult::team_shape_columnar_path, "team_shape.fcol", false},
+    {&CachedResult::offsides_csv_path, "offsides.csv", false},
+};
+
+// Replaces `dst` with a copy of the file or directory `src`
+bool copy_artifact(const fs::path& src, const fs::path& dst, std::error_code& ec) {
+    fs::remove_all(dst, ec);
+    fs::copy(src, dst, fs::copy_options::overwrite_existing | fs::copy_options::recursive, ec);
+    return !ec;
+}
+
+bool hash_sampled_file(uint64_t& hash, const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    fnv1a(hash, &size, sizeof(size));
+
+    std::vector<char> buffer(kSampleBytes);
+    if (size <= static_cast<uint64_t>(kNumSamples * kSampleBytes)) {
+        file.seekg(0, std::ios::beg);
+        while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+            fnv1a(hash, buffer.data(), file.gcount());
+        }
+        return true;
+    }
+
+    // First and last sample are always included so headers and trailers (moov atoms) are covered
+    uint64_t stride = (size - kSampleBytes) / (kNumSamples - 1);
+    for (int i = 0; i < kNumSamples; ++i) {
+        file.seekg(static_cast<std::streamoff>(i * stride), std::ios::beg);
+        file.read(buffer.data(), buffer.size());
+        fnv1a(hash, buffer.data(), file.gcount());
+    }
+    return true;
+}
+
+uintmax_t directory_size(const fs::path& dir) {
+    uintmax_t total = 0;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file(ec)) {
+            total += entry.file_size(ec);
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+ResultCache::ResultCache(const std::string& cache_dir, std::uintmax_t max_bytes)
+    : cache_dir_(cache_dir), max_bytes_(max_bytes) {
+    std::error_code ec;
+    fs::create_directories(cache_dir_, ec);
+    if (ec) {
+        std::cerr << "Warning: Could not create result cache directory " << cache_dir_ << ": " << ec.message() << std::endl;
+    }
+}
+
+std::string ResultCache::make_key(const std::string& video_path, const std::string& model_path,
+                                  const std::string& calibration_path, float confidence_threshold,
+                                  const std::string& options) const {
+    uint64_t hash = serialization::kFnvOffsetBasis;
+    fnv1a(hash, kCacheFormatVersion, std::strlen(kCacheFormatVersion));
+
+    if (!hash_sampled_file(hash, video_path)) {
+        return "";
+    }
+
+    // A missing model or calibration still yields a stable key: the analysis itself will fail or
+    // fall back to defaults, and that outcome is what gets cached (or not) downstream.
+    fnv1a(hash, model_path.data(), model_path.size());
+    hash_sampled_file(hash, model_path);
+    hash_sampled_file(hash, calibration_path);
+    fnv1a(hash, &confidence_threshold, sizeof(confidence_threshold));
+    fnv1a(hash, options.data(), options.size());
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+bool ResultCache::lookup(const std::string& key, const std::string& output_dir, CachedResult& result) {
+    if (key.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    fs::path entry_dir = fs::path(cache_dir_) / key;
+    fs::path meta_path = entry_dir / "meta.yaml";
+    std::error_code ec;
+    if (!fs::exists(meta_path, ec)) {
+        return false;
+    }
+
+    std::vector<std::string> stored;
+    try {
+        YAML::Node meta = YAML::LoadFile(meta_path.string());
+        result.total_frames = meta["total_frames"].as<int>();
+        result.players_tracked = meta["players_tracked"].as<int>();
+        stored = meta["artifacts"].as<std::vector<std::string>>();
+    } catch (const YAML::Exception& e) {
+        std::cerr << "Warning: Discarding corrupt cache entry " << key << ": " << e.what() << std::endl;
+        fs::remove_all(entry_dir, ec);
+        return false;
+    }
+
+    // Serve copies in the job's output directory, as a fresh analysis would have left them
+    fs::create_directories(output_dir, ec);
+    for (const Artifact& artifact : kArtifacts) {
+        (result.*artifact.path).clear();
+        if (std::find(stored.begin(), stored.end(), artifact.name) == stored.end()) {
+            continue;
+        }
+        fs::path dst = fs::path(output_dir) / artifact.name;
+        if (!copy_artifact(entry_dir / artifact.name, dst, ec)) {
+            std::cerr << "Warning: Could not copy cached " << artifact.name << " to " << output_dir << ": "
+                      << ec.message() << std::endl;
+            return false;
+        }
+        result.*artifact.path = dst.string();
+    }
+
+    // Refresh the LRU timestamp
+    fs::last_write_time(meta_path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+bool ResultCache::store(const std::string& key, const CachedResult& result) {
+    if (key.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    fs::path entry_dir = fs::path(cache_dir_) / key;
+    fs::path staging_dir = fs::path(cache_dir_) / (key + ".tmp." + std::to_string(getpid()));
+    std::error_code ec;
+    fs::remove_all(staging_dir, ec);
+    fs::create_directories(staging_dir, ec);
+    if (ec) {
+        std::cerr << "Warning: Could not create cache entry " << staging_dir << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> stored;
+    for (const Artifact& artifact : kArtifacts) {
+        const std::string& src = result.*artifact.path;
+        if (src.empty() || !fs::exists(src, ec)) {
+            if (artifact.required) {
+                std::cerr << "Warning: Not caching " << key << ": " << artifact.name << " is missing" << std::endl;
+                fs::remove_all(staging_dir, ec);
+                return false;
+            }
+            continue;
+        }
+        // Directories (heatmap images) are copied with their contents
+        if (!copy_artifact(src, staging_dir / artifact.name, ec)) {
+            std::cerr << "Warning: Could not copy " << src << " into result cache: " << ec.message() << std::endl;
+            fs::remove_all(staging_dir, ec);
+            return false;
+        }
+        stored.push_back(artifact.name);
+    }
+
+    // meta.yaml is written last so an entry without it is never considered valid
+    YAML::Emitter meta;
+    meta << YAML::BeginMap;
+    meta << YAML::Key << "total_frames" << YAML::Value << result.total_frames;
+    meta << YAML::Key << "players_tracked" << YAML::Value << result.players_tracked;
+    meta << YAML::Key << "artifacts" << YAML::Value << stored;
+    meta << YAML::EndMap;
+    std::ofstream meta_file(staging_dir / "meta.yaml");
+    meta_file << meta.c_str() << std::endl;
+    meta_file.close();
+
+    // Publish atomically; a concurrent writer of the same key may have won the race
+    fs::remove_all(entry_dir, ec);
+    fs::rename(staging_dir, entry_dir, ec);
+    if (ec) {
+        fs::remove_all(staging_dir, ec);
+        return false;
+    }
+
+    evict(key);
+    return true;
+}
+
+void ResultCache::evict(const std::string& keep_key) {
+    struct Entry {
+        fs::path dir;
+        fs::file_time_type last_used;
+        uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    for (const auto& item : fs::directory_iterator(cache_dir_, ec)) {
+        fs::path meta_path = item.path() / "meta.yaml";
+        if (!item.is_directory(ec) || !fs::exists(meta_path, ec)) {
+            continue; // staging directories of in-flight stores
+        }
+        Entry entry{item.path(), fs::last_write_time(meta_path, ec), directory_size(item.path())};
+        total += entry.size;
+        entries.push_back(entry);
+    }
+
+    if (total <= max_bytes_) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.last_used < b.last_used;
+    });
+
+    for (const auto& entry : entries) {
+        if (total <= max_bytes_) {
+            break;
+        }
+        if (entry.dir.filename() == keep_key) {
+            continue;
+        }
+        fs::remove_all(entry.dir, ec);
+        if (!ec) {
+            total -= entry.size;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Outputs of a completed analysis, as stored in (or served from) the cache. An empty path means
+// the analysis did not produce that output.
+struct CachedResult {
+    std::string player_metrics_csv_path;
+    std::string ball_metrics_csv_path;
+    std::string player_metrics_columnar_path;
+    std::string ball_metrics_columnar_path;
+    std::string player_summary_csv_path;
+    std::string player_events_csv_path;
+    std::string heatmaps_path;
+    std::string heatmap_image_dir;
+    std::string possession_spells_csv_path;
+    std::string team_possession_csv_path;
+    std::string passes_csv_path;
+    std::string pitch_control_csv_path;
+    std::string pitch_control_grid_dir;
+    std::string team_shape_csv_path;
+    std::string team_shape_columnar_path;
+    std::string offsides_csv_path;
+    int total_frames = 0;
+    int players_tracked = 0;
+};
+
+// Persistent on-disk cache of analysis outputs keyed by a content hash of the inputs.
+// Each entry is a directory <cache_dir>/<key>/ holding the CSV, columnar and heatmap outputs and a meta.yaml
+// listing the outputs actually stored; the mtime of meta.yaml is the LRU timestamp and is refreshed on every hit.
+class ResultCache {
+public:
+    ResultCache(const std::string& cache_dir, std::uintmax_t max_bytes);
+
+    // Hash of sampled video content, model file, calibration file, thresholds and any other job
+    // options that change the outputs. Returns an empty string if the video cannot be read.
+    std::string make_key(const std::string& video_path, const std::string& model_path,
+                         const std::string& calibration_path, float confidence_threshold,
+                         const std::string& options = "") const;
+
+    // On a hit copies the entry's outputs into `output_dir`, fills `result` with their paths there
+    // (empty for outputs the entry does not have) and marks the entry as recently used. The copy
+    // happens under the cache lock, so a concurrent eviction cannot remove files mid-copy.
+    bool lookup(const std::string& key, const std::string& output_dir, CachedResult& result);
+
+    // Copies the outputs referenced by `result` into the cache and evicts old entries over the size
+    // limit. Fails without publishing an entry if player_metrics.csv or player_summary.csv is missing.
+    bool store(const std::string& key, const CachedResult& result);
+
+private:
+    std::string cache_dir_;
+    std::uintmax_t max_bytes_;
+    std::mutex mutex_;
+
+    void evict(const std::string& keep_key);
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,105 @@
+#include "utils/savgol_filter.h"
+#include "utils/serialization.h"
+#include <cmath>
+#include <stdexcept>
+
+SavitzkyGolayFilter::Estimate SavitzkyGolayFilter::update(double t, const cv::Point2f& position) {
+    times_[head_] = t;
+    positions_[head_] = position;
+    head_ = (head_ + 1) % kWindow;
+    if (size_ < kWindow) {
+        ++size_;
+    }
+
+    Estimate estimate{position, cv::Point2f(0.0f, 0.0f), cv::Point2f(0.0f, 0.0f)};
+    if (size_ < 2) {
+        return estimate;
+    }
+
+    // Sums of tau^k and tau^k * value with tau = sample time relative to the newest sample, which
+    // keeps the normal equations well conditioned and puts the evaluation point at tau = 0
+    double s[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    double bx[3] = {0.0, 0.0, 0.0};
+    double by[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < size_; ++i) {
+        int index = (head_ - 1 - i + kWindow) % kWindow;
+        double tau = times_[index] - t;
+        double power = 1.0;
+        for (int k = 0; k < 5; ++k) {
+            s[k] += power;
+            if (k < 3) {
+                bx[k] += power * positions_[index].x;
+                by[k] += power * positions_[index].y;
+            }
+            power *= tau;
+        }
+    }
+
+    if (size_ < kMinQuadraticSamples) {
+        // Least-squares line
+        double det = s[0] * s[2] - s[1] * s[1];
+        if (std::abs(det) < 1e-12) {
+            return estimate;
+        }
+        estimate.position.x = static_cast<float>((bx[0] * s[2] - s[1] * bx[1]) / det);
+        estimate.position.y = static_cast<float>((by[0] * s[2] - s[1] * by[1]) / det);
+        estimate.velocity.x = static_cast<float>((s[0] * bx[1] - s[1] * bx[0]) / det);
+        estimate.velocity.y = static_cast<float>((s[0] * by[1] - s[1] * by[0]) / det);
+        return estimate;
+    }
+
+    // Quadratic fit c0 + c1*tau + c2*tau^2: solve the 3x3 normal equations by Cramer's rule
+    const double a[3][3] = {{s[0], s[1], s[2]}, {s[1], s[2], s[3]}, {s[2], s[3], s[4]}};
+    auto det3 = [](const double m[3][3]) {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+               m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    };
+    double det = det3(a);
+    if (std::abs(det) < 1e-18) {
+        return estimate;
+    }
+    auto solve = [&](const double b[3], double c[3]) {
+        for (int col = 0; col < 3; ++col) {
+            double m[3][3];
+            for (int r = 0; r < 3; ++r) {
+                for (int k = 0; k < 3; ++k) {
+                    m[r][k] = k == col ? b[r] : a[r][k];
+                }
+            }
+            c[col] = det3(m) / det;
+        }
+    };
+    double cx[3], cy[3];
+    solve(bx, cx);
+    solve(by, cy);
+    estimate.position = cv::Point2f(static_cast<float>(cx[0]), static_cast<float>(cy[0]));
+    estimate.velocity = cv::Point2f(static_cast<float>(cx[1]), static_cast<float>(cy[1]));
+    estimate.acceleration = cv::Point2f(static_cast<float>(2.0 * cx[2]), static_cast<float>(2.0 * cy[2]));
+    return estimate;
+}
+
+void SavitzkyGolayFilter::save_state(std::ostream& out) const {
+    // Oldest sample first, so the layout does not depend on the ring position
+    serialization::write_pod<int32_t>(out, size_);
+    for (int i = size_ - 1; i >= 0; --i) {
+        int index = (head_ - 1 - i + kWindow) % kWindow;
+        serialization::write_pod(out, times_[index]);
+        serialization::write_point(out, positions_[index]);
+    }
+}
+
+void SavitzkyGolayFilter::load_state(std::istream& in) {
+    int size = serialization::read_pod<int32_t>(in);
+    if (size < 0 || size > kWindow) {
+        throw std::runtime_error("Corrupt Savitzky-Golay filter state.");
+    }
+    head_ = 0;
+    size_ = 0;
+    for (int i = 0; i < size; ++i) {
+        times_[head_] = serialization::read_pod<double>(in);
+        positions_[head_] = serialization::read_point(in);
+        head_ = (head_ + 1) % kWindow;
+        ++size_;
+    }
+}
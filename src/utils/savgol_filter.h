@@ -0,0 +1,47 @@
+#ifndef SAVGOL_FILTER_H
+#define SAVGOL_FILTER_H
+
+#include <array>
+#include <istream>
+#include <ostream>
+#include <opencv2/opencv.hpp>
+
+// Streaming Savitzky-Golay smoother for one 2D track. Keeps the last kWindow samples in a ring
+// buffer and fits a quadratic per axis by least squares, evaluated at the newest sample. The fit
+// uses the actual sample times, so skipped frames and short detection gaps are handled without
+// resampling. Memory is fixed per track.
+class SavitzkyGolayFilter {
+public:
+    // About one second of video; shorter windows leave too much jitter in the endpoint derivatives
+    static const int kWindow = 25;
+    // Below about half a window the curvature is mostly noise, so a line is fitted instead
+    static const int kMinQuadraticSamples = 13;
+
+    struct Estimate {
+        cv::Point2f position;
+        cv::Point2f velocity;     // units per second
+        cv::Point2f acceleration; // units per second squared
+    };
+
+    // Adds a sample at time `t` (seconds, strictly increasing) and returns the smoothed estimate.
+    // With fewer than kMinQuadraticSamples samples the fit degrades to a line (acceleration zero),
+    // and a single sample is returned as is.
+    Estimate update(double t, const cv::Point2f& position);
+
+    // Drops the history, e.g. after a long gap where the old samples no longer describe the motion
+    void reset() { size_ = 0; }
+
+    int size() const { return size_; }
+
+    // Checkpoint support
+    void save_state(std::ostream& out) const;
+    void load_state(std::istream& in);
+
+private:
+    std::array<double, kWindow> times_{};
+    std::array<cv::Point2f, kWindow> positions_{};
+    int head_ = 0; // index of the next write
+    int size_ = 0;
+};
+
+#endif // SAVGOL_FILTER_H
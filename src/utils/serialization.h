@@ -0,0 +1,121 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <opencv2/opencv.hpp>
+
+// Minimal binary (de)serialization helpers used for checkpoints.
+// Values are written in host byte order; readers throw std::runtime_error on truncated input.
+namespace serialization {
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+// Incremental 64-bit FNV-1a, used for cache keys and checkpoint checksums
+inline void fnv1a(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+}
+
+template <typename T>
+void write_pod(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "write_pod requires a trivially copyable type");
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read_pod(std::istream& in) {
+    static_assert(std::is_trivially_copyable<T>::value, "read_pod requires a trivially copyable type");
+    T value;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Unexpected end of serialized data.");
+    }
+    return value;
+}
+
+inline void write_string(std::ostream& out, const std::string& value) {
+    write_pod<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out.write(value.data(), value.size());
+}
+
+inline std::string read_string(std::istream& in) {
+    uint32_t size = read_pod<uint32_t>(in);
+    std::string value(size, '\0');
+    if (size > 0 && !in.read(&value[0], size)) {
+        throw std::runtime_error("Unexpected end of serialized data.");
+    }
+    return value;
+}
+
+// OpenCV value types are written field by field: their trivially-copyable status varies across versions
+inline void write_point(std::ostream& out, const cv::Point2f& point) {
+    write_pod(out, point.x);
+    write_pod(out, point.y);
+}
+
+inline cv::Point2f read_point(std::istream& in) {
+    float x = read_pod<float>(in);
+    float y = read_pod<float>(in);
+    return cv::Point2f(x, y);
+}
+
+inline void write_rect(std::ostream& out, const cv::Rect2f& rect) {
+    write_pod(out, rect.x);
+    write_pod(out, rect.y);
+    write_pod(out, rect.width);
+    write_pod(out, rect.height);
+}
+
+inline cv::Rect2f read_rect(std::istream& in) {
+    cv::Rect2f rect;
+    rect.x = read_pod<float>(in);
+    rect.y = read_pod<float>(in);
+    rect.width = read_pod<float>(in);
+    rect.height = read_pod<float>(in);
+    return rect;
+}
+
+inline void write_scalar(std::ostream& out, const cv::Scalar& scalar) {
+    for (int i = 0; i < 4; ++i) {
+        write_pod(out, scalar[i]);
+    }
+}
+
+inline cv::Scalar read_scalar(std::istream& in) {
+    cv::Scalar scalar;
+    for (int i = 0; i < 4; ++i) {
+        scalar[i] = read_pod<double>(in);
+    }
+    return scalar;
+}
+
+inline void write_mat(std::ostream& out, const cv::Mat& mat) {
+    cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+    write_pod<int32_t>(out, continuous.rows);
+    write_pod<int32_t>(out, continuous.cols);
+    write_pod<int32_t>(out, continuous.type());
+    out.write(reinterpret_cast<const char*>(continuous.data), continuous.total() * continuous.elemSize());
+}
+
+inline cv::Mat read_mat(std::istream& in) {
+    int32_t rows = read_pod<int32_t>(in);
+    int32_t cols = read_pod<int32_t>(in);
+    int32_t type = read_pod<int32_t>(in);
+    cv::Mat mat(rows, cols, type);
+    if (!in.read(reinterpret_cast<char*>(mat.data), mat.total() * mat.elemSize())) {
+        throw std::runtime_error("Unexpected end of serialized data.");
+    }
+    return mat;
+}
+
+} // namespace serialization
+
+#endif // SERIALIZATION_H
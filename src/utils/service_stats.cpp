@@ -0,0 +1,109 @@
+#include "utils/service_stats.h"
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+// Resident set size from /proc/self/statm (second field, in pages)
+uint64_t resident_memory_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size_pages = 0, resident_pages = 0;
+    if (!(statm >> size_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+void write_metric(std::ostringstream& out, const char* name, const char* type, const char* help, double value) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+    out << name << " " << value << "\n";
+}
+
+} // namespace
+
+ServiceStats::ServiceStats() : start_time_(std::chrono::steady_clock::now()) {}
+
+void ServiceStats::record_cache_lookup(bool hit) {
+    (hit ? cache_hits_ : cache_misses_).fetch_add(1, std::memory_order_relaxed);
+}
+
+void ServiceStats::record_model_load(double seconds) {
+    model_loads_.fetch_add(1, std::memory_order_relaxed);
+    model_load_nanoseconds_.fetch_add(static_cast<uint64_t>(seconds * 1e9), std::memory_order_relaxed);
+}
+
+void ServiceStats::begin_job(bool streaming, const StageProfiler* profiler) {
+    jobs_started_.fetch_add(1, std::memory_order_relaxed);
+    (streaming ? active_streams_ : active_jobs_).fetch_add(1, std::memory_order_relaxed);
+    if (profiler) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_profilers_.insert(profiler);
+    }
+}
+
+void ServiceStats::end_job(bool streaming, const StageProfiler* profiler, bool success) {
+    (streaming ? active_streams_ : active_jobs_).fetch_sub(1, std::memory_order_relaxed);
+    (success ? jobs_completed_ : jobs_failed_).fetch_add(1, std::memory_order_relaxed);
+    if (profiler) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_profilers_.erase(profiler);
+        profiler->merge_into(finished_profiles_);
+    }
+}
+
+std::string ServiceStats::render_prometheus() const {
+    // Snapshot finished + running jobs; running profilers are read lock-free
+    auto totals = std::make_unique<StageProfiler>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_profiles_.merge_into(*totals);
+        for (const StageProfiler* profiler : active_profilers_) {
+            profiler->merge_into(*totals);
+        }
+    }
+
+    std::ostringstream out;
+    out.precision(15);
+    double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    write_metric(out, "analysis_uptime_seconds", "gauge", "Seconds since the service started.", uptime);
+    write_metric(out, "analysis_jobs_started_total", "counter", "Analysis jobs started (file and streaming).",
+                 jobs_started_.load(std::memory_order_relaxed));
+    write_metric(out, "analysis_jobs_completed_total", "counter", "Analysis jobs completed successfully.",
+                 jobs_completed_.load(std::memory_order_relaxed));
+    write_metric(out, "analysis_jobs_failed_total", "counter", "Analysis jobs that failed or were cancelled.",
+                 jobs_failed_.load(std::memory_order_relaxed));
+    write_metric(out, "analysis_active_jobs", "gauge", "AnalyzeVideo jobs currently running.",
+                 active_jobs_.load(std::memory_order_relaxed));
+    write_metric(out, "analysis_active_streams", "gauge", "StreamAnalysis sessions currently running.",
+                 active_streams_.load(std::memory_order_relaxed));
+    write_metric(out, "analysis_frames_processed_total", "counter", "Video frames run through the pipeline.",
+                 totals->frames());
+    write_metric(out, "analysis_result_cache_hits_total", "counter", "AnalyzeVideo requests served from the result cache.",
+                 cache_hits_.load(std::memory_order_relaxed));
+    write_metric(out, "analysis_result_cache_misses_total", "counter", "AnalyzeVideo requests not found in the result cache.",
+                 cache_misses_.load(std::memory_order_relaxed));
+    write_metric(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.",
+                 resident_memory_bytes());
+
+    out << "# HELP analysis_model_load_seconds Time to load or build the TensorRT engine.\n";
+    out << "# TYPE analysis_model_load_seconds summary\n";
+    out << "analysis_model_load_seconds_sum " << model_load_nanoseconds_.load(std::memory_order_relaxed) / 1e9 << "\n";
+    out << "analysis_model_load_seconds_count " << model_loads_.load(std::memory_order_relaxed) << "\n";
+
+    out << "# HELP analysis_stage_latency_seconds Per-frame latency of each pipeline stage.\n";
+    out << "# TYPE analysis_stage_latency_seconds summary\n";
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        const LatencyHistogram& histogram = totals->histogram(static_cast<Stage>(i));
+        const char* stage = stage_name(static_cast<Stage>(i));
+        for (double q : {0.5, 0.9, 0.99}) {
+            out << "analysis_stage_latency_seconds{stage=\"" << stage << "\",quantile=\"" << q << "\"} "
+                << histogram.percentile(q) / 1e9 << "\n";
+        }
+        out << "analysis_stage_latency_seconds_sum{stage=\"" << stage << "\"} " << histogram.sum() / 1e9 << "\n";
+        out << "analysis_stage_latency_seconds_count{stage=\"" << stage << "\"} " << histogram.count() << "\n";
+    }
+    return out.str();
+}
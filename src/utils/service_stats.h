@@ -0,0 +1,74 @@
+#ifndef SERVICE_STATS_H
+#define SERVICE_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include "utils/profiler.h"
+
+// Process-wide counters and gauges for the analysis service, rendered in the Prometheus text
+// exposition format. Hot-path updates are relaxed atomics; per-stage latencies are read from the
+// jobs' own StageProfilers at scrape time, so jobs never contend on a shared histogram.
+class ServiceStats {
+public:
+    ServiceStats();
+
+    void record_cache_lookup(bool hit);
+    void record_model_load(double seconds);
+
+    // Job lifetime tracking; `profiler` (may be null) is sampled by scrapes while registered
+    void begin_job(bool streaming, const StageProfiler* profiler);
+    void end_job(bool streaming, const StageProfiler* profiler, bool success);
+
+    std::string render_prometheus() const;
+
+private:
+    std::chrono::steady_clock::time_point start_time_;
+
+    std::atomic<uint64_t> jobs_started_{0};
+    std::atomic<uint64_t> jobs_completed_{0};
+    std::atomic<uint64_t> jobs_failed_{0};
+    std::atomic<int64_t> active_jobs_{0};
+    std::atomic<int64_t> active_streams_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> cache_misses_{0};
+    std::atomic<uint64_t> model_loads_{0};
+    std::atomic<uint64_t> model_load_nanoseconds_{0};
+
+    // Guards the profiler registry and the aggregate of finished jobs
+    mutable std::mutex mutex_;
+    std::set<const StageProfiler*> active_profilers_;
+    StageProfiler finished_profiles_;
+};
+
+// Marks a job as active for its scope; the job counts as failed unless mark_succeeded() is called
+class ActiveJobScope {
+public:
+    ActiveJobScope(ServiceStats* stats, bool streaming, const StageProfiler* profiler)
+        : stats_(stats), streaming_(streaming), profiler_(profiler) {
+        if (stats_) {
+            stats_->begin_job(streaming_, profiler_);
+        }
+    }
+
+    ~ActiveJobScope() {
+        if (stats_) {
+            stats_->end_job(streaming_, profiler_, succeeded_);
+        }
+    }
+
+    void mark_succeeded() { succeeded_ = true; }
+
+    ActiveJobScope(const ActiveJobScope&) = delete;
+    ActiveJobScope& operator=(const ActiveJobScope&) = delete;
+
+private:
+    ServiceStats* stats_;
+    bool streaming_;
+    const StageProfiler* profiler_;
+    bool succeeded_ = false;
+};
+
+#endif // SERVICE_STATS_H
@@ -0,0 +1,108 @@
+#include "utils/stats_server.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+void send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::string http_response(const char* status, const char* content_type, const std::string& body) {
+    return std::string("HTTP/1.0 ") + status + "\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+} // namespace
+
+StatsServer::StatsServer(int port, std::function<std::string()> render_metrics)
+    : render_metrics_(std::move(render_metrics)) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create stats server socket.");
+    }
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd_, 16) != 0) {
+        close(listen_fd_);
+        throw std::runtime_error("Failed to bind stats server to port " + std::to_string(port) + ".");
+    }
+
+    running_ = true;
+    thread_ = std::thread(&StatsServer::serve, this);
+}
+
+StatsServer::~StatsServer() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close(listen_fd_);
+}
+
+void StatsServer::serve() {
+    while (running_) {
+        // Poll with a timeout so the destructor can stop the thread
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int client_fd = accept(listen_fd_, nullptr, nullptr);
+        if (client_fd < 0) {
+            continue;
+        }
+        handle_connection(client_fd);
+        close(client_fd);
+    }
+}
+
+void StatsServer::handle_connection(int client_fd) {
+    timeval timeout{2, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters; read until it is complete
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string request_line = request.substr(0, request.find("\r\n"));
+    size_t path_start = request_line.find(' ');
+    size_t path_end = request_line.find(' ', path_start + 1);
+    std::string method = request_line.substr(0, path_start);
+    std::string path = path_start == std::string::npos ? "" : request_line.substr(path_start + 1, path_end - path_start - 1);
+
+    if (method != "GET") {
+        send_all(client_fd, http_response("405 Method Not Allowed", "text/plain", "method not allowed\n"));
+    } else if (path == "/metrics") {
+        send_all(client_fd, http_response("200 OK", "text/plain; version=0.0.4", render_metrics_()));
+    } else if (path == "/healthz") {
+        send_all(client_fd, http_response("200 OK", "text/plain", "ok\n"));
+    } else {
+        send_all(client_fd, http_response("404 Not Found", "text/plain", "not found\n"));
+    }
+}
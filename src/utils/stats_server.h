@@ -0,0 +1,30 @@
+#ifndef STATS_SERVER_H
+#define STATS_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Minimal HTTP/1.0 server for monitoring: GET /metrics returns the output of `render_metrics`
+// (Prometheus text format) and GET /healthz returns "ok". Requests are served sequentially on a
+// single background thread, which is plenty for periodic scrapes.
+class StatsServer {
+public:
+    StatsServer(int port, std::function<std::string()> render_metrics);
+    ~StatsServer();
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+private:
+    std::function<std::string()> render_metrics_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    void serve();
+    void handle_connection(int client_fd);
+};
+
+#endif // STATS_SERVER_H
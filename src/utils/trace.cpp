@@ -0,0 +1,78 @@
+#include "utils/trace.h"
+#include "utils/profiler.h"
+#include <cstdio>
+#include <iostream>
+
+std::atomic<uint64_t> TraceRecorder::next_id_{1};
+
+TraceRecorder::TraceRecorder(size_t events_per_thread)
+    : id_(next_id_.fetch_add(1)),
+      events_per_thread_(events_per_thread > 0 ? events_per_thread : 1),
+      origin_(std::chrono::steady_clock::now()) {}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::buffer_for_current_thread() {
+    // Cache the last used buffer per thread; recorders are told apart by a unique id rather than
+    // their address, which may be reused by a later recorder.
+    thread_local uint64_t cached_id = 0;
+    thread_local ThreadBuffer* cached_buffer = nullptr;
+    if (cached_id == id_) {
+        return *cached_buffer;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->thread_index = static_cast<int>(buffers_.size()) + 1;
+    buffer->events.resize(events_per_thread_);
+    cached_buffer = buffer.get();
+    cached_id = id_;
+    buffers_.push_back(std::move(buffer));
+    return *cached_buffer;
+}
+
+void TraceRecorder::record(Stage stage, int frame, std::chrono::steady_clock::time_point begin,
+                           std::chrono::steady_clock::time_point end) {
+    ThreadBuffer& buffer = buffer_for_current_thread();
+    Event& event = buffer.events[buffer.next];
+    event.begin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - origin_).count();
+    event.duration_ns = end > begin ? std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() : 0;
+    event.frame = frame;
+    event.stage = static_cast<int32_t>(stage);
+    if (++buffer.next == buffer.events.size()) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+bool TraceRecorder::write_chrome_trace(const std::string& path) const {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "Warning: Could not open trace file " << path << " for writing." << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& buffer : buffers_) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"pipeline-%d\"}}",
+                     first ? "" : ",\n", buffer->thread_index, buffer->thread_index);
+        first = false;
+
+        // Oldest event first: after wrapping, the ring starts at `next`
+        size_t count = buffer->wrapped ? buffer->events.size() : buffer->next;
+        size_t start = buffer->wrapped ? buffer->next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Event& event = buffer->events[(start + i) % buffer->events.size()];
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                               "\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%d}}",
+                         stage_name(static_cast<Stage>(event.stage)), event.begin_ns / 1e3, event.duration_ns / 1e3,
+                         buffer->thread_index, event.frame);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    bool ok = std::fclose(file) == 0;
+    if (!ok) {
+        std::cerr << "Warning: Failed to write trace file " << path << std::endl;
+    }
+    return ok;
+}
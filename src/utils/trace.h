@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class Stage; // utils/profiler.h
+
+// Records per-frame stage begin/end events into per-thread ring buffers and writes them out in
+// the Chrome Trace Event format (chrome://tracing, https://ui.perfetto.dev). Each thread appends to
+// its own buffer without locking; the oldest events are overwritten once a buffer is full.
+class TraceRecorder {
+public:
+    explicit TraceRecorder(size_t events_per_thread = 1 << 18);
+
+    void record(Stage stage, int frame, std::chrono::steady_clock::time_point begin,
+                std::chrono::steady_clock::time_point end);
+
+    // Call after all recording threads are done
+    bool write_chrome_trace(const std::string& path) const;
+
+private:
+    struct Event {
+        uint64_t begin_ns;
+        uint64_t duration_ns;
+        int32_t frame;
+        int32_t stage;
+    };
+
+    struct ThreadBuffer {
+        int thread_index;
+        std::vector<Event> events;
+        size_t next = 0;
+        bool wrapped = false;
+    };
+
+    ThreadBuffer& buffer_for_current_thread();
+
+    const uint64_t id_;
+    const size_t events_per_thread_;
+    const std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex mutex_; // guards buffers_ (registration and final dump only)
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+
+    static std::atomic<uint64_t> next_id_;
+};
+
+#endif // TRACE_H